@@ -0,0 +1,191 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+#include <malloc.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "compactor_pool.h"
+#include "kll.h"
+#include "random_generator.h"
+
+namespace {
+
+// Bytes currently allocated through operator new, to measure the heap usage of the sketches.
+std::atomic<int64_t> live_bytes{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    live_bytes += malloc_usable_size(ptr);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr != nullptr) {
+        live_bytes -= malloc_usable_size(ptr);
+        free(ptr);
+    }
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+namespace dist_proc {
+namespace aggregation {
+
+namespace {
+
+// Number of sketches alive at the same time, like the dimensions of a KLL metric sliced by uid.
+const int kNumDimensions = 1000;
+
+KllQuantileOptions DefaultOptions() {
+    return KllQuantileOptions();
+}
+
+KllQuantileOptions SharedRandomAndPoolOptions() {
+    KllQuantileOptions options;
+    options.set_shared_random(std::make_shared<XorShiftRandomGenerator>());
+    options.set_compactor_pool(std::make_shared<CompactorPool>());
+    return options;
+}
+
+// Creates kNumDimensions sketches with state.range(0) values each, as a metric does for every
+// bucket, and reports the heap bytes held per sketch while they are alive.
+void BM_KllMemoryPerDimension(benchmark::State& state, KllQuantileOptions (*make_options)()) {
+    const int num_values = state.range(0);
+    int64_t bytes_per_dimension = 0;
+    for (auto _ : state) {
+        // Options live across buckets, like those of a metric producer.
+        state.PauseTiming();
+        KllQuantileOptions options = make_options();
+        std::vector<std::unique_ptr<KllQuantile>> sketches;
+        sketches.reserve(kNumDimensions);
+        state.ResumeTiming();
+
+        for (int bucket = 0; bucket < 2; bucket++) {
+            const int64_t live_bytes_before = live_bytes;
+            for (int i = 0; i < kNumDimensions; i++) {
+                sketches.push_back(KllQuantile::Create(options));
+                for (int value = 0; value < num_values; value++) {
+                    sketches.back()->Add(value);
+                }
+            }
+            bytes_per_dimension = (live_bytes - live_bytes_before) / kNumDimensions;
+            // Bucket flush.
+            sketches.clear();
+        }
+    }
+    state.counters["bytes_per_dimension"] = bytes_per_dimension;
+    state.SetItemsProcessed(state.iterations() * 2 * kNumDimensions);
+}
+
+BENCHMARK_CAPTURE(BM_KllMemoryPerDimension, Default, DefaultOptions)
+        ->Arg(1)
+        ->Arg(100)
+        ->Arg(10000);
+BENCHMARK_CAPTURE(BM_KllMemoryPerDimension, SharedRandomAndPool, SharedRandomAndPoolOptions)
+        ->Arg(1)
+        ->Arg(100)
+        ->Arg(10000);
+
+// Merges kNumDimensions sketches with state.range(0) values each into one, as when rolling up the
+// dimensions of a metric.
+void BM_KllMerge(benchmark::State& state) {
+    const int num_values = state.range(0);
+    KllQuantileOptions options = SharedRandomAndPoolOptions();
+    std::vector<std::unique_ptr<KllQuantile>> sketches;
+    for (int i = 0; i < kNumDimensions; i++) {
+        sketches.push_back(KllQuantile::Create(options));
+        for (int value = 0; value < num_values; value++) {
+            sketches.back()->Add(value * kNumDimensions + i);
+        }
+    }
+    for (auto _ : state) {
+        std::unique_ptr<KllQuantile> merged = KllQuantile::Create(options);
+        for (const auto& sketch : sketches) {
+            merged->Merge(*sketch);
+        }
+        benchmark::DoNotOptimize(merged->num_stored_values());
+    }
+    state.SetItemsProcessed(state.iterations() * kNumDimensions);
+}
+BENCHMARK(BM_KllMerge)->Arg(1)->Arg(100)->Arg(10000);
+
+std::vector<int64_t> PulledValues(int num_values) {
+    std::vector<int64_t> values;
+    values.reserve(num_values);
+    for (int i = 0; i < num_values; i++) {
+        // Latency like values, spread over a few bytes.
+        values.push_back((int64_t{i} * 7919) % 100000);
+    }
+    return values;
+}
+
+// Adds state.range(0) values to a sketch one at a time, then with AddBatch().
+void BM_KllAdd(benchmark::State& state) {
+    const std::vector<int64_t> values = PulledValues(state.range(0));
+    KllQuantileOptions options = SharedRandomAndPoolOptions();
+    for (auto _ : state) {
+        std::unique_ptr<KllQuantile> sketch = KllQuantile::Create(options);
+        for (const int64_t value : values) {
+            sketch->Add(value);
+        }
+        benchmark::DoNotOptimize(sketch->num_stored_values());
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_KllAdd)->Arg(1000)->Arg(100000);
+
+void BM_KllAddBatch(benchmark::State& state) {
+    const std::vector<int64_t> values = PulledValues(state.range(0));
+    KllQuantileOptions options = SharedRandomAndPoolOptions();
+    for (auto _ : state) {
+        std::unique_ptr<KllQuantile> sketch = KllQuantile::Create(options);
+        sketch->AddBatch(values.data(), values.size());
+        benchmark::DoNotOptimize(sketch->num_stored_values());
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_KllAddBatch)->Arg(1000)->Arg(100000);
+
+void BM_KllQuantile(benchmark::State& state) {
+    std::unique_ptr<KllQuantile> sketch = KllQuantile::Create(SharedRandomAndPoolOptions());
+    for (int value = 0; value < state.range(0); value++) {
+        sketch->Add(value);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sketch->Quantile(0.99));
+    }
+}
+BENCHMARK(BM_KllQuantile)->Arg(100)->Arg(1000000);
+
+}  // namespace
+
+}  // namespace aggregation
+}  // namespace dist_proc
+
+BENCHMARK_MAIN();
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compactor_pool.h"
+
+#include <utility>
+
+namespace dist_proc {
+namespace aggregation {
+
+std::vector<int64_t> CompactorPool::Acquire() {
+    if (free_buffers_.empty()) {
+        return {};
+    }
+    std::vector<int64_t> buffer = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+    return buffer;
+}
+
+void CompactorPool::Release(std::vector<int64_t>&& buffer) {
+    if (buffer.capacity() == 0 || buffer.capacity() > max_buffer_capacity_ ||
+        free_buffers_.size() >= max_pooled_buffers_) {
+        std::vector<int64_t>().swap(buffer);
+        return;
+    }
+    buffer.clear();
+    free_buffers_.push_back(std::move(buffer));
+}
+
+}  // namespace aggregation
+}  // namespace dist_proc
@@ -19,8 +19,12 @@
 
 #include <log/log.h>
 
+#include <array>
+#include <utility>
 #include <vector>
 
+#include "compactor_pool.h"
+#include "encoding/varint.h"
 #include "random_generator.h"
 #include "sampler.h"
 
@@ -28,12 +32,69 @@ namespace dist_proc {
 namespace aggregation {
 namespace internal {
 
-CompactorStack::CompactorStack(int64_t inv_eps, int64_t inv_delta, RandomGenerator* random)
-    : CompactorStack(inv_eps, inv_delta, 0, random) {
+namespace {
+
+// Below this size std::sort is faster than the radix sort.
+constexpr size_t kMinRadixSortSize = 1024;
+
+// Key that orders int64 values like unsigned integers.
+inline uint64_t RadixKey(int64_t value) {
+    return static_cast<uint64_t>(value) ^ (uint64_t{1} << 63);
+}
+
+// Sorts values with a least significant byte first radix sort. The histograms
+// of all bytes are built in one pass, and bytes that are the same in all values
+// (e.g. the high bytes of small values) are skipped.
+void Sort(std::vector<int64_t>* values) {
+    const size_t n = values->size();
+    if (n < kMinRadixSortSize) {
+        std::sort(values->begin(), values->end());
+        return;
+    }
+    std::array<std::array<uint32_t, 256>, 8> counts{};
+    for (const int64_t value : *values) {
+        const uint64_t key = RadixKey(value);
+        for (int byte = 0; byte < 8; byte++) {
+            counts[byte][(key >> (8 * byte)) & 0xff]++;
+        }
+    }
+
+    std::vector<int64_t> scratch(n);
+    int64_t* src = values->data();
+    int64_t* dst = scratch.data();
+    const uint64_t first_key = RadixKey((*values)[0]);
+    for (int byte = 0; byte < 8; byte++) {
+        std::array<uint32_t, 256>& offsets = counts[byte];
+        const int shift = 8 * byte;
+        if (offsets[(first_key >> shift) & 0xff] == n) {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (uint32_t& count : offsets) {
+            const uint32_t bucket_size = count;
+            count = offset;
+            offset += bucket_size;
+        }
+        for (size_t i = 0; i < n; i++) {
+            dst[offsets[(RadixKey(src[i]) >> shift) & 0xff]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != values->data()) {
+        std::copy(src, src + n, values->data());
+    }
+}
+
+}  // namespace
+
+CompactorStack::CompactorStack(int64_t inv_eps, int64_t inv_delta, RandomGenerator* random,
+                               CompactorPool* pool)
+    : CompactorStack(inv_eps, inv_delta, 0, random, pool) {
 }
 
-CompactorStack::CompactorStack(int64_t inv_eps, int64_t inv_delta, int k, RandomGenerator* random)
-    : random_(random) {
+CompactorStack::CompactorStack(int64_t inv_eps, int64_t inv_delta, int k, RandomGenerator* random,
+                               CompactorPool* pool)
+    : random_(random), pool_(pool) {
     if (k != 0) {
         k_ = k;
     } else {
@@ -58,7 +119,7 @@ void CompactorStack::Reset() {
 
 void CompactorStack::Add(const int64_t value) {
     if (sampler_ == nullptr) {
-        compactors_[0].push_back(value);
+        PushToCompactor(&compactors_[0], value);
         num_items_in_compactors_++;
         CompactStack();
     } else {
@@ -66,6 +127,34 @@ void CompactorStack::Add(const int64_t value) {
     }
 }
 
+void CompactorStack::AddBatch(const int64_t* values, size_t num_values) {
+    size_t i = 0;
+    while (i < num_values) {
+        if (sampler_ != nullptr) {
+            // The sampler selects items one at a time. Once on, it stays on.
+            for (; i < num_values; i++) {
+                sampler_->Add(values[i]);
+            }
+            return;
+        }
+        // Add as many items as possible before the next compaction, which is
+        // when Add() would compact.
+        const size_t num_free_items = std::max(overall_capacity_ - num_items_in_compactors_, 0);
+        const size_t num_added_items = std::min(num_free_items, num_values - i);
+        std::vector<int64_t>& compactor = compactors_[0];
+        if (pool_ != nullptr && compactor.capacity() == 0) {
+            compactor = pool_->Acquire();
+        }
+        compactor.insert(compactor.end(), values + i, values + i + num_added_items);
+        for (size_t j = i; j < i + num_added_items; j++) {
+            encoded_items_size_ += Varint::Length64(static_cast<uint64_t>(values[j]));
+        }
+        num_items_in_compactors_ += num_added_items;
+        i += num_added_items;
+        CompactStack();
+    }
+}
+
 // Adds an item to the compactor stack with weight >= 1.
 // Does nothing if weight <= 0.
 void CompactorStack::AddWithWeight(int64_t value, int weight) {
@@ -82,7 +171,7 @@ void CompactorStack::AddWithWeight(int64_t value, int weight) {
                 AddLevel();
             }
             if ((remaining_weight & 1) != 0) {
-                compactors_[level_to_add].push_back(value);
+                PushToCompactor(&compactors_[level_to_add], value);
                 num_items_in_compactors_++;
             }
             remaining_weight >>= 1;
@@ -92,15 +181,75 @@ void CompactorStack::AddWithWeight(int64_t value, int weight) {
     }
 }
 
+void CompactorStack::MergeFrom(const CompactorStack& other) {
+    const auto sampled_item_and_weight = other.sampled_item_and_weight();
+    // Adding to this stack changes its compactors, so merging with itself
+    // works on a copy.
+    std::vector<std::vector<int64_t>> own_compactors;
+    const std::vector<std::vector<int64_t>>* other_compactors = &other.compactors_;
+    if (&other == this) {
+        own_compactors = compactors_;
+        other_compactors = &own_compactors;
+    }
+
+    for (size_t level = 0; level < other_compactors->size(); level++) {
+        const std::vector<int64_t>& compactor = (*other_compactors)[level];
+        if (compactor.empty()) {
+            continue;
+        }
+        for (const int64_t value : compactor) {
+            AddToLevel(value, level);
+        }
+        // Compact once per level, a level never holds much more than k items.
+        CompactStack();
+    }
+    if (sampled_item_and_weight.has_value()) {
+        AddWithWeight(sampled_item_and_weight->first, sampled_item_and_weight->second);
+    }
+}
+
+void CompactorStack::AddToLevel(int64_t value, int level) {
+    while (level >= static_cast<int>(compactors_.size())) {
+        AddLevel();
+    }
+    if (level < lowest_active_level()) {
+        sampler_->AddWithWeight(value, 1 << level);
+        return;
+    }
+    PushToCompactor(&compactors_[level], value);
+    num_items_in_compactors_++;
+}
+
 void CompactorStack::SortCompactorContents() {
     for (std::vector<int64_t>& compactor : compactors_) {
-        std::sort(compactor.begin(), compactor.end());
+        Sort(&compactor);
     }
 }
 
 void CompactorStack::ClearCompactors() {
+    if (pool_ != nullptr) {
+        for (std::vector<int64_t>& compactor : compactors_) {
+            ReleaseCompactor(&compactor);
+        }
+    }
     compactors_.clear();
     num_items_in_compactors_ = 0;
+    encoded_items_size_ = 0;
+}
+
+void CompactorStack::PushToCompactor(std::vector<int64_t>* compactor, int64_t value) {
+    if (pool_ != nullptr && compactor->capacity() == 0) {
+        *compactor = pool_->Acquire();
+    }
+    compactor->push_back(value);
+    encoded_items_size_ += Varint::Length64(static_cast<uint64_t>(value));
+}
+
+void CompactorStack::ReleaseCompactor(std::vector<int64_t>* compactor) {
+    if (pool_ != nullptr) {
+        pool_->Release(std::move(*compactor));
+    }
+    std::vector<int64_t>().swap(*compactor);
 }
 
 void CompactorStack::AddLevel() {
@@ -151,7 +300,7 @@ void CompactorStack::CompactLevel(int level) {
         AddLevel();
     }
     Halve(&compactors_[level], &compactors_[level + 1]);
-    std::vector<int64_t>().swap(compactors_[level]);
+    ReleaseCompactor(&compactors_[level]);
 }
 
 // To compact the items in a compactor to roughly half the size,
@@ -159,7 +308,7 @@ void CompactorStack::CompactLevel(int level) {
 // to the up_compactor.
 void CompactorStack::Halve(std::vector<int64_t>* down_compactor,
                            std::vector<int64_t>* up_compactor) {
-    std::sort(down_compactor->begin(), down_compactor->end());
+    Sort(down_compactor);
     double half_of_items = down_compactor->size() / static_cast<double>(2);
     bool keep_even_items = (random_->UnbiasedUniform(2) == 0);
     num_items_in_compactors_ -= static_cast<int>(keep_even_items ? std::floor(half_of_items)
@@ -168,8 +317,10 @@ void CompactorStack::Halve(std::vector<int64_t>* down_compactor,
     bool even = true;
 
     for (size_t i = 0; i < down_compactor->size(); i++) {
+        const int64_t value = (*down_compactor)[i];
+        encoded_items_size_ -= Varint::Length64(static_cast<uint64_t>(value));
         if (even == keep_even_items) {
-            up_compactor->push_back((*down_compactor)[i]);
+            PushToCompactor(up_compactor, value);
         }
         even = !even;
     }
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dist_proc {
+namespace aggregation {
+
+// Pool of compactor buffers shared by sketches. Compactors return their
+// storage to the pool when they are emptied by a compaction or when their
+// sketch is reset or destroyed, and draw from it when they get items again,
+// so that many short lived sketches (e.g. one per dimension and bucket) reuse
+// the same allocations. Only small buffers are kept: a large buffer handed to
+// a level that needs few items would waste more memory than it saves.
+// Not safe to be used concurrently.
+class CompactorPool {
+public:
+    static constexpr size_t kDefaultMaxPooledBuffers = 64;
+    static constexpr size_t kDefaultMaxBufferCapacity = 256;
+
+    explicit CompactorPool(size_t max_pooled_buffers = kDefaultMaxPooledBuffers,
+                           size_t max_buffer_capacity = kDefaultMaxBufferCapacity)
+        : max_pooled_buffers_(max_pooled_buffers), max_buffer_capacity_(max_buffer_capacity) {
+    }
+
+    // Returns an empty buffer, reusing the storage of a released one if any.
+    std::vector<int64_t> Acquire();
+
+    // Keeps the storage of buffer for later Acquire() calls, or frees it if the
+    // pool is full or the buffer can hold more than max_buffer_capacity items.
+    void Release(std::vector<int64_t>&& buffer);
+
+    size_t num_pooled_buffers() const {
+        return free_buffers_.size();
+    }
+
+private:
+    const size_t max_pooled_buffers_;
+    const size_t max_buffer_capacity_;
+    std::vector<std::vector<int64_t>> free_buffers_;
+
+    CompactorPool(const CompactorPool&) = delete;
+    CompactorPool& operator=(const CompactorPool&) = delete;
+};
+
+}  // namespace aggregation
+}  // namespace dist_proc
@@ -23,6 +23,7 @@
 #include <utility>
 #include <vector>
 
+#include "compactor_pool.h"
 #include "random_generator.h"
 #include "sampler.h"
 
@@ -37,8 +38,12 @@ class KllSampler;
 // and add them to the compactor one level up.
 class CompactorStack {
 public:
-    CompactorStack(int64_t inv_eps, int64_t inv_delta, RandomGenerator* random);
-    CompactorStack(int64_t inv_eps, int64_t inv_delta, int k, RandomGenerator* random);
+    // If pool is not null, compactor storage is drawn from and returned to it. The pool must
+    // outlive the compactor stack.
+    CompactorStack(int64_t inv_eps, int64_t inv_delta, RandomGenerator* random,
+                   CompactorPool* pool = nullptr);
+    CompactorStack(int64_t inv_eps, int64_t inv_delta, int k, RandomGenerator* random,
+                   CompactorPool* pool = nullptr);
     ~CompactorStack();
 
     // Initialize or reset the compactor stack and all counters and thresholds.
@@ -46,10 +51,18 @@ public:
 
     void Add(const int64_t value);
 
+    // Adds num_values items with weight one. Equivalent to calling Add() for
+    // each of them, but fills the lowest compactor in bulk between compactions.
+    void AddBatch(const int64_t* values, size_t num_values);
+
     // Adds an item to the compactor stack with weight >= 1.
     // Does nothing if weight <= 0.
     void AddWithWeight(int64_t value, int weight);
 
+    // Adds the items of other, each with the weight of its level, and its
+    // sampled item. other may be this compactor stack.
+    void MergeFrom(const CompactorStack& other);
+
     // Ensures that the contents of each compactor are sorted.
     void SortCompactorContents();
 
@@ -62,6 +75,12 @@ public:
 
     int num_stored_items() const;
 
+    // Sum of the varint lengths of all items in the compactors, i.e. the size of
+    // their packed encoding. Maintained as items are added and compacted.
+    int64_t encoded_items_size() const {
+        return encoded_items_size_;
+    }
+
     std::optional<std::pair<const int64_t, int64_t>> sampled_item_and_weight() const;
 
     // Returns the lowest active level in the compactor stack, which is identical
@@ -90,6 +109,16 @@ public:
 private:
     void ClearCompactors();
 
+    // Adds value with weight 2^level, to the compactor at that level or to the
+    // sampler if the level has been replaced by it. Does not compact.
+    void AddToLevel(int64_t value, int level);
+
+    // Appends value to the compactor, taking its storage from the pool if it has none.
+    void PushToCompactor(std::vector<int64_t>* compactor, int64_t value);
+
+    // Empties the compactor and frees its storage, or returns it to the pool.
+    void ReleaseCompactor(std::vector<int64_t>* compactor);
+
     // Adds a new compactor at the highest level. To be called when the currently
     // topmost compactor is full.
     void AddLevel();
@@ -112,7 +141,9 @@ private:
     const double c_ = 2.0 / 3.0;
     int overall_capacity_;
     int num_items_in_compactors_;
+    int64_t encoded_items_size_;
     RandomGenerator* random_;
+    CompactorPool* pool_;
     std::unique_ptr<KllSampler> sampler_;
 };
 
@@ -16,7 +16,13 @@
 
 #pragma once
 
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
 #include "aggregator.pb.h"
+#include "compactor_pool.h"
 #include "compactor_stack.h"
 #include "random_generator.h"
 
@@ -65,22 +71,46 @@ public:
     // downscaling and randomized rounding is negligible.
     void AddWeighted(int64_t value, int weight);
 
+    // Adds num_values values, e.g. all values of a pull. Same result as calling
+    // Add() for each of them, but faster.
+    void AddBatch(const int64_t* values, size_t num_values);
+
+    // Adds all values aggregated by other to this aggregator, e.g. to combine
+    // the sketches of partial buckets or of several dimensions. The result
+    // keeps the parameters (inv_eps, k) of this aggregator. other may be this
+    // aggregator.
+    void Merge(const KllQuantile& other);
+
+    // Returns an approximate q-quantile of the aggregated values, i.e. a value
+    // whose rank is within epsilon of q. Quantile(0) and Quantile(1) are the
+    // exact min and max. Returns std::nullopt if no value was added or if q is
+    // not in [0, 1].
+    std::optional<int64_t> Quantile(double q) const;
+
+    // Returns the approximate fraction of aggregated values that are less than
+    // or equal to value, 0 if no value was added.
+    double Rank(int64_t value) const;
+
     // Not safe to be called concurrently.
     zetasketch::android::AggregatorStateProto SerializeToProto();
 
+    // Estimate of SerializeToProto().ByteSizeLong() in constant time, without
+    // sorting or encoding the compactors. Exact except for the lengths of the
+    // per-compactor headers, for which an upper bound is used.
+    size_t SerializedSizeEstimate() const;
+
     bool IsSamplerOn() const {
         return compactor_stack_.IsSamplerOn();
     }
 
 private:
     // Constructor.
-    KllQuantile(int64_t inv_eps, int64_t inv_delta, int k, RandomGenerator* random)
-        : inv_eps_(inv_eps),
-          owned_random_(random != nullptr ? nullptr : std::make_unique<MTRandomGenerator>()),
-          compactor_stack_(inv_eps_, inv_delta, k,
-                           random != nullptr ? random : owned_random_.get()) {
-        Reset();
-    }
+    KllQuantile(int64_t inv_eps, int64_t inv_delta, int k, RandomGenerator* random,
+                std::shared_ptr<RandomGenerator> shared_random,
+                std::shared_ptr<CompactorPool> compactor_pool);
+    // Items stored in the compactor stack and sampler, sorted by value, with
+    // the number of values that each of them stands for.
+    std::vector<std::pair<int64_t, int64_t>> SortedWeightedItems() const;
     void UpdateMin(const int64_t value);
     void UpdateMax(const int64_t value);
     int64_t inv_eps_;
@@ -92,6 +122,10 @@ private:
     int64_t num_values_;
     // Owned MTRandom instance, if not given a RandomGenerator.
     std::unique_ptr<MTRandomGenerator> owned_random_;
+    // Shared ownership of the RandomGenerator and CompactorPool given in the
+    // options, declared before compactor_stack_ so that they outlive it.
+    std::shared_ptr<RandomGenerator> shared_random_;
+    std::shared_ptr<CompactorPool> compactor_pool_;
     // Stack of compactors to which newly added items are added;
     // it maintains a 'sketch' of hitherto added items.
     internal::CompactorStack compactor_stack_;
@@ -129,6 +163,18 @@ public:
     void set_random(RandomGenerator* random) {
         random_ = random;
     }
+    // Set a RandomGenerator that is kept alive by all sketches created with
+    // these options, e.g. a XorShiftRandomGenerator shared by many sketches.
+    // Takes precedence over set_random().
+    void set_shared_random(std::shared_ptr<RandomGenerator> random) {
+        shared_random_ = std::move(random);
+    }
+    // Set a pool from which sketches created with these options draw their
+    // compactor storage, and to which they return it on compaction, Reset() and
+    // destruction. Default is to allocate storage per sketch.
+    void set_compactor_pool(std::shared_ptr<CompactorPool> pool) {
+        compactor_pool_ = std::move(pool);
+    }
     int64_t inv_eps() const {
         return inv_eps_;
     }
@@ -141,12 +187,20 @@ public:
     RandomGenerator* random() const {
         return random_;
     }
+    const std::shared_ptr<RandomGenerator>& shared_random() const {
+        return shared_random_;
+    }
+    const std::shared_ptr<CompactorPool>& compactor_pool() const {
+        return compactor_pool_;
+    }
 
 private:
     int64_t inv_eps_ = 1000;
     int64_t inv_delta_ = 100000;
     int k_ = 0;
     RandomGenerator* random_ = nullptr;
+    std::shared_ptr<RandomGenerator> shared_random_;
+    std::shared_ptr<CompactorPool> compactor_pool_;
 };
 
 }  // namespace aggregation
@@ -51,5 +51,47 @@ private:
     std::mt19937 bit_gen_;
 };
 
+// Small (8 bytes of state) and fast xorshift64* generator. Meant to be shared by many sketches,
+// e.g. all sketches of a metric, instead of giving each one a MTRandomGenerator.
+// Not safe to be used concurrently.
+class XorShiftRandomGenerator : public RandomGenerator {
+public:
+    XorShiftRandomGenerator(std::optional<uint64_t> seed = std::nullopt) {
+        uint64_t state;
+        if (seed.has_value()) {
+            state = seed.value();
+        } else {
+            std::random_device rd;
+            state = (static_cast<uint64_t>(rd()) << 32) | rd();
+        }
+        // The all zero state is a fixed point of xorshift.
+        state_ = state != 0 ? state : 0x9E3779B97F4A7C15ULL;
+    }
+
+    uint64_t UnbiasedUniform(uint64_t n) override {
+        if (n <= 1) {
+            return 0;
+        }
+        // Values below threshold are rejected so that the modulo is not biased.
+        const uint64_t threshold = -n % n;
+        while (true) {
+            const uint64_t value = Next();
+            if (value >= threshold) {
+                return value % n;
+            }
+        }
+    }
+
+private:
+    uint64_t Next() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 0x2545F4914F6CDD1DULL;
+    }
+
+    uint64_t state_;
+};
+
 }  // namespace aggregation
 }  // namespace dist_proc
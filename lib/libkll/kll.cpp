@@ -16,12 +16,18 @@
 
 #include "kll.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 #include "aggregator.pb.h"
 #include "compactor_stack.h"
 #include "encoding/encoder.h"
+#include "encoding/varint.h"
 #include "kll-quantiles.pb.h"
 
 namespace dist_proc {
@@ -29,6 +35,53 @@ namespace aggregation {
 
 using zetasketch::android::AggregatorStateProto;
 
+namespace {
+
+// Returns the min and max of values, num_values > 0. Keeps kLanes independent
+// minima and maxima so that the compiler turns the loop into vector compares
+// and selects.
+std::pair<int64_t, int64_t> MinMax(const int64_t* values, size_t num_values) {
+    constexpr size_t kLanes = 8;
+    int64_t min = values[0];
+    int64_t max = values[0];
+    size_t i = 0;
+    if (num_values >= kLanes) {
+        int64_t mins[kLanes];
+        int64_t maxs[kLanes];
+        for (size_t lane = 0; lane < kLanes; lane++) {
+            mins[lane] = maxs[lane] = values[lane];
+        }
+        for (; i + kLanes <= num_values; i += kLanes) {
+            for (size_t lane = 0; lane < kLanes; lane++) {
+                const int64_t value = values[i + lane];
+                mins[lane] = value < mins[lane] ? value : mins[lane];
+                maxs[lane] = value > maxs[lane] ? value : maxs[lane];
+            }
+        }
+        for (size_t lane = 0; lane < kLanes; lane++) {
+            min = std::min(min, mins[lane]);
+            max = std::max(max, maxs[lane]);
+        }
+    }
+    for (; i < num_values; i++) {
+        min = std::min(min, values[i]);
+        max = std::max(max, values[i]);
+    }
+    return {min, max};
+}
+
+// Size of a varint field with a one byte tag.
+size_t VarintFieldSize(int64_t value) {
+    return 1 + Varint::Length64(static_cast<uint64_t>(value));
+}
+
+// Size of a length delimited field with a tag of tag_size bytes.
+size_t LengthDelimitedFieldSize(size_t length, size_t tag_size = 1) {
+    return tag_size + Varint::Length64(length) + length;
+}
+
+}  // namespace
+
 std::unique_ptr<KllQuantile> KllQuantile::Create(std::string* error) {
     return Create(KllQuantileOptions(), error);
 }
@@ -41,8 +94,27 @@ std::unique_ptr<KllQuantile> KllQuantile::Create(const KllQuantileOptions& optio
         }
         return nullptr;
     }
-    return std::unique_ptr<KllQuantile>(
-            new KllQuantile(options.inv_eps(), options.inv_delta(), options.k(), options.random()));
+    return std::unique_ptr<KllQuantile>(new KllQuantile(options.inv_eps(), options.inv_delta(),
+                                                        options.k(), options.random(),
+                                                        options.shared_random(),
+                                                        options.compactor_pool()));
+}
+
+KllQuantile::KllQuantile(int64_t inv_eps, int64_t inv_delta, int k, RandomGenerator* random,
+                         std::shared_ptr<RandomGenerator> shared_random,
+                         std::shared_ptr<CompactorPool> compactor_pool)
+    : inv_eps_(inv_eps),
+      owned_random_(random != nullptr || shared_random != nullptr
+                            ? nullptr
+                            : std::make_unique<MTRandomGenerator>()),
+      shared_random_(std::move(shared_random)),
+      compactor_pool_(std::move(compactor_pool)),
+      compactor_stack_(inv_eps_, inv_delta, k,
+                       shared_random_ != nullptr ? shared_random_.get()
+                       : random != nullptr       ? random
+                                                 : owned_random_.get(),
+                       compactor_pool_.get()) {
+    Reset();
 }
 
 void KllQuantile::Add(const int64_t value) {
@@ -61,6 +133,104 @@ void KllQuantile::AddWeighted(int64_t value, int weight) {
     }
 }
 
+void KllQuantile::AddBatch(const int64_t* values, size_t num_values) {
+    if (num_values == 0) {
+        return;
+    }
+    compactor_stack_.AddBatch(values, num_values);
+    const auto [min, max] = MinMax(values, num_values);
+    UpdateMin(min);
+    UpdateMax(max);
+    num_values_ += num_values;
+}
+
+void KllQuantile::Merge(const KllQuantile& other) {
+    if (other.num_values_ == 0) {
+        return;
+    }
+    const int64_t other_min = other.min_;
+    const int64_t other_max = other.max_;
+    const int64_t other_num_values = other.num_values_;
+    compactor_stack_.MergeFrom(other.compactor_stack_);
+    UpdateMin(other_min);
+    UpdateMax(other_max);
+    num_values_ += other_num_values;
+}
+
+std::vector<std::pair<int64_t, int64_t>> KllQuantile::SortedWeightedItems() const {
+    std::vector<std::pair<int64_t, int64_t>> items;
+    items.reserve(compactor_stack_.num_stored_items());
+    const std::vector<std::vector<int64_t>>& compactors = compactor_stack_.compactors();
+    for (size_t level = 0; level < compactors.size(); level++) {
+        const int64_t weight = int64_t{1} << level;
+        for (const int64_t value : compactors[level]) {
+            items.emplace_back(value, weight);
+        }
+    }
+    const auto& sampled_item_and_weight = compactor_stack_.sampled_item_and_weight();
+    if (sampled_item_and_weight.has_value()) {
+        items.emplace_back(sampled_item_and_weight->first, sampled_item_and_weight->second);
+    }
+    std::sort(items.begin(), items.end());
+    return items;
+}
+
+std::optional<int64_t> KllQuantile::Quantile(double q) const {
+    if (num_values_ == 0 || !(q >= 0 && q <= 1)) {
+        return std::nullopt;
+    }
+    if (q == 0) {
+        return min_;
+    }
+    if (q == 1) {
+        return max_;
+    }
+    const std::vector<std::pair<int64_t, int64_t>> items = SortedWeightedItems();
+    int64_t total_weight = 0;
+    for (const auto& [_, weight] : items) {
+        total_weight += weight;
+    }
+    const double target_weight = std::ceil(q * total_weight);
+    int64_t weight_so_far = 0;
+    for (const auto& [value, weight] : items) {
+        weight_so_far += weight;
+        if (weight_so_far >= target_weight) {
+            return std::clamp(value, min_, max_);
+        }
+    }
+    return max_;
+}
+
+double KllQuantile::Rank(int64_t value) const {
+    if (num_values_ == 0 || value < min_) {
+        return 0;
+    }
+    if (value >= max_) {
+        return 1;
+    }
+    // No need to sort the items to count the weight below value.
+    int64_t total_weight = 0;
+    int64_t weight_up_to_value = 0;
+    const std::vector<std::vector<int64_t>>& compactors = compactor_stack_.compactors();
+    for (size_t level = 0; level < compactors.size(); level++) {
+        const int64_t weight = int64_t{1} << level;
+        for (const int64_t item : compactors[level]) {
+            total_weight += weight;
+            if (item <= value) {
+                weight_up_to_value += weight;
+            }
+        }
+    }
+    const auto& sampled_item_and_weight = compactor_stack_.sampled_item_and_weight();
+    if (sampled_item_and_weight.has_value()) {
+        total_weight += sampled_item_and_weight->second;
+        if (sampled_item_and_weight->first <= value) {
+            weight_up_to_value += sampled_item_and_weight->second;
+        }
+    }
+    return total_weight == 0 ? 0 : static_cast<double>(weight_up_to_value) / total_weight;
+}
+
 AggregatorStateProto KllQuantile::SerializeToProto() {
     AggregatorStateProto aggregator_state;
 
@@ -114,6 +284,44 @@ AggregatorStateProto KllQuantile::SerializeToProto() {
     return aggregator_state;
 }
 
+size_t KllQuantile::SerializedSizeEstimate() const {
+    // Mirrors the fields written by SerializeToProto().
+    size_t quantile_state_size =
+            VarintFieldSize(compactor_stack_.k()) + VarintFieldSize(inv_eps_);
+    if (num_values_ != 0) {
+        quantile_state_size += LengthDelimitedFieldSize(Varint::Length64(min_));
+        quantile_state_size += LengthDelimitedFieldSize(Varint::Length64(max_));
+
+        // Each compactor is a Compactor message holding its packed values. No
+        // single compactor is larger than all of them, so their lengths are
+        // bounded by the total.
+        const size_t encoded_items_size = compactor_stack_.encoded_items_size();
+        const size_t max_packed_values_size = LengthDelimitedFieldSize(encoded_items_size);
+        const size_t max_compactor_header_size = 1 + Varint::Length64(max_packed_values_size) +
+                                                 (max_packed_values_size - encoded_items_size);
+        quantile_state_size +=
+                compactor_stack_.compactors().size() * max_compactor_header_size +
+                encoded_items_size;
+
+        if (compactor_stack_.IsSamplerOn()) {
+            size_t sampler_size = VarintFieldSize(compactor_stack_.lowest_active_level());
+            const auto& sampled_item_and_weight = compactor_stack_.sampled_item_and_weight();
+            if (sampled_item_and_weight.has_value()) {
+                sampler_size +=
+                        LengthDelimitedFieldSize(Varint::Length64(sampled_item_and_weight->first));
+                sampler_size += VarintFieldSize(sampled_item_and_weight->second);
+            }
+            quantile_state_size += LengthDelimitedFieldSize(sampler_size);
+        }
+    }
+
+    // type, num_values and value_type, then the kll_quantiles_state extension
+    // whose field number (113) takes a two byte tag.
+    return VarintFieldSize(zetasketch::android::KLL_QUANTILES) + VarintFieldSize(num_values_) +
+           VarintFieldSize(zetasketch::android::DefaultOpsType::INT64) +
+           LengthDelimitedFieldSize(quantile_state_size, /*tag_size=*/2);
+}
+
 void KllQuantile::UpdateMin(int64_t value) {
     if (num_values_ == 0 || min_ > value) {
         min_ = value;
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "compactor_pool.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "compactor_stack.h"
+#include "gmock/gmock.h"
+#include "random_generator.h"
+
+namespace dist_proc {
+namespace aggregation {
+
+namespace {
+
+TEST(CompactorPoolTest, AcquireFromEmptyPool) {
+    CompactorPool pool;
+    std::vector<int64_t> buffer = pool.Acquire();
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.capacity(), 0u);
+}
+
+TEST(CompactorPoolTest, ReusesReleasedStorage) {
+    CompactorPool pool;
+    std::vector<int64_t> buffer = {1, 2, 3};
+    const int64_t* data = buffer.data();
+    const size_t capacity = buffer.capacity();
+    pool.Release(std::move(buffer));
+    EXPECT_EQ(pool.num_pooled_buffers(), 1u);
+
+    std::vector<int64_t> reused = pool.Acquire();
+    EXPECT_TRUE(reused.empty());
+    EXPECT_EQ(reused.data(), data);
+    EXPECT_EQ(reused.capacity(), capacity);
+    EXPECT_EQ(pool.num_pooled_buffers(), 0u);
+}
+
+TEST(CompactorPoolTest, DropsBuffersWithoutStorage) {
+    CompactorPool pool;
+    pool.Release(std::vector<int64_t>());
+    EXPECT_EQ(pool.num_pooled_buffers(), 0u);
+}
+
+TEST(CompactorPoolTest, DropsLargeBuffers) {
+    CompactorPool pool(/*max_pooled_buffers=*/2, /*max_buffer_capacity=*/16);
+    pool.Release(std::vector<int64_t>(17));
+    EXPECT_EQ(pool.num_pooled_buffers(), 0u);
+    pool.Release(std::vector<int64_t>(16));
+    EXPECT_EQ(pool.num_pooled_buffers(), 1u);
+}
+
+TEST(CompactorPoolTest, KeepsAtMostMaxPooledBuffers) {
+    CompactorPool pool(/*max_pooled_buffers=*/2);
+    for (int i = 0; i < 5; i++) {
+        pool.Release(std::vector<int64_t>(10));
+    }
+    EXPECT_EQ(pool.num_pooled_buffers(), 2u);
+}
+
+TEST(CompactorPoolTest, CompactorStackReturnsStorageToPool) {
+    CompactorPool pool;
+    MTRandomGenerator random;
+    {
+        // Small k so that all compactors fit in pooled buffers.
+        internal::CompactorStack compactor_stack(1000, 100000, /*k=*/64, &random, &pool);
+        for (int i = 0; i < 1000; i++) {
+            compactor_stack.Add(i);
+        }
+        compactor_stack.Reset();
+        const size_t num_pooled_buffers = pool.num_pooled_buffers();
+        EXPECT_GT(num_pooled_buffers, 0u);
+
+        // Adding again draws from the pool instead of allocating.
+        compactor_stack.Add(1);
+        EXPECT_EQ(pool.num_pooled_buffers(), num_pooled_buffers - 1);
+    }
+    EXPECT_GT(pool.num_pooled_buffers(), 0u);
+}
+
+TEST(CompactorPoolTest, PooledCompactorStackMatchesUnpooled) {
+    XorShiftRandomGenerator random(/*seed=*/42);
+    XorShiftRandomGenerator pooled_random(/*seed=*/42);
+    CompactorPool pool;
+    internal::CompactorStack compactor_stack(1000, 100000, &random);
+    internal::CompactorStack pooled_compactor_stack(1000, 100000, &pooled_random, &pool);
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 20000; i++) {
+            compactor_stack.AddWithWeight(i, 1 + i % 3);
+            pooled_compactor_stack.AddWithWeight(i, 1 + i % 3);
+        }
+        EXPECT_EQ(compactor_stack.compactors(), pooled_compactor_stack.compactors());
+        EXPECT_EQ(compactor_stack.sampled_item_and_weight(),
+                  pooled_compactor_stack.sampled_item_and_weight());
+        compactor_stack.Reset();
+        pooled_compactor_stack.Reset();
+    }
+}
+
+TEST(XorShiftRandomGeneratorTest, UnbiasedUniformInRange) {
+    XorShiftRandomGenerator random(/*seed=*/0);
+    EXPECT_EQ(random.UnbiasedUniform(0), 0u);
+    EXPECT_EQ(random.UnbiasedUniform(1), 0u);
+
+    std::vector<int> counts(2, 0);
+    for (int i = 0; i < 10000; i++) {
+        const uint64_t value = random.UnbiasedUniform(2);
+        ASSERT_LT(value, 2u);
+        counts[value]++;
+    }
+    EXPECT_GT(counts[0], 4500);
+    EXPECT_GT(counts[1], 4500);
+
+    for (int i = 0; i < 10000; i++) {
+        EXPECT_LT(random.UnbiasedUniform(7), 7u);
+    }
+}
+
+TEST(XorShiftRandomGeneratorTest, SameSeedSameSequence) {
+    XorShiftRandomGenerator random1(/*seed=*/1234);
+    XorShiftRandomGenerator random2(/*seed=*/1234);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(random1.UnbiasedUniform(1000), random2.UnbiasedUniform(1000));
+    }
+}
+
+}  // namespace
+
+}  // namespace aggregation
+}  // namespace dist_proc
@@ -15,8 +15,10 @@
  */
 #include "compactor_stack.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <limits>
 #include <type_traits>
 #include <vector>
 
@@ -317,6 +319,61 @@ INSTANTIATE_TEST_SUITE_P(AddWithSamplerTestCases, AddWithSamplerTest,
                                  {100, 100, 1250000},
                                  {100, 1000, 2000000}}));
 
+// Large enough that compactors are radix sorted.
+class SortCompactorContentsTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(SortCompactorContentsTest, SortsCompactors) {
+    MTRandomGenerator random(/*seed=*/GetParam());
+    CompactorStack compactor_stack(1000, 100000, &random);
+    std::vector<int64_t> values = {std::numeric_limits<int64_t>::min(),
+                                   std::numeric_limits<int64_t>::max(), -1, 0, 1};
+    while (values.size() < 3000) {
+        const uint64_t bits = random.UnbiasedUniform(std::numeric_limits<uint64_t>::max());
+        // Mix small and large magnitudes, so that some bytes are skipped.
+        values.push_back(values.size() % 2 == 0 ? static_cast<int64_t>(bits)
+                                                : static_cast<int64_t>(bits % 1000) - 500);
+    }
+    compactor_stack.AddBatch(values.data(), values.size());
+    ASSERT_EQ(compactor_stack.compactors().size(), 1u);
+
+    compactor_stack.SortCompactorContents();
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(compactor_stack.compactors()[0], values);
+}
+
+INSTANTIATE_TEST_SUITE_P(SortCompactorContentsTestCases, SortCompactorContentsTest,
+                         ::testing::Values(1, 2, 3));
+
+TEST(AddBatchTest, SameAsAdd) {
+    MTRandomGenerator values_random(/*seed=*/0);
+    std::vector<int64_t> values;
+    for (int i = 0; i < 100000; i++) {
+        values.push_back(static_cast<int64_t>(values_random.UnbiasedUniform(1000000)) - 500000);
+    }
+    for (const int k : {8, 64, 4096}) {
+        MTRandomGenerator random(/*seed=*/k);
+        MTRandomGenerator batch_random(/*seed=*/k);
+        CompactorStack compactor_stack(1000, 100000, k, &random);
+        CompactorStack batch_compactor_stack(1000, 100000, k, &batch_random);
+
+        for (size_t begin = 0; begin < values.size(); begin += 7919) {
+            const size_t end = std::min(values.size(), begin + 7919);
+            for (size_t i = begin; i < end; i++) {
+                compactor_stack.Add(values[i]);
+            }
+            batch_compactor_stack.AddBatch(values.data() + begin, end - begin);
+            EXPECT_EQ(compactor_stack.compactors(), batch_compactor_stack.compactors());
+            EXPECT_EQ(compactor_stack.sampled_item_and_weight(),
+                      batch_compactor_stack.sampled_item_and_weight());
+            EXPECT_EQ(compactor_stack.encoded_items_size(),
+                      batch_compactor_stack.encoded_items_size());
+        }
+        if (k == 8) {
+            EXPECT_TRUE(batch_compactor_stack.IsSamplerOn());
+        }
+    }
+}
+
 }  // namespace
 
 }  // namespace internal
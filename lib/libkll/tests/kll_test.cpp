@@ -17,6 +17,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
 #include "kll-quantiles.pb.h"
 
 namespace dist_proc {
@@ -171,6 +177,313 @@ TEST(KllQuantileSerializationTest, EmptyQuantilesProto) {
     EXPECT_EQ(quantiles_state.compactors_size(), 0);
     ASSERT_FALSE(quantiles_state.has_sampler());
 }
+
+TEST(KllQuantileSerializationTest, SerializedSizeEstimateEmpty) {
+    std::unique_ptr<KllQuantile> aggregator = KllQuantile::Create();
+    EXPECT_EQ(aggregator->SerializedSizeEstimate(), aggregator->SerializeToProto().ByteSizeLong());
+}
+
+TEST(KllQuantileSerializationTest, SerializedSizeEstimateOneCompactorIsExact) {
+    std::unique_ptr<KllQuantile> aggregator = KllQuantile::Create();
+    for (int64_t value : std::vector<int64_t>{10, 20, -1, 300, int64_t{1} << 40}) {
+        aggregator->Add(value);
+        EXPECT_EQ(aggregator->SerializedSizeEstimate(),
+                  aggregator->SerializeToProto().ByteSizeLong());
+    }
+}
+
+TEST(KllQuantileSerializationTest, SerializedSizeEstimateIsCloseUpperBound) {
+    // Small k so that the sampler gets turned on.
+    KllQuantileOptions options;
+    options.set_k(16);
+    std::unique_ptr<KllQuantile> aggregator = KllQuantile::Create(options);
+    for (int i = 0; i < 100000; i++) {
+        aggregator->AddWeighted(i * 37 - 1000, 1 + i % 5);
+        if (i % 1000 == 0) {
+            const size_t estimate = aggregator->SerializedSizeEstimate();
+            const size_t size = aggregator->SerializeToProto().ByteSizeLong();
+            EXPECT_GE(estimate, size);
+            EXPECT_LE(estimate, size + 4 * aggregator->SerializeToProto()
+                                                .GetExtension(kll_quantiles_state)
+                                                .compactors_size());
+        }
+    }
+    EXPECT_TRUE(aggregator->IsSamplerOn());
+}
+
+TEST(KllQuantileSerializationTest, SharedRandomAndCompactorPool) {
+    // Small k so that compactors fit in pooled buffers.
+    KllQuantileOptions options;
+    options.set_k(64);
+    options.set_shared_random(std::make_shared<XorShiftRandomGenerator>(/*seed=*/7));
+    options.set_compactor_pool(std::make_shared<CompactorPool>());
+    std::unique_ptr<KllQuantile> aggregator1 = KllQuantile::Create(options);
+    std::unique_ptr<KllQuantile> aggregator2 = KllQuantile::Create(options);
+
+    XorShiftRandomGenerator random(/*seed=*/7);
+    KllQuantileOptions unpooled_options;
+    unpooled_options.set_k(64);
+    unpooled_options.set_random(&random);
+    std::unique_ptr<KllQuantile> unpooled_aggregator1 = KllQuantile::Create(unpooled_options);
+    std::unique_ptr<KllQuantile> unpooled_aggregator2 = KllQuantile::Create(unpooled_options);
+
+    // Same sequence of operations on the shared generator, so the sketches match.
+    for (int i = 0; i < 100000; i++) {
+        aggregator1->Add(i);
+        unpooled_aggregator1->Add(i);
+        aggregator2->Add(-i);
+        unpooled_aggregator2->Add(-i);
+    }
+    EXPECT_EQ(aggregator1->SerializeToProto().SerializeAsString(),
+              unpooled_aggregator1->SerializeToProto().SerializeAsString());
+    EXPECT_EQ(aggregator2->SerializeToProto().SerializeAsString(),
+              unpooled_aggregator2->SerializeToProto().SerializeAsString());
+
+    // The pool is kept alive by the sketches and gets their storage back.
+    std::weak_ptr<CompactorPool> pool = options.compactor_pool();
+    options.set_compactor_pool(nullptr);
+    aggregator1.reset();
+    ASSERT_FALSE(pool.expired());
+    EXPECT_GT(pool.lock()->num_pooled_buffers(), 0u);
+    aggregator2.reset();
+    EXPECT_TRUE(pool.expired());
+}
+
+// Max absolute rank error allowed in the tests below. Much larger than epsilon
+// (1/inv_eps = 0.001) so that the tests are not flaky.
+constexpr double kRankTolerance = 0.01;
+
+std::unique_ptr<KllQuantile> CreateSeeded(const std::shared_ptr<RandomGenerator>& random,
+                                          int k = 0) {
+    KllQuantileOptions options;
+    options.set_shared_random(random);
+    options.set_k(k);
+    return KllQuantile::Create(options);
+}
+
+// Checks that the quantiles and ranks of aggregator are close to those of the
+// values 0..num_values-1.
+void ExpectQuantilesOfRange(const KllQuantile& aggregator, int64_t num_values) {
+    EXPECT_EQ(aggregator.Quantile(0), 0);
+    EXPECT_EQ(aggregator.Quantile(1), num_values - 1);
+    for (double q = 0.05; q < 1; q += 0.05) {
+        const std::optional<int64_t> quantile = aggregator.Quantile(q);
+        ASSERT_TRUE(quantile.has_value());
+        EXPECT_NEAR(*quantile, q * num_values, kRankTolerance * num_values) << "q=" << q;
+        EXPECT_NEAR(aggregator.Rank(q * num_values), q, kRankTolerance) << "q=" << q;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------------- Tests for AddBatch ----------------------------- //
+
+TEST(KllQuantileAddBatchTest, SameAsAdd) {
+    std::vector<int64_t> values;
+    for (int i = 0; i < 50000; i++) {
+        values.push_back((i * 7919) % 10007 - 5000);
+    }
+    values.push_back(std::numeric_limits<int64_t>::min());
+    values.push_back(std::numeric_limits<int64_t>::max());
+
+    std::unique_ptr<KllQuantile> aggregator =
+            CreateSeeded(std::make_shared<XorShiftRandomGenerator>(/*seed=*/8));
+    std::unique_ptr<KllQuantile> batch_aggregator =
+            CreateSeeded(std::make_shared<XorShiftRandomGenerator>(/*seed=*/8));
+    for (const int64_t value : values) {
+        aggregator->Add(value);
+    }
+    batch_aggregator->AddBatch(values.data(), 3);
+    batch_aggregator->AddBatch(values.data() + 3, 0);
+    batch_aggregator->AddBatch(values.data() + 3, values.size() - 3);
+
+    EXPECT_EQ(batch_aggregator->num_values(), static_cast<int64_t>(values.size()));
+    EXPECT_EQ(batch_aggregator->Quantile(0), std::numeric_limits<int64_t>::min());
+    EXPECT_EQ(batch_aggregator->Quantile(1), std::numeric_limits<int64_t>::max());
+    EXPECT_EQ(aggregator->SerializeToProto().SerializeAsString(),
+              batch_aggregator->SerializeToProto().SerializeAsString());
+}
+
+TEST(KllQuantileAddBatchTest, MinMaxOfShortBatches) {
+    for (size_t num_values = 1; num_values < 20; num_values++) {
+        std::vector<int64_t> values;
+        for (size_t i = 0; i < num_values; i++) {
+            values.push_back((i * 37) % 11);
+        }
+        std::unique_ptr<KllQuantile> aggregator = KllQuantile::Create();
+        aggregator->AddBatch(values.data(), values.size());
+        EXPECT_EQ(aggregator->Quantile(0), *std::min_element(values.begin(), values.end()));
+        EXPECT_EQ(aggregator->Quantile(1), *std::max_element(values.begin(), values.end()));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ------------------ Tests for Merge, Quantile and Rank -------------------- //
+
+TEST(KllQuantileQueryTest, EmptyAggregator) {
+    std::unique_ptr<KllQuantile> aggregator = KllQuantile::Create();
+    EXPECT_EQ(aggregator->Quantile(0), std::nullopt);
+    EXPECT_EQ(aggregator->Quantile(0.5), std::nullopt);
+    EXPECT_EQ(aggregator->Rank(0), 0);
+}
+
+TEST(KllQuantileQueryTest, ExactBeforeCompaction) {
+    std::unique_ptr<KllQuantile> aggregator = KllQuantile::Create();
+    for (int i = 100; i >= 1; i--) {
+        aggregator->Add(i);
+    }
+    EXPECT_EQ(aggregator->Quantile(0), 1);
+    EXPECT_EQ(aggregator->Quantile(0.01), 1);
+    EXPECT_EQ(aggregator->Quantile(0.5), 50);
+    EXPECT_EQ(aggregator->Quantile(0.995), 100);
+    EXPECT_EQ(aggregator->Quantile(1), 100);
+    EXPECT_EQ(aggregator->Quantile(-0.1), std::nullopt);
+    EXPECT_EQ(aggregator->Quantile(1.1), std::nullopt);
+
+    EXPECT_EQ(aggregator->Rank(0), 0);
+    EXPECT_EQ(aggregator->Rank(1), 0.01);
+    EXPECT_EQ(aggregator->Rank(50), 0.5);
+    EXPECT_EQ(aggregator->Rank(100), 1);
+}
+
+TEST(KllQuantileQueryTest, WeightedValues) {
+    std::unique_ptr<KllQuantile> aggregator = KllQuantile::Create();
+    aggregator->AddWeighted(1, 3);
+    aggregator->AddWeighted(2, 1);
+    EXPECT_EQ(aggregator->Quantile(0.75), 1);
+    EXPECT_EQ(aggregator->Quantile(0.76), 2);
+    EXPECT_EQ(aggregator->Rank(1), 0.75);
+}
+
+TEST(KllQuantileQueryTest, ApproximateAfterCompaction) {
+    std::unique_ptr<KllQuantile> aggregator =
+            CreateSeeded(std::make_shared<XorShiftRandomGenerator>(/*seed=*/1));
+    const int64_t num_values = 1000000;
+    for (int64_t i = 0; i < num_values; i++) {
+        aggregator->Add((i * 7919) % num_values);
+    }
+    EXPECT_LT(aggregator->num_stored_values(), num_values / 10);
+    ExpectQuantilesOfRange(*aggregator, num_values);
+}
+
+TEST(KllQuantileMergeTest, MergeEmpty) {
+    std::unique_ptr<KllQuantile> aggregator = KllQuantile::Create();
+    std::unique_ptr<KllQuantile> empty = KllQuantile::Create();
+    aggregator->Add(5);
+    aggregator->Merge(*empty);
+    EXPECT_EQ(aggregator->num_values(), 1);
+    EXPECT_EQ(aggregator->Quantile(0.5), 5);
+
+    empty->Merge(*aggregator);
+    EXPECT_EQ(empty->num_values(), 1);
+    EXPECT_EQ(empty->Quantile(0), 5);
+    EXPECT_EQ(empty->Quantile(1), 5);
+}
+
+TEST(KllQuantileMergeTest, MergeIsExactBeforeCompaction) {
+    std::unique_ptr<KllQuantile> aggregator1 = KllQuantile::Create();
+    std::unique_ptr<KllQuantile> aggregator2 = KllQuantile::Create();
+    for (int i = 0; i < 50; i++) {
+        aggregator1->Add(2 * i);
+        aggregator2->Add(2 * i + 1);
+    }
+    aggregator1->Merge(*aggregator2);
+    EXPECT_EQ(aggregator1->num_values(), 100);
+    EXPECT_EQ(aggregator1->num_stored_values(), 100);
+    EXPECT_EQ(aggregator1->Quantile(0), 0);
+    EXPECT_EQ(aggregator1->Quantile(0.5), 49);
+    EXPECT_EQ(aggregator1->Quantile(1), 99);
+    // other is not modified.
+    EXPECT_EQ(aggregator2->num_values(), 50);
+    EXPECT_EQ(aggregator2->Quantile(0), 1);
+}
+
+TEST(KllQuantileMergeTest, MergedSketchesMatchRange) {
+    const auto random = std::make_shared<XorShiftRandomGenerator>(/*seed=*/2);
+    const int num_sketches = 10;
+    const int64_t num_values = 1000000;
+    std::vector<std::unique_ptr<KllQuantile>> aggregators;
+    for (int i = 0; i < num_sketches; i++) {
+        aggregators.push_back(CreateSeeded(random));
+    }
+    // Interleave the values so that each sketch covers the whole range.
+    for (int64_t i = 0; i < num_values; i++) {
+        aggregators[i % num_sketches]->Add(i);
+    }
+
+    std::unique_ptr<KllQuantile> merged = CreateSeeded(random);
+    for (const auto& aggregator : aggregators) {
+        merged->Merge(*aggregator);
+    }
+    EXPECT_EQ(merged->num_values(), num_values);
+    ExpectQuantilesOfRange(*merged, num_values);
+}
+
+TEST(KllQuantileMergeTest, MergeDisjointRanges) {
+    const auto random = std::make_shared<XorShiftRandomGenerator>(/*seed=*/3);
+    const int64_t num_values = 200000;
+    std::unique_ptr<KllQuantile> lower = CreateSeeded(random);
+    std::unique_ptr<KllQuantile> upper = CreateSeeded(random);
+    for (int64_t i = 0; i < num_values / 2; i++) {
+        lower->Add(i);
+        upper->Add(num_values / 2 + i);
+    }
+    upper->Merge(*lower);
+    EXPECT_EQ(upper->num_values(), num_values);
+    ExpectQuantilesOfRange(*upper, num_values);
+}
+
+TEST(KllQuantileMergeTest, MergeWithSampler) {
+    // Small k so that both sketches use the sampler.
+    const auto random = std::make_shared<XorShiftRandomGenerator>(/*seed=*/4);
+    const int64_t num_values = 200000;
+    std::unique_ptr<KllQuantile> aggregator1 = CreateSeeded(random, /*k=*/64);
+    std::unique_ptr<KllQuantile> aggregator2 = CreateSeeded(random, /*k=*/16);
+    for (int64_t i = 0; i < num_values / 2; i++) {
+        aggregator1->Add(2 * i);
+        aggregator2->Add(2 * i + 1);
+    }
+    ASSERT_TRUE(aggregator2->IsSamplerOn());
+    aggregator1->Merge(*aggregator2);
+    EXPECT_EQ(aggregator1->num_values(), num_values);
+    EXPECT_EQ(aggregator1->k(), 64);
+    for (double q = 0.1; q < 1; q += 0.1) {
+        EXPECT_NEAR(*aggregator1->Quantile(q), q * num_values, 0.05 * num_values) << "q=" << q;
+    }
+}
+
+TEST(KllQuantileMergeTest, MergeWithItself) {
+    std::unique_ptr<KllQuantile> aggregator =
+            CreateSeeded(std::make_shared<XorShiftRandomGenerator>(/*seed=*/5));
+    const int64_t num_values = 100000;
+    for (int64_t i = 0; i < num_values; i++) {
+        aggregator->Add(i);
+    }
+    aggregator->Merge(*aggregator);
+    EXPECT_EQ(aggregator->num_values(), 2 * num_values);
+    ExpectQuantilesOfRange(*aggregator, num_values);
+}
+
+// Rolls up many small sketches, as when merging the dimensions of a metric,
+// and checks that the merged sketch stays bounded in size.
+TEST(KllQuantileMergeTest, MergeManySketches) {
+    const auto random = std::make_shared<XorShiftRandomGenerator>(/*seed=*/6);
+    const int num_sketches = 2000;
+    const int num_values_per_sketch = 500;
+    std::unique_ptr<KllQuantile> merged = CreateSeeded(random);
+    int64_t max_num_stored_values = 0;
+    for (int i = 0; i < num_sketches; i++) {
+        std::unique_ptr<KllQuantile> aggregator = CreateSeeded(random);
+        for (int j = 0; j < num_values_per_sketch; j++) {
+            aggregator->Add(j * num_sketches + i);
+        }
+        merged->Merge(*aggregator);
+        max_num_stored_values = std::max(max_num_stored_values, merged->num_stored_values());
+    }
+    const int64_t num_values = int64_t{num_sketches} * num_values_per_sketch;
+    EXPECT_EQ(merged->num_values(), num_values);
+    EXPECT_LT(max_num_stored_values, 4 * merged->k());
+    ExpectQuantilesOfRange(*merged, num_values);
+}
 }  // namespace
 
 }  // namespace aggregation
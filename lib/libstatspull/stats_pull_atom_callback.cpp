@@ -17,7 +17,7 @@
 #include <aidl/android/os/BnPullAtomCallback.h>
 #include <aidl/android/os/IPullAtomResultReceiver.h>
 #include <aidl/android/os/IStatsd.h>
-#include <aidl/android/util/StatsEventParcel.h>
+#include <aidl/android/util/StatsEventBulkParcel.h>
 #include <android/binder_auto_utils.h>
 #include <android/binder_ibinder.h>
 #include <android/binder_manager.h>
@@ -33,7 +33,7 @@ using Status = ::ndk::ScopedAStatus;
 using aidl::android::os::BnPullAtomCallback;
 using aidl::android::os::IPullAtomResultReceiver;
 using aidl::android::os::IStatsd;
-using aidl::android::util::StatsEventParcel;
+using aidl::android::util::StatsEventBulkParcel;
 using ::ndk::SharedRefBase;
 
 struct AStatsEventList {
@@ -118,24 +118,28 @@ class StatsPullAtomCallbackInternal : public BnPullAtomCallback {
         int successInt = mCallback(atomTag, &statsEventList, mCookie);
         bool success = successInt == AStatsManager_PULL_SUCCESS;
 
-        // Convert stats_events into StatsEventParcels.
-        std::vector<StatsEventParcel> parcels;
-
+        // Pack all stats_events into a single buffer, which avoids a heap allocation per event
+        // on both sides of the binder call.
+        StatsEventBulkParcel bulkParcel;
+        size_t totalSize = 0;
+        for (int i = 0; i < statsEventList.data.size(); i++) {
+            size_t size;
+            AStatsEvent_getBuffer(statsEventList.data[i], &size);
+            totalSize += size;
+        }
+        bulkParcel.buffer.reserve(totalSize);
+        bulkParcel.eventOffsets.reserve(statsEventList.data.size());
         for (int i = 0; i < statsEventList.data.size(); i++) {
             size_t size;
             uint8_t* buffer = AStatsEvent_getBuffer(statsEventList.data[i], &size);
-
-            StatsEventParcel p;
-            // vector.assign() creates a copy, but this is inevitable unless
-            // stats_event.h/c uses a vector as opposed to a buffer.
-            p.buffer.assign(buffer, buffer + size);
-            parcels.push_back(std::move(p));
+            bulkParcel.eventOffsets.push_back(bulkParcel.buffer.size());
+            bulkParcel.buffer.insert(bulkParcel.buffer.end(), buffer, buffer + size);
         }
 
-        Status status = resultReceiver->pullFinished(atomTag, success, parcels);
+        Status status = resultReceiver->pullFinishedBulk(atomTag, success, bulkParcel);
         if (!status.isOk()) {
-            std::vector<StatsEventParcel> emptyParcels;
-            resultReceiver->pullFinished(atomTag, /*success=*/false, emptyParcels);
+            StatsEventBulkParcel emptyParcel;
+            resultReceiver->pullFinishedBulk(atomTag, /*success=*/false, emptyParcel);
         }
         for (int i = 0; i < statsEventList.data.size(); i++) {
             AStatsEvent_release(statsEventList.data[i]);
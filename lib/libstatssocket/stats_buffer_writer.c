@@ -29,6 +29,7 @@
 #include "statsd_writer.h"
 
 static const uint32_t kStatsEventTag = 1937006964;
+static const uint32_t kStatsEventBatchTag = 1937006946;
 
 #ifdef _MSC_VER
 struct iovec {
@@ -96,6 +97,23 @@ int write_buffer_to_statsd_impl(void* buffer, size_t size, uint32_t atomId, bool
     return ret;
 }
 
+int write_batch_buffer_to_statsd_impl(const uint8_t* buffer, size_t size) {
+    struct iovec vecs[2];
+    vecs[0].iov_base = (void*)&kStatsEventBatchTag;
+    vecs[0].iov_len = sizeof(kStatsEventBatchTag);
+    vecs[1].iov_base = (void*)buffer;
+    vecs[1].iov_len = size;
+
+    return __write_to_statsd(vecs, 2);
+}
+
+int wait_for_statsd_socket_writable(int timeoutMs) {
+    if (!statsdLoggerWrite.waitWritable) {
+        return -ENODEV;
+    }
+    return (*statsdLoggerWrite.waitWritable)(timeoutMs);
+}
+
 static int __write_to_stats_daemon(struct iovec* vec, size_t nr) {
     int save_errno;
     struct timespec ts;
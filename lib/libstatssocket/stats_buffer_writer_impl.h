@@ -43,4 +43,17 @@ __BEGIN_DECLS
 
 int write_buffer_to_statsd_impl(void* buffer, size_t size, uint32_t atomId, bool doNoteDrop);
 
+/**
+ * Writes multiple atoms as a single datagram. The buffer holds a sequence of
+ * |uint32_t size|StatsEvent buffer| records and is prefixed on the wire by the batch tag.
+ */
+int write_batch_buffer_to_statsd_impl(const uint8_t* buffer, size_t size);
+
+/**
+ * Waits up to timeoutMs for the statsd socket to accept more datagrams.
+ *
+ * @return 1 if the socket is writable, 0 on timeout, or -errno
+ */
+int wait_for_statsd_socket_writable(int timeoutMs);
+
 __END_DECLS
@@ -21,15 +21,31 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <chrono>
-#include <queue>
+#include <cstring>
 #include <thread>
 
 #include "stats_buffer_writer_impl.h"
 #include "stats_buffer_writer_queue_impl.h"
 #include "utils.h"
 
-BufferWriterQueue::BufferWriterQueue() : mWorkThread(&BufferWriterQueue::processCommands, this) {
+namespace {
+
+constexpr size_t kRecordAlignment = sizeof(uint64_t);
+
+size_t alignRecordSize(size_t size) {
+    return (size + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+}
+
+}  // namespace
+
+BufferWriterQueue::BufferWriterQueue(bool batchingEnabled)
+    : mRing(new uint8_t[kRingBufferSize]()),
+      mBatchingEnabled(batchingEnabled),
+      mWorkThread(&BufferWriterQueue::processCommands, this) {
+    static_assert(sizeof(RecordHeader) == kRecordAlignment, "RecordHeader must be 8 bytes");
+    static_assert(kRingBufferSize % kRecordAlignment == 0, "Ring size must be 8-byte aligned");
     #ifndef _MSC_VER
     pthread_setname_np(mWorkThread.native_handle(), "socket_writer_queue");
     #endif
@@ -37,125 +53,286 @@ BufferWriterQueue::BufferWriterQueue() : mWorkThread(&BufferWriterQueue::process
 
 BufferWriterQueue::~BufferWriterQueue() {
     terminate();
-    // at this stage there can be N elements in the queue for which memory needs to be freed
-    // explicitly
+    // at this stage there can be N records in the ring which were never written
     drainQueue();
 }
 
+BufferWriterQueue::RecordHeader* BufferWriterQueue::recordAt(uint64_t position) const {
+    return reinterpret_cast<RecordHeader*>(mRing.get() + position % kRingBufferSize);
+}
+
 bool BufferWriterQueue::write(const uint8_t* buffer, size_t size, uint32_t atomId) {
-    Cmd cmd = createWriteBufferCmd(buffer, size, atomId);
-    if (cmd.buffer == NULL) {
+    RecordHeader* record = reserveRecord(size);
+    if (record == nullptr) {
         return false;
     }
-    return pushToQueue(cmd);
+    publishRecord(record, buffer, size, atomId);
+    return true;
 }
 
-size_t BufferWriterQueue::getQueueSize() const {
-    std::unique_lock<std::mutex> lock(mMutex);
-    return mCmdQueue.size();
-}
+BufferWriterQueue::RecordHeader* BufferWriterQueue::reserveRecord(size_t size) {
+    const size_t recordSize = alignRecordSize(sizeof(RecordHeader) + size);
+    if (size == 0 || size > kRecordSizeMask || recordSize > kRingBufferSize / 2) {
+        return nullptr;
+    }
 
-bool BufferWriterQueue::pushToQueue(const Cmd& cmd) {
-    {
-        std::unique_lock<std::mutex> lock(mMutex);
-        if (mCmdQueue.size() >= kQueueMaxSizeLimit) {
-            // TODO (b/258003151): add logging info about internal queue overflow with appropriate
-            // error code
-            return false;
+    if (mQueueSize.fetch_add(1, std::memory_order_relaxed) >= kQueueMaxSizeLimit) {
+        // TODO (b/258003151): add logging info about internal queue overflow with appropriate
+        // error code
+        mQueueSize.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    uint64_t head = mHead.load(std::memory_order_relaxed);
+    uint64_t position;
+    uint64_t nextHead;
+    do {
+        // a record never wraps around the ring end, the remaining space is padded instead
+        const size_t contiguous = kRingBufferSize - head % kRingBufferSize;
+        position = recordSize <= contiguous ? head : head + contiguous;
+        nextHead = position + recordSize;
+        if (nextHead - mTail.load(std::memory_order_acquire) > kRingBufferSize) {
+            mQueueSize.fetch_sub(1, std::memory_order_relaxed);
+            return nullptr;
         }
-        mCmdQueue.push(cmd);
+    } while (!mHead.compare_exchange_weak(head, nextHead, std::memory_order_acq_rel,
+                                          std::memory_order_relaxed));
+
+    if (position != head) {
+        RecordHeader* padding = recordAt(head);
+        padding->atomId = 0;
+        padding->state.store((position - head) | kRecordPadding | kRecordPublished,
+                             std::memory_order_release);
     }
-    mCondition.notify_one();
-    return true;
+
+    // the reserved record keeps the zeroed state of the ring until it is published
+    return recordAt(position);
 }
 
-BufferWriterQueue::Cmd BufferWriterQueue::createWriteBufferCmd(const uint8_t* buffer, size_t size,
-                                                               uint32_t atomId) {
-    BufferWriterQueue::Cmd writeCmd;
-    writeCmd.atomId = atomId;
-    writeCmd.buffer = (uint8_t*)malloc(size);
-    if (writeCmd.buffer == NULL) {
-        return writeCmd;
+void BufferWriterQueue::publishRecord(RecordHeader* record, const uint8_t* buffer, size_t size,
+                                      uint32_t atomId) {
+    record->atomId = atomId;
+    memcpy(reinterpret_cast<uint8_t*>(record) + sizeof(RecordHeader), buffer, size);
+    record->state.store(size | kRecordPublished, std::memory_order_release);
+
+    notifyWorker();
+}
+
+size_t BufferWriterQueue::getQueueSize() const {
+    return mQueueSize.load(std::memory_order_relaxed);
+}
+
+void BufferWriterQueue::notifyWorker() {
+    // pairs with the fence in waitForRecords() so either the worker observes the published
+    // record or this thread observes the worker waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mWorkerWaiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mWakeupMutex);
+        mWakeupCondition.notify_one();
     }
-    memcpy(writeCmd.buffer, buffer, size);
-    writeCmd.size = size;
-    return writeCmd;
+}
+
+void BufferWriterQueue::waitForRecords() {
+    std::unique_lock<std::mutex> lock(mWakeupMutex);
+    mWorkerWaiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    mWakeupCondition.wait(lock, [this] {
+        const uint64_t tail = mTail.load(std::memory_order_relaxed);
+        return mDoTerminate ||
+               (tail != mHead.load(std::memory_order_acquire) &&
+                recordAt(tail)->state.load(std::memory_order_acquire) != 0);
+    });
+    mWorkerWaiting.store(false, std::memory_order_relaxed);
 }
 
 void BufferWriterQueue::terminate() {
     if (mWorkThread.joinable()) {
         mDoTerminate = true;
-        Cmd terminateCmd;
-        terminateCmd.buffer = NULL;
-        pushToQueue(terminateCmd);
+        {
+            std::lock_guard<std::mutex> lock(mWakeupMutex);
+            mWakeupCondition.notify_one();
+        }
         mWorkThread.join();
     }
 }
 
 void BufferWriterQueue::drainQueue() {
-    std::unique_lock<std::mutex> lock(mMutex);
-    while (!mCmdQueue.empty()) {
-        free(mCmdQueue.front().buffer);
-        mCmdQueue.pop();
+    std::lock_guard<std::mutex> lock(mConsumerMutex);
+    uint64_t position = mTail.load(std::memory_order_relaxed);
+    const uint64_t head = mHead.load(std::memory_order_acquire);
+    int32_t atomsCount = 0;
+    while (position != head) {
+        const uint32_t state = recordAt(position)->state.load(std::memory_order_acquire);
+        if (state == 0) {
+            // reserved by a producer which has not published it yet
+            break;
+        }
+        if (state & kRecordPadding) {
+            position += state & kRecordSizeMask;
+        } else {
+            position += alignRecordSize(sizeof(RecordHeader) + (state & kRecordSizeMask));
+            atomsCount++;
+        }
     }
+    releaseRecords(position, atomsCount);
+}
+
+void BufferWriterQueue::releaseRecords(uint64_t position, int32_t atomsCount) {
+    const uint64_t tail = mTail.load(std::memory_order_relaxed);
+    // producers rely on zeroed memory to tell not yet published records apart
+    const size_t length = position - tail;
+    const size_t offset = tail % kRingBufferSize;
+    const size_t firstChunk = std::min(length, kRingBufferSize - offset);
+    memset(mRing.get() + offset, 0, firstChunk);
+    memset(mRing.get(), 0, length - firstChunk);
+
+    mTail.store(position, std::memory_order_release);
+    mQueueSize.fetch_sub(atomsCount, std::memory_order_relaxed);
 }
 
 void BufferWriterQueue::processCommands() {
+    int delayOnFailedWriteMs = kDelayOnFailedWriteMs;
     while (true) {
-        // temporary local thread copy
-        Cmd cmd;
-        {
-            std::unique_lock<std::mutex> lock(mMutex);
-            if (mCmdQueue.empty()) {
-                mCondition.wait(lock, [this] { return !this->mCmdQueue.empty(); });
-            }
-            cmd = mCmdQueue.front();
+        waitForRecords();
+        if (mDoTerminate) {
+            return;
         }
 
-        if (cmd.buffer == NULL) {
-            // null buffer ptr used as a marker of the termination request
+        if (mBatchingEnabled && mHead.load(std::memory_order_relaxed) -
+                                                mTail.load(std::memory_order_relaxed) <
+                                        kBatchMaxSize) {
+            // give the client a short window to log more atoms into the same datagram
+            std::this_thread::sleep_for(std::chrono::milliseconds(kBatchFlushDelayMs));
+        }
+
+        const bool writeSuccess = drainPublishedRecords();
+        // TODO (b/258003151): add logging info about retry count
+
+        if (mDoTerminate) {
             return;
         }
 
-        const bool writeSuccess = handleCommand(cmd);
         if (writeSuccess) {
-            // no event drop is observed otherwise command remains in the queue
-            // and worker thread will try to log later on
-
-            // call free() explicitly here to free memory before the mutex lock
-            free(cmd.buffer);
-            {
-                std::unique_lock<std::mutex> lock(mMutex);
-                // this will lead to Cmd destructor call which will be no-op since now the
-                // buffer is NULL
-                mCmdQueue.pop();
+            delayOnFailedWriteMs = kDelayOnFailedWriteMs;
+            continue;
+        }
+
+        // failed write is most likely due to socket overflow, resume as soon as statsd
+        // drained the socket while backing off further on consecutive failures
+        waitForSocketWritable(delayOnFailedWriteMs);
+        delayOnFailedWriteMs = std::min(delayOnFailedWriteMs * 2, kMaxDelayOnFailedWriteMs);
+    }
+}
+
+bool BufferWriterQueue::drainPublishedRecords() {
+    std::lock_guard<std::mutex> lock(mConsumerMutex);
+    uint64_t position = mTail.load(std::memory_order_relaxed);
+    const uint64_t head = mHead.load(std::memory_order_acquire);
+    while (position != head) {
+        RecordHeader* record = recordAt(position);
+        const uint32_t state = record->state.load(std::memory_order_acquire);
+        if (state == 0) {
+            // reserved by a producer which has not published it yet
+            break;
+        }
+        if (state & kRecordPadding) {
+            position += state & kRecordSizeMask;
+            releaseRecords(position, 0);
+            continue;
+        }
+
+        if (mBatchingEnabled) {
+            size_t batchSize = 0;
+            int32_t atomsCount = 0;
+            const uint64_t nextPosition = fillBatch(position, head, batchSize, atomsCount);
+            if (atomsCount > 0) {
+                // on failure the records stay in the ring and write will be retried
+                if (!handleBatch(mBatch, batchSize)) {
+                    return false;
+                }
+                position = nextPosition;
+                releaseRecords(position, atomsCount);
+                continue;
             }
+            // the atom does not fit into a batch, written as a regular datagram below
         }
-        // TODO (b/258003151): add logging info about retry count
 
-        if (mDoTerminate) {
-            return;
+        Cmd cmd;
+        cmd.buffer = reinterpret_cast<const uint8_t*>(record + 1);
+        cmd.atomId = record->atomId;
+        cmd.size = state & kRecordSizeMask;
+        if (!handleCommand(cmd)) {
+            // no event drop is observed, the record remains in the ring and worker thread will
+            // try to log later on
+            return false;
         }
+        position += alignRecordSize(sizeof(RecordHeader) + cmd.size);
+        releaseRecords(position, 1);
+    }
+    return true;
+}
 
-        // attempt to enforce the logging frequency constraints
-        // in case of failed write due to socket overflow the sleep can be longer
-        // to not overload socket continuously
-        if (!writeSuccess) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(kDelayOnFailedWriteMs));
+uint64_t BufferWriterQueue::fillBatch(uint64_t position, uint64_t head, size_t& batchSize,
+                                      int32_t& atomsCount) {
+    batchSize = 0;
+    atomsCount = 0;
+    uint64_t batchEnd = position;
+    while (position != head) {
+        const RecordHeader* record = recordAt(position);
+        const uint32_t state = record->state.load(std::memory_order_acquire);
+        if (state == 0) {
+            break;
         }
+        if (state & kRecordPadding) {
+            position += state & kRecordSizeMask;
+            continue;
+        }
+        const uint32_t atomSize = state & kRecordSizeMask;
+        if (batchSize + sizeof(atomSize) + atomSize > kBatchMaxSize) {
+            break;
+        }
+        memcpy(mBatch + batchSize, &atomSize, sizeof(atomSize));
+        memcpy(mBatch + batchSize + sizeof(atomSize), record + 1, atomSize);
+        batchSize += sizeof(atomSize) + atomSize;
+        atomsCount++;
+        position += alignRecordSize(sizeof(RecordHeader) + atomSize);
+        batchEnd = position;
     }
+    return batchEnd;
+}
+
+bool BufferWriterQueue::handleBatch(const uint8_t* buffer, size_t size) const {
+    // skip log drop if occurs, since the records remain in the ring and write will be retried
+    return write_batch_buffer_to_statsd_impl(buffer, size) > 0;
 }
 
 bool BufferWriterQueue::handleCommand(const Cmd& cmd) const {
     // skip log drop if occurs, since the atom remains in the queue and write will be retried
-    return write_buffer_to_statsd_impl(cmd.buffer, cmd.size, cmd.atomId, /*doNoteDrop*/ false) > 0;
+    return write_buffer_to_statsd_impl(const_cast<uint8_t*>(cmd.buffer), cmd.size, cmd.atomId,
+                                       /*doNoteDrop*/ false) > 0;
+}
+
+void BufferWriterQueue::waitForSocketWritable(int timeoutMs) const {
+    if (wait_for_statsd_socket_writable(timeoutMs) != 0) {
+        // writable socket does not guarantee the next datagram is accepted, still give statsd a
+        // moment to drain it to not spin on consecutive failed writes
+        std::this_thread::sleep_for(std::chrono::milliseconds(kDelayOnFailedWriteMs));
+    }
 }
 
 bool write_buffer_to_statsd_queue(const uint8_t* buffer, size_t size, uint32_t atomId) {
-    static BufferWriterQueue queue;
+    static BufferWriterQueue queue(should_batch_queue_writes());
     return queue.write(buffer, size, atomId);
 }
 
+bool should_batch_queue_writes() {
+#ifdef ENABLE_BATCHED_WRITES
+    return true;
+#else
+    return false;
+#endif  // ENABLE_BATCHED_WRITES
+}
+
 #ifdef ENABLE_BENCHMARK_SUPPORT
 bool should_write_via_queue(uint32_t atomId) {
 #else
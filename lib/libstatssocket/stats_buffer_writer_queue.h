@@ -45,4 +45,10 @@ bool write_buffer_to_statsd_queue(const uint8_t* buffer, size_t size, uint32_t a
 
 bool should_write_via_queue(uint32_t atomId);
 
+/**
+ * Batched writes pack multiple queued atoms into one datagram. Requires statsd to support the
+ * batched wire format, hence opt-in via the ENABLE_BATCHED_WRITES build flag.
+ */
+bool should_batch_queue_writes();
+
 __END_DECLS
@@ -19,15 +19,37 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#include <queue>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <thread>
 
+/**
+ * Multi-producer single-consumer queue of atom buffers backed by a preallocated byte ring.
+ * Producers reserve space with a CAS on the ring head and publish the record by setting its
+ * header state, so write() never blocks and never allocates. The worker thread drains all
+ * published records per wakeup and backs off on socket overflow by polling the socket for
+ * POLLOUT with an increasing timeout.
+ */
 class BufferWriterQueue {
 public:
-    constexpr static int kDelayOnFailedWriteMs = 5;
+    // Initial and max backoff applied after a failed socket write
+    constexpr static int kDelayOnFailedWriteMs = 1;
+    constexpr static int kMaxDelayOnFailedWriteMs = 64;
     constexpr static int kQueueMaxSizeLimit = 4800;  // 2X max_dgram_qlen
+    constexpr static size_t kRingBufferSize = 512 * 1024;
+
+    // Batched mode: time a partially filled datagram waits for more atoms before the flush
+    constexpr static int kBatchFlushDelayMs = 2;
+    // LOGGER_ENTRY_MAX_PAYLOAD minus the 4-byte batch tag
+    constexpr static size_t kBatchMaxSize = 4068 - sizeof(uint32_t);
 
-    BufferWriterQueue();
+    /**
+     * @param batchingEnabled when true, the worker packs consecutive queued atoms into a single
+     *        datagram, see write_batch_buffer_to_statsd_impl() for the wire format
+     */
+    explicit BufferWriterQueue(bool batchingEnabled = false);
     virtual ~BufferWriterQueue();
 
     bool write(const uint8_t* buffer, size_t size, uint32_t atomId);
@@ -37,25 +59,95 @@ public:
     void drainQueue();
 
     struct Cmd {
-        uint8_t* buffer = NULL;
+        const uint8_t* buffer = NULL;
         int atomId = 0;
         int size = 0;
     };
 
     virtual bool handleCommand(const Cmd& cmd) const;
 
+    virtual bool handleBatch(const uint8_t* buffer, size_t size) const;
+
+    /**
+     * Blocks until the statsd socket is writable or timeoutMs elapses
+     */
+    virtual void waitForSocketWritable(int timeoutMs) const;
+
+protected:
+    // Each ring record starts with the header, record boundaries are 8-byte aligned
+    struct RecordHeader {
+        // 0 while the record is being written, payload size | flags once published
+        std::atomic<uint32_t> state;
+        uint32_t atomId;
+    };
+
+    /**
+     * Reserves ring space for a record with a payload of size bytes. The consumers stop at the
+     * record until it is published, they rely on the ring being zeroed to tell it apart.
+     *
+     * @return nullptr if the queue or the ring is full
+     */
+    RecordHeader* reserveRecord(size_t size);
+
+    /**
+     * Copies the atom into the reserved record and makes it visible to the consumers
+     */
+    void publishRecord(RecordHeader* record, const uint8_t* buffer, size_t size, uint32_t atomId);
+
 private:
-    std::condition_variable mCondition;
-    mutable std::mutex mMutex;
-    std::queue<Cmd> mCmdQueue;
+    constexpr static uint32_t kRecordPublished = 1u << 31;
+    constexpr static uint32_t kRecordPadding = 1u << 30;
+    constexpr static uint32_t kRecordSizeMask = kRecordPadding - 1;
+
+    const std::unique_ptr<uint8_t[]> mRing;
+    // monotonic positions, ring offset is position % kRingBufferSize
+    std::atomic<uint64_t> mHead = 0;
+    std::atomic<uint64_t> mTail = 0;
+    std::atomic<int32_t> mQueueSize = 0;
+
+    // serializes the consumers, i.e. the worker thread and drainQueue()
+    std::mutex mConsumerMutex;
+
+    // only used to park the worker thread when the ring is empty
+    std::mutex mWakeupMutex;
+    std::condition_variable mWakeupCondition;
+    std::atomic_bool mWorkerWaiting = false;
+
     std::atomic_bool mDoTerminate = false;
+    const bool mBatchingEnabled;
+
+    // accessed by the consumer only, holds |uint32_t size|atom buffer| records
+    uint8_t mBatch[kBatchMaxSize];
+
     std::thread mWorkThread;
 
-    static Cmd createWriteBufferCmd(const uint8_t* buffer, size_t size, uint32_t atomId);
+    RecordHeader* recordAt(uint64_t position) const;
 
-    bool pushToQueue(const Cmd& cmd);
+    void notifyWorker();
+
+    void waitForRecords();
 
     void terminate();
 
     void processCommands();
+
+    /**
+     * Writes published records to the socket in ring order until the ring is empty or a write
+     * fails, and releases the ring space of the written ones.
+     *
+     * @return false if a socket write failed
+     */
+    bool drainPublishedRecords();
+
+    /**
+     * Packs published records starting at position into mBatch.
+     *
+     * @return position past the last packed record
+     */
+    uint64_t fillBatch(uint64_t position, uint64_t head, size_t& batchSize, int32_t& atomsCount);
+
+    /**
+     * Returns the ring space up to position to the producers
+     */
+    void releaseRecords(uint64_t position, int32_t atomsCount);
 };
@@ -78,6 +78,7 @@ static void statsdClose();
 static int statsdWrite(struct timespec* ts, struct iovec* vec, size_t nr);
 static void statsdNoteDrop(int error, int tag);
 static int statsdIsClosed();
+static int statsdWaitWritable(int timeoutMs);
 
 struct android_log_transport_write statsdLoggerWrite = {
         .name = "statsd",
@@ -88,6 +89,7 @@ struct android_log_transport_write statsdLoggerWrite = {
         .write = statsdWrite,
         .noteDrop = statsdNoteDrop,
         .isClosed = statsdIsClosed,
+        .waitWritable = statsdWaitWritable,
 };
 
 /* log_init_lock assumed */
@@ -179,6 +181,27 @@ static int statsdIsClosed() {
     return 0;
 }
 
+static int statsdWaitWritable(int timeoutMs) {
+    int sock = atomic_load(&statsdLoggerWrite.sock);
+    if (sock < 0) {
+        // nothing to poll while disconnected, reconnect is attempted on the next write
+        usleep(timeoutMs * 1000);
+        return 0;
+    }
+
+    // For unix datagram sockets POLLOUT also accounts for the receive queue of the peer, i.e.
+    // reports when statsd has room for more datagrams.
+    struct pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    int ret = TEMP_FAILURE_RETRY(poll(&pfd, 1, timeoutMs));
+    if (ret < 0) {
+        return -errno;
+    }
+    return (ret > 0 && (pfd.revents & POLLOUT)) ? 1 : 0;
+}
+
 static int statsdWrite(struct timespec* ts, struct iovec* vec, size_t nr) {
     ssize_t ret;
     int sock;
@@ -68,6 +68,9 @@ struct android_log_transport_write {
     void (*noteDrop)(int error, int tag);
     /* checks if the socket is closed */
     int (*isClosed)();
+    /* waits up to timeoutMs for the transport to become writable, returns 1 if writable,
+       0 on timeout, or -errno */
+    int (*waitWritable)(int timeoutMs);
 };
 
 __END_DECLS
@@ -17,7 +17,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 
 #include "stats_buffer_writer_queue_impl.h"
 #include "stats_event.h"
@@ -26,6 +28,8 @@
 using testing::_;
 using testing::AnyNumber;
 using testing::DoAll;
+using testing::Field;
+using testing::InSequence;
 using testing::Return;
 using testing::StrictMock;
 
@@ -47,8 +51,31 @@ public:
     MOCK_METHOD(bool, handleCommand, (const BufferWriterQueue::Cmd& cmd), (const override));
 };
 
+class BackoffBufferWriterQueueMock : public BufferWriterQueue {
+public:
+    BackoffBufferWriterQueueMock() = default;
+    MOCK_METHOD(bool, handleCommand, (const BufferWriterQueue::Cmd& cmd), (const override));
+    MOCK_METHOD(void, waitForSocketWritable, (int timeoutMs), (const override));
+};
+
 typedef StrictMock<BasicBufferWriterQueueMock> BufferWriterQueueMock;
 
+class BatchedBufferWriterQueueMock : public BufferWriterQueue {
+public:
+    BatchedBufferWriterQueueMock() : BufferWriterQueue(/*batchingEnabled*/ true) {
+    }
+    MOCK_METHOD(bool, handleCommand, (const BufferWriterQueue::Cmd& cmd), (const override));
+    MOCK_METHOD(bool, handleBatch, (const uint8_t* buffer, size_t size), (const override));
+};
+
+class ReservingBufferWriterQueueMock : public BufferWriterQueue {
+public:
+    ReservingBufferWriterQueueMock() = default;
+    MOCK_METHOD(bool, handleCommand, (const BufferWriterQueue::Cmd& cmd), (const override));
+    using BufferWriterQueue::publishRecord;
+    using BufferWriterQueue::reserveRecord;
+};
+
 }  // namespace
 
 TEST(StatsBufferWriterQueueTest, TestWriteSuccess) {
@@ -168,3 +195,146 @@ TEST(StatsBufferWriterQueueTest, TestTerminateNonEmptyQueue) {
     queue.drainQueue();
     EXPECT_EQ(queue.getQueueSize(), 0);
 }
+
+TEST(StatsBufferWriterQueueTest, TestBatchedWrite) {
+    AStatsEvent* event = generateTestEvent();
+
+    size_t eventBufferSize = 0;
+    const uint8_t* buffer = AStatsEvent_getBuffer(event, &eventBufferSize);
+    EXPECT_TRUE(buffer != nullptr);
+
+    const uint32_t atomId = AStatsEvent_getAtomId(event);
+    const size_t recordSize = sizeof(uint32_t) + eventBufferSize;
+    const int atomsPerBatch = BufferWriterQueue::kBatchMaxSize / recordSize;
+    const int atomsCount = atomsPerBatch + 1;
+
+    int batchedAtomsCount = 0;
+    StrictMock<BatchedBufferWriterQueueMock> queue;
+    EXPECT_CALL(queue, handleBatch(_, _))
+            .WillRepeatedly([&](const uint8_t* batch, size_t size) {
+                // each record is |uint32_t size|atom buffer|
+                size_t offset = 0;
+                while (offset < size) {
+                    uint32_t atomSize = 0;
+                    memcpy(&atomSize, batch + offset, sizeof(atomSize));
+                    EXPECT_EQ(atomSize, eventBufferSize);
+                    EXPECT_EQ(0, memcmp(batch + offset + sizeof(atomSize), buffer, atomSize));
+                    offset += sizeof(atomSize) + atomSize;
+                    batchedAtomsCount++;
+                }
+                EXPECT_EQ(offset, size);
+                EXPECT_LE(size, BufferWriterQueue::kBatchMaxSize);
+                return true;
+            });
+
+    for (int i = 0; i < atomsCount; i++) {
+        EXPECT_TRUE(queue.write(buffer, eventBufferSize, atomId));
+    }
+    // to yeld to the queue worker thread
+    std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+    AStatsEvent_release(event);
+
+    EXPECT_EQ(batchedAtomsCount, atomsCount);
+    EXPECT_EQ(queue.getQueueSize(), 0);
+}
+
+TEST(StatsBufferWriterQueueTest, TestDrainMultipleAtomsPerWakeup) {
+    AStatsEvent* event = generateTestEvent();
+
+    size_t eventBufferSize = 0;
+    const uint8_t* buffer = AStatsEvent_getBuffer(event, &eventBufferSize);
+    EXPECT_TRUE(buffer != nullptr);
+
+    const uint32_t atomId = AStatsEvent_getAtomId(event);
+    const int atomsCount = 100;
+
+    BufferWriterQueueMock queue;
+    EXPECT_CALL(queue, handleCommand(_))
+            .Times(atomsCount)
+            .WillRepeatedly([&](const BufferWriterQueue::Cmd& cmd) {
+                // the command references the atom copy in the ring
+                EXPECT_EQ(cmd.atomId, atomId);
+                EXPECT_EQ(cmd.size, (int)eventBufferSize);
+                EXPECT_EQ(0, memcmp(cmd.buffer, buffer, cmd.size));
+                return true;
+            });
+
+    for (int i = 0; i < atomsCount; i++) {
+        EXPECT_TRUE(queue.write(buffer, eventBufferSize, atomId));
+    }
+    // to yeld to the queue worker thread
+    std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+    AStatsEvent_release(event);
+
+    EXPECT_EQ(queue.getQueueSize(), 0);
+}
+
+TEST(StatsBufferWriterQueueTest, TestAdaptiveBackoff) {
+    AStatsEvent* event = generateTestEvent();
+
+    size_t eventBufferSize = 0;
+    const uint8_t* buffer = AStatsEvent_getBuffer(event, &eventBufferSize);
+    EXPECT_TRUE(buffer != nullptr);
+
+    const uint32_t atomId = AStatsEvent_getAtomId(event);
+
+    const int failedWritesCount = 10;
+    std::vector<int> backoffTimeouts;
+
+    StrictMock<BackoffBufferWriterQueueMock> queue;
+    int writeAttempts = 0;
+    EXPECT_CALL(queue, handleCommand(_)).WillRepeatedly([&](const BufferWriterQueue::Cmd&) {
+        return ++writeAttempts > failedWritesCount;
+    });
+    EXPECT_CALL(queue, waitForSocketWritable(_)).WillRepeatedly([&](int timeoutMs) {
+        backoffTimeouts.push_back(timeoutMs);
+    });
+
+    EXPECT_TRUE(queue.write(buffer, eventBufferSize, atomId));
+    // to yeld to the queue worker thread
+    std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+    AStatsEvent_release(event);
+
+    EXPECT_EQ(queue.getQueueSize(), 0);
+    ASSERT_EQ(backoffTimeouts.size(), failedWritesCount);
+    EXPECT_EQ(backoffTimeouts[0], BufferWriterQueue::kDelayOnFailedWriteMs);
+    for (int i = 1; i < backoffTimeouts.size(); i++) {
+        EXPECT_EQ(backoffTimeouts[i], std::min(backoffTimeouts[i - 1] * 2,
+                                               BufferWriterQueue::kMaxDelayOnFailedWriteMs));
+    }
+}
+
+TEST(StatsBufferWriterQueueTest, TestDrainWithUnpublishedRecord) {
+    AStatsEvent* event = generateTestEvent();
+
+    size_t eventBufferSize = 0;
+    const uint8_t* buffer = AStatsEvent_getBuffer(event, &eventBufferSize);
+    EXPECT_TRUE(buffer != nullptr);
+
+    StrictMock<ReservingBufferWriterQueueMock> queue;
+    // a producer reserved the first record but did not publish it yet
+    auto record = queue.reserveRecord(eventBufferSize);
+    ASSERT_TRUE(record != nullptr);
+    EXPECT_TRUE(queue.write(buffer, eventBufferSize, /*atomId*/ 2));
+    // to yeld to the queue worker thread
+    std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+
+    // neither the worker nor drainQueue() go past the unpublished record
+    EXPECT_EQ(queue.getQueueSize(), 2);
+    queue.drainQueue();
+    EXPECT_EQ(queue.getQueueSize(), 2);
+
+    {
+        InSequence seq;
+        EXPECT_CALL(queue, handleCommand(Field(&BufferWriterQueue::Cmd::atomId, 1)))
+                .WillOnce(Return(true));
+        EXPECT_CALL(queue, handleCommand(Field(&BufferWriterQueue::Cmd::atomId, 2)))
+                .WillOnce(Return(true));
+    }
+    queue.publishRecord(record, buffer, eventBufferSize, /*atomId*/ 1);
+    // to yeld to the queue worker thread
+    std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+    AStatsEvent_release(event);
+
+    EXPECT_EQ(queue.getQueueSize(), 0);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+#include "tests/statsd_test_util.h"
+
+using namespace std;
+namespace android {
+namespace os {
+namespace statsd {
+
+namespace {
+
+const int kNumConfigs = 8;
+const int kNumMetricsPerConfig = 100;
+const int kNumEvents = 100;
+
+StatsdConfig createHeavyConfig() {
+    StatsdConfig config;
+    auto wakelockAcquireMatcher = CreateAcquireWakelockAtomMatcher();
+    *config.add_atom_matcher() = wakelockAcquireMatcher;
+    for (int i = 0; i < kNumMetricsPerConfig; i++) {
+        CountMetric metric = createCountMetric("Count" + to_string(i), wakelockAcquireMatcher.id(),
+                                               /* condition */ nullopt, /* states */ {});
+        *metric.mutable_dimensions_in_what() =
+                CreateAttributionUidDimensions(util::WAKELOCK_STATE_CHANGED, {Position::FIRST});
+        *config.add_count_metric() = metric;
+    }
+    return config;
+}
+
+}  // anonymous namespace
+
+// End to end OnLogEvent throughput with kNumConfigs configs that all use the logged atom, spread
+// over state.range(0) event workers.
+static void BM_OnLogEventWithEventWorkers(benchmark::State& state) {
+    const StatsdConfig config = createHeavyConfig();
+    sp<StatsLogProcessor> processor =
+            CreateStatsLogProcessor(/*timeBaseNs=*/1, /*currentTimeNs=*/1, config, ConfigKey(0, 0));
+    for (int i = 1; i < kNumConfigs; i++) {
+        processor->OnConfigUpdated(/*timestampNs=*/1, ConfigKey(0, i), config);
+    }
+    processor->setEventWorkerCount(state.range(0));
+
+    std::vector<std::unique_ptr<LogEvent>> events;
+    vector<string> attributionTags = {"App1"};
+    for (int i = 0; i < kNumEvents; i++) {
+        vector<int> attributionUids = {1000 + i % 20};
+        events.push_back(CreateAcquireWakelockEvent(2 + i, attributionUids, attributionTags,
+                                                    "wl" + to_string(i)));
+    }
+
+    for (auto _ : state) {
+        for (const auto& event : events) {
+            processor->OnLogEvent(event.get());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumEvents);
+}
+BENCHMARK(BM_OnLogEventWithEventWorkers)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -67,6 +67,23 @@ static void BM_FilterValue(benchmark::State& state) {
 
 BENCHMARK(BM_FilterValue);
 
+static void BM_FilterValueWithPositionCache(benchmark::State& state) {
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    FieldMatcher field_matcher;
+    createLogEventAndMatcher(&event, &field_matcher);
+
+    std::vector<Matcher> matchers;
+    translateFieldMatcher(field_matcher, &matchers);
+    FieldPositionCache positionCache;
+
+    while (state.KeepRunning()) {
+        HashableDimensionKey output;
+        filterValues(matchers, event.getValues(), &positionCache, &output);
+    }
+}
+
+BENCHMARK(BM_FilterValueWithPositionCache);
+
 }  //  namespace statsd
 }  //  namespace os
 }  //  namespace android
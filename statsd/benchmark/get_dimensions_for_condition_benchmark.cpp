@@ -71,6 +71,57 @@ static void BM_GetDimensionInCondition(benchmark::State& state) {
 
 BENCHMARK(BM_GetDimensionInCondition);
 
+static void createFlatLogEventAndLink(LogEvent* event, Metric2Condition* link) {
+    AStatsEvent* statsEvent = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(statsEvent, 1);
+    AStatsEvent_overwriteTimestamp(statsEvent, 100000);
+    for (int i = 0; i < 10; i++) {
+        AStatsEvent_writeInt32(statsEvent, i);
+    }
+    AStatsEvent_writeString(statsEvent, "LOCATION");
+    parseStatsEventToLogEvent(statsEvent, event);
+
+    link->conditionId = 1;
+
+    // Link the last fields of the atom, the full scan compares every value with each of them.
+    FieldMatcher field_matcher;
+    field_matcher.set_field(event->GetTagId());
+    field_matcher.add_child()->set_field(9);
+    field_matcher.add_child()->set_field(10);
+    field_matcher.add_child()->set_field(11);
+
+    translateFieldMatcher(field_matcher, &link->metricFields);
+    field_matcher.set_field(event->GetTagId() + 1);
+    translateFieldMatcher(field_matcher, &link->conditionFields);
+}
+
+static void BM_GetDimensionInConditionFlatAtom(benchmark::State& state) {
+    Metric2Condition link;
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    createFlatLogEventAndLink(&event, &link);
+
+    while (state.KeepRunning()) {
+        HashableDimensionKey output;
+        getDimensionForCondition(event.getValues(), link, &output);
+    }
+}
+
+BENCHMARK(BM_GetDimensionInConditionFlatAtom);
+
+// Same as above without the position cache, comparing every value with every matcher.
+static void BM_GetDimensionInConditionFlatAtomNoPositionCache(benchmark::State& state) {
+    Metric2Condition link;
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    createFlatLogEventAndLink(&event, &link);
+
+    while (state.KeepRunning()) {
+        HashableDimensionKey output;
+        filterValues(link.metricFields, event.getValues(), &output);
+    }
+}
+
+BENCHMARK(BM_GetDimensionInConditionFlatAtomNoPositionCache);
+
 
 }  //  namespace statsd
 }  //  namespace os
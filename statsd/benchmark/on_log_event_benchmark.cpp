@@ -15,6 +15,7 @@
  */
 
 #include "benchmark/benchmark.h"
+#include "matchers/matcher_util.h"
 #include "tests/statsd_test_util.h"
 
 using namespace std;
@@ -56,6 +57,53 @@ static void BM_OnLogEvent(benchmark::State& state) {
 }
 BENCHMARK(BM_OnLogEvent);
 
+static SimpleAtomMatcher createStringListAndIntMatcher(int atomId) {
+    SimpleAtomMatcher simpleMatcher;
+    simpleMatcher.set_atom_id(atomId);
+    FieldValueMatcher* stringMatcher = simpleMatcher.add_field_value_matcher();
+    stringMatcher->set_field(1);
+    for (int i = 0; i < 50; i++) {
+        stringMatcher->mutable_eq_any_string()->add_str_value("package" + to_string(i));
+    }
+    FieldValueMatcher* intMatcher = simpleMatcher.add_field_value_matcher();
+    intMatcher->set_field(2);
+    intMatcher->set_gt_int(10);
+    return simpleMatcher;
+}
+
+static std::unique_ptr<LogEvent> createStringAndIntEvent(int atomId) {
+    AStatsEvent* statsEvent = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(statsEvent, atomId);
+    AStatsEvent_writeString(statsEvent, "package49");
+    AStatsEvent_writeInt32(statsEvent, 11);
+    std::unique_ptr<LogEvent> event = std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0);
+    parseStatsEventToLogEvent(statsEvent, event.get());
+    return event;
+}
+
+static void BM_MatchesSimple(benchmark::State& state) {
+    sp<UidMap> uidMap = new UidMap();
+    const SimpleAtomMatcher simpleMatcher = createStringListAndIntMatcher(/*atomId=*/1000);
+    std::unique_ptr<LogEvent> event = createStringAndIntEvent(/*atomId=*/1000);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(matchesSimple(uidMap, simpleMatcher, *event).matched);
+    }
+}
+BENCHMARK(BM_MatchesSimple);
+
+static void BM_MatchesCompiled(benchmark::State& state) {
+    sp<UidMap> uidMap = new UidMap();
+    const CompiledSimpleAtomMatcher compiledMatcher =
+            compileSimpleAtomMatcher(createStringListAndIntMatcher(/*atomId=*/1000)).value();
+    std::unique_ptr<LogEvent> event = createStringAndIntEvent(/*atomId=*/1000);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(matchesCompiled(uidMap, compiledMatcher, *event));
+    }
+}
+BENCHMARK(BM_MatchesCompiled);
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "external/puller_util.h"
+#include "packages/UidMap.h"
+#include "stats_log_util.h"
+#include "tests/statsd_test_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::set;
+using std::shared_ptr;
+using std::vector;
+
+namespace {
+
+const int kUidAtomTagId = 100;
+const vector<int> kAdditiveFields = {3};
+const int kFirstHostUid = 10000;
+const int kFirstIsolatedUid = 90000;
+const int kRowsPerHost = 5;
+const int kNumProcessStates = 3;
+
+// Builds per-uid rows {uid, process_state, bytes}. A quarter of the rows are reported by an
+// isolated uid of the host, and rows of the same host and process state need to be merged.
+vector<shared_ptr<LogEvent>> createPulledData(int numRows) {
+    vector<shared_ptr<LogEvent>> data;
+    data.reserve(numRows);
+    for (int i = 0; i < numRows; i++) {
+        const int hostIndex = i / kRowsPerHost;
+        const int uid = (i % 4 == 0) ? kFirstIsolatedUid + hostIndex : kFirstHostUid + hostIndex;
+        data.push_back(makeUidLogEvent(kUidAtomTagId, /*eventTimeNs=*/1000, uid,
+                                       /*data1=*/i % kNumProcessStates, /*data2=*/i));
+    }
+    // Pullers report rows in arbitrary order.
+    std::reverse(data.begin(), data.end());
+    return data;
+}
+
+sp<UidMap> createUidMap(int numRows) {
+    sp<UidMap> uidMap = new UidMap();
+    for (int hostIndex = 0; hostIndex <= numRows / kRowsPerHost; hostIndex++) {
+        uidMap->assignIsolatedUid(kFirstIsolatedUid + hostIndex, kFirstHostUid + hostIndex);
+    }
+    return uidMap;
+}
+
+// Sort-based merge that mapAndMergeIsolatedUidsToHostUid used before switching to hash grouping.
+// Kept here as a baseline. Only handles the plain uid field layout used by this benchmark.
+void legacyMapAndMerge(vector<shared_ptr<LogEvent>>& data, const sp<UidMap>& uidMap,
+                       const vector<int>& additiveFieldsVec) {
+    for (auto& event : data) {
+        Value& value = (*event->getMutableValues())[0].mValue;
+        value.setInt(uidMap->getHostUidOrSelf(value.int_value));
+    }
+
+    std::sort(data.begin(), data.end(),
+              [](const shared_ptr<LogEvent>& lhs, const shared_ptr<LogEvent>& rhs) {
+                  if (lhs->size() != rhs->size()) {
+                      return lhs->size() < rhs->size();
+                  }
+                  const vector<FieldValue>& lhsValues = lhs->getValues();
+                  const vector<FieldValue>& rhsValues = rhs->getValues();
+                  for (int i = 0; i < (int)lhs->size(); i++) {
+                      if (lhsValues[i] != rhsValues[i]) {
+                          return lhsValues[i] < rhsValues[i];
+                      }
+                  }
+                  return false;
+              });
+
+    vector<shared_ptr<LogEvent>> mergedData;
+    const set<int> additiveFields(additiveFieldsVec.begin(), additiveFieldsVec.end());
+    for (int i = 0; i < (int)data.size() - 1; i++) {
+        if (data[i]->size() != data[i + 1]->size()) {
+            mergedData.push_back(data[i]);
+            continue;
+        }
+        vector<FieldValue>* lhsValues = data[i]->getMutableValues();
+        vector<FieldValue>* rhsValues = data[i + 1]->getMutableValues();
+        bool needMerge = true;
+        for (int p = 0; p < (int)lhsValues->size(); p++) {
+            if ((*lhsValues)[p].mField != (*rhsValues)[p].mField) {
+                needMerge = false;
+                break;
+            }
+            if ((*lhsValues)[p].mValue != (*rhsValues)[p].mValue) {
+                int pos = (*lhsValues)[p].mField.getPosAtDepth(0);
+                if (isPrimitiveRepeatedField((*lhsValues)[p].mField) ||
+                    (additiveFields.find(pos) == additiveFields.end())) {
+                    needMerge = false;
+                    break;
+                }
+            }
+        }
+        if (!needMerge) {
+            mergedData.push_back(data[i]);
+            continue;
+        }
+        for (int p = 0; p < (int)lhsValues->size(); p++) {
+            int pos = (*lhsValues)[p].mField.getPosAtDepth(0);
+            if (!isPrimitiveRepeatedField((*lhsValues)[p].mField) &&
+                (additiveFields.find(pos) != additiveFields.end())) {
+                (*rhsValues)[p].mValue += (*lhsValues)[p].mValue;
+            }
+        }
+    }
+    mergedData.push_back(data.back());
+    data = mergedData;
+}
+
+}  // anonymous namespace
+
+static void BM_MapAndMergeIsolatedUidsToHostUid(benchmark::State& state) {
+    const int numRows = state.range(0);
+    sp<UidMap> uidMap = createUidMap(numRows);
+    for (auto _ : state) {
+        state.PauseTiming();
+        vector<shared_ptr<LogEvent>> data = createPulledData(numRows);
+        state.ResumeTiming();
+        mapAndMergeIsolatedUidsToHostUid(data, uidMap, kUidAtomTagId, kAdditiveFields);
+        benchmark::DoNotOptimize(data);
+    }
+}
+BENCHMARK(BM_MapAndMergeIsolatedUidsToHostUid)->Arg(100)->Arg(1000)->Arg(10000);
+
+static void BM_MapAndMergeIsolatedUidsToHostUidLegacy(benchmark::State& state) {
+    const int numRows = state.range(0);
+    sp<UidMap> uidMap = createUidMap(numRows);
+    for (auto _ : state) {
+        state.PauseTiming();
+        vector<shared_ptr<LogEvent>> data = createPulledData(numRows);
+        state.ResumeTiming();
+        legacyMapAndMerge(data, uidMap, kAdditiveFields);
+        benchmark::DoNotOptimize(data);
+    }
+}
+BENCHMARK(BM_MapAndMergeIsolatedUidsToHostUidLegacy)->Arg(100)->Arg(1000)->Arg(10000);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
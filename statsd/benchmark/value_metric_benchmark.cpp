@@ -29,11 +29,11 @@ namespace {
 
 const ConfigKey cfgKey(0, 12345);
 
-vector<shared_ptr<LogEvent>> createEvents() {
+vector<shared_ptr<LogEvent>> createEvents(int numEvents = 1000, int numDimensions = 50) {
     vector<shared_ptr<LogEvent>> events;
-    for (int i = 1; i <= 1000; i++) {
+    for (int i = 1; i <= numEvents; i++) {
         events.push_back(CreateTwoValueLogEvent(/* atomId */ 1, /* eventTimeNs */ i,
-                                                /* value1 */ i % 50, /* value2 */ i));
+                                                /* value1 */ i % numDimensions, /* value2 */ i));
     }
     return events;
 }
@@ -83,6 +83,33 @@ void BM_ValueMetricPushedDiffedViaNumericValueMetricProducer(benchmark::State& s
 }
 BENCHMARK(BM_ValueMetricPushedDiffedViaNumericValueMetricProducer);
 
+// Same as above with 10k dimensions, each event updating the bucket of an existing dimension.
+void BM_ValueMetricPushedDiffed10kDimensions(benchmark::State& state) {
+    const int numDimensions = 10000;
+    StatsdConfig config = createConfig();
+    sp<MockStatsPullerManager> pullerManager = new StrictMock<MockStatsPullerManager>();
+    sp<NumericValueMetricProducer> producer = createNumericValueMetricProducer(
+            pullerManager, config.value_metric(0), /* atomId */ 1, /* isPulled */ false, cfgKey,
+            /* protoHash */ 0x123456, /* timeBaseNs */ 100, /* startTimeNs */ 100,
+            /* logEventMatcherIndex */ 0, /* conditionAfterFirstBucketPrepared */ nullopt,
+            /* slicedStateAtoms */ {}, /* stateGroupMap */ {}, /* eventMatcherWizard */ nullptr,
+            /* dimensionLimit */ numDimensions);
+
+    vector<shared_ptr<LogEvent>> events = createEvents(/* numEvents */ 2 * numDimensions,
+                                                       numDimensions);
+    for (const auto& event : events) {
+        producer->onMatchedLogEvent(/* matcherIndex */ 0, *event);
+    }
+
+    for (auto _ : state) {
+        for (const auto& event : events) {
+            producer->onMatchedLogEvent(/* matcherIndex */ 0, *event);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_ValueMetricPushedDiffed10kDimensions);
+
 }  // anonymous namespace
 }  // namespace statsd
 }  // namespace os
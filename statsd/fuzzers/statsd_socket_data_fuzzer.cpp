@@ -25,7 +25,11 @@ void fuzzSocket(const uint8_t* data, size_t size) {
     LogEventFilter filter;
     filter.setFilteringEnabled(false);
 
-    StatsSocketListener::processSocketMessage((const char*)data, size, 0, 0, queue, filter);
+    StatsSocketListener::AtomReadStats readStats;
+    StatsSocketListener::processSocketMessage((const char*)data, size, 0, 0, queue, filter,
+                                              readStats);
+
+    StatsSocketListener::processStatsEventBatch(data, size, 0, 0, queue, filter, readStats);
 
     StatsSocketListener::processStatsEventBuffer(data, size, 0, 0, queue, filter);
 }
@@ -19,10 +19,13 @@
 #include "HashableDimensionKey.h"
 #include "FieldValue.h"
 
+#include <algorithm>
+
 namespace android {
 namespace os {
 namespace statsd {
 
+using std::pair;
 using std::string;
 using std::vector;
 using android::base::StringPrintf;
@@ -111,47 +114,59 @@ StatsDimensionsValueParcel HashableDimensionKey::toStatsDimensionsValueParcel()
     return root;
 }
 
+android::hash_t hashFieldValue(android::hash_t hash, const FieldValue& fieldValue) {
+    hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mField.getField()));
+    hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mField.getTag()));
+    hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mValue.getType()));
+    switch (fieldValue.mValue.getType()) {
+        case INT:
+            hash = android::JenkinsHashMix(hash, android::hash_type(fieldValue.mValue.int_value));
+            break;
+        case LONG:
+            hash = android::JenkinsHashMix(hash, android::hash_type(fieldValue.mValue.long_value));
+            break;
+        case STRING:
+            hash = android::JenkinsHashMix(hash, static_cast<uint32_t>(std::hash<std::string>()(
+                                                         fieldValue.mValue.str_value)));
+            break;
+        case FLOAT: {
+            hash = android::JenkinsHashMix(hash, android::hash_type(fieldValue.mValue.float_value));
+            break;
+        }
+        case DOUBLE: {
+            hash = android::JenkinsHashMix(hash,
+                                           android::hash_type(fieldValue.mValue.double_value));
+            break;
+        }
+        case STORAGE: {
+            hash = android::JenkinsHashMixBytes(hash, fieldValue.mValue.storage_value.data(),
+                                                fieldValue.mValue.storage_value.size());
+            break;
+        }
+        default:
+            break;
+    }
+    return hash;
+}
+
 android::hash_t hashDimension(const HashableDimensionKey& value) {
+    return hashDimension(value.getValues());
+}
+
+android::hash_t hashDimension(const vector<FieldValue>& values) {
     android::hash_t hash = 0;
-    for (const auto& fieldValue : value.getValues()) {
-        hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mField.getField()));
-        hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mField.getTag()));
-        hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mValue.getType()));
-        switch (fieldValue.mValue.getType()) {
-            case INT:
-                hash = android::JenkinsHashMix(hash,
-                                               android::hash_type(fieldValue.mValue.int_value));
-                break;
-            case LONG:
-                hash = android::JenkinsHashMix(hash,
-                                               android::hash_type(fieldValue.mValue.long_value));
-                break;
-            case STRING:
-                hash = android::JenkinsHashMix(hash, static_cast<uint32_t>(std::hash<std::string>()(
-                                                             fieldValue.mValue.str_value)));
-                break;
-            case FLOAT: {
-                hash = android::JenkinsHashMix(hash,
-                                               android::hash_type(fieldValue.mValue.float_value));
-                break;
-            }
-            case DOUBLE: {
-                hash = android::JenkinsHashMix(hash,
-                                               android::hash_type(fieldValue.mValue.double_value));
-                break;
-            }
-            case STORAGE: {
-                hash = android::JenkinsHashMixBytes(hash, fieldValue.mValue.storage_value.data(),
-                                                    fieldValue.mValue.storage_value.size());
-                break;
-            }
-            default:
-                break;
-        }
+    for (const auto& fieldValue : values) {
+        hash = hashFieldValue(hash, fieldValue);
     }
     return JenkinsHashWhiten(hash);
 }
 
+android::hash_t hashAtomDimension(int32_t atomTag, const vector<FieldValue>& values) {
+    android::hash_t hash = hashDimension(values);
+    hash = android::JenkinsHashMix(hash, atomTag);
+    return android::JenkinsHashWhiten(hash);
+}
+
 bool filterValues(const Matcher& matcherField, const vector<FieldValue>& values,
                   FieldValue* output) {
     if (matcherField.hasAllPositionMatcher()) {
@@ -184,6 +199,74 @@ bool filterValues(const vector<Matcher>& matcherFields, const vector<FieldValue>
     return num_matches > 0;
 }
 
+namespace {
+
+// Whether matcher matches at most one value of any event.
+bool matchesSingleValue(const Matcher& matcher) {
+    if (matcher.hasAllPositionMatcher()) {
+        return false;
+    }
+    for (int32_t depth = 0; depth <= matcher.mMatcher.getDepth(); depth++) {
+        if (matcher.getRawMaskAtDepth(depth) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+bool filterValues(const vector<Matcher>& matcherFields, const vector<FieldValue>& values,
+                  FieldPositionCache* positionCache, HashableDimensionKey* output) {
+    if (positionCache->status == FieldPositionCache::Status::kUnknown) {
+        positionCache->status = std::all_of(matcherFields.begin(), matcherFields.end(),
+                                            matchesSingleValue)
+                                        ? FieldPositionCache::Status::kCacheable
+                                        : FieldPositionCache::Status::kNotCacheable;
+    }
+    if (positionCache->status == FieldPositionCache::Status::kNotCacheable) {
+        return filterValues(matcherFields, values, output);
+    }
+
+    vector<pair<int, int>>& positions = positionCache->positions;
+    const bool cacheHit =
+            !positions.empty() &&
+            std::all_of(positions.begin(), positions.end(), [&](const pair<int, int>& position) {
+                return position.first < (int)values.size() &&
+                       values[position.first].mField.matches(matcherFields[position.second]);
+            });
+    if (cacheHit) {
+        for (size_t i = 0; i < positions.size(); i++) {
+            const FieldValue& value = values[positions[i].first];
+            output->addValue(value);
+            output->mutableValue(i)->mField.setField(value.mField.getField() &
+                                                     matcherFields[positions[i].second].mMask);
+        }
+        return true;
+    }
+
+    // Same as filterValues() without a cache, recording the positions of the matches.
+    vector<pair<int, int>> matchPositions;
+    for (size_t i = 0; i < values.size(); ++i) {
+        const FieldValue& value = values[i];
+        for (size_t j = 0; j < matcherFields.size(); ++j) {
+            if (value.mField.matches(matcherFields[j])) {
+                output->addValue(value);
+                output->mutableValue(matchPositions.size())
+                        ->mField.setField(value.mField.getField() & matcherFields[j].mMask);
+                matchPositions.emplace_back(i, j);
+            }
+        }
+    }
+    // Keep the previous positions if this event did not match every matcher, e.g. it is another
+    // atom of a combination matcher.
+    if (matchPositions.size() == matcherFields.size()) {
+        positions = std::move(matchPositions);
+        return !positions.empty();
+    }
+    return !matchPositions.empty();
+}
+
 bool filterValues(const vector<Matcher>& dimKeyMatcherFields,
                   const vector<Matcher>& valueMatcherFields, const vector<FieldValue>& values,
                   HashableDimensionKey& key, vector<int>& valueIndices) {
@@ -242,7 +325,7 @@ void getDimensionForCondition(const std::vector<FieldValue>& eventValues,
                               const Metric2Condition& links,
                               HashableDimensionKey* conditionDimension) {
     // Get the dimension first by using dimension from what.
-    filterValues(links.metricFields, eventValues, conditionDimension);
+    filterValues(links.metricFields, eventValues, &links.metricFieldPositions, conditionDimension);
 
     size_t count = conditionDimension->getValues().size();
     if (count != links.conditionFields.size()) {
@@ -261,7 +344,7 @@ void getDimensionForState(const std::vector<FieldValue>& eventValues, const Metr
                           HashableDimensionKey* statePrimaryKey) {
     // First, get the dimension from the event using the "what" fields from the
     // MetricStateLinks.
-    filterValues(link.metricFields, eventValues, statePrimaryKey);
+    filterValues(link.metricFields, eventValues, &link.metricFieldPositions, statePrimaryKey);
 
     // Then check that the statePrimaryKey size equals the number of state fields
     size_t count = statePrimaryKey->getValues().size();
@@ -38,16 +38,37 @@ inline constexpr int STATS_DIMENSIONS_VALUE_LONG_TYPE = 4;
 inline constexpr int STATS_DIMENSIONS_VALUE_FLOAT_TYPE = 6;
 inline constexpr int STATS_DIMENSIONS_VALUE_TUPLE_TYPE = 7;
 
+/**
+ * Positions of the values matched by a list of matchers in the last event the matchers were
+ * applied to. Most atoms have a fixed layout, so the dimension of the next event can be read from
+ * the same positions instead of comparing every value to every matcher.
+ *
+ * Only lists whose matchers each match at most one value of any event are cached, so not the
+ * ones with ALL or ANY positions. A cached position is checked against the event before it is
+ * used, events with a different layout (e.g. another attribution chain length) fall back to
+ * comparing all values, which caches their positions.
+ */
+struct FieldPositionCache {
+    enum class Status { kUnknown, kCacheable, kNotCacheable };
+    Status status = Status::kUnknown;
+
+    // Pairs of value index and matcher index, in the order filterValues() outputs them. Empty
+    // until an event matched every matcher.
+    std::vector<std::pair<int, int>> positions;
+};
+
 struct Metric2Condition {
     int64_t conditionId;
     std::vector<Matcher> metricFields;
     std::vector<Matcher> conditionFields;
+    mutable FieldPositionCache metricFieldPositions;
 };
 
 struct Metric2State {
     int32_t stateAtomId;
     std::vector<Matcher> metricFields;
     std::vector<Matcher> stateFields;
+    mutable FieldPositionCache metricFieldPositions;
 };
 
 class HashableDimensionKey {
@@ -60,6 +81,12 @@ public:
 
     HashableDimensionKey(const HashableDimensionKey& that) : mValues(that.getValues()){};
 
+    HashableDimensionKey(HashableDimensionKey&& that) = default;
+
+    HashableDimensionKey& operator=(const HashableDimensionKey& that) = default;
+
+    HashableDimensionKey& operator=(HashableDimensionKey&& that) = default;
+
     inline void addValue(const FieldValue& value) {
         mValues.push_back(value);
     }
@@ -107,8 +134,12 @@ public:
         : mDimensionKeyInWhat(that.getDimensionKeyInWhat()),
           mStateValuesKey(that.getStateValuesKey()){};
 
+    MetricDimensionKey(MetricDimensionKey&& that) = default;
+
     MetricDimensionKey& operator=(const MetricDimensionKey& from) = default;
 
+    MetricDimensionKey& operator=(MetricDimensionKey&& from) = default;
+
     std::string toString() const;
 
     inline const HashableDimensionKey& getDimensionKeyInWhat() const {
@@ -119,6 +150,10 @@ public:
         return mStateValuesKey;
     }
 
+    inline HashableDimensionKey* getMutableDimensionKeyInWhat() {
+        return &mDimensionKeyInWhat;
+    }
+
     inline HashableDimensionKey* getMutableStateValuesKey() {
         return &mStateValuesKey;
     }
@@ -159,6 +194,12 @@ public:
 
     bool operator==(const AtomDimensionKey& that) const;
 
+    // Same as comparing with AtomDimensionKey(atomTag, HashableDimensionKey(values)), without
+    // copying the values.
+    inline bool equals(int32_t atomTag, const std::vector<FieldValue>& values) const {
+        return mAtomTag == atomTag && mAtomFieldValues.getValues() == values;
+    }
+
 private:
     int32_t mAtomTag;
     HashableDimensionKey mAtomFieldValues;
@@ -166,6 +207,59 @@ private:
 
 android::hash_t hashDimension(const HashableDimensionKey& key);
 
+android::hash_t hashDimension(const std::vector<FieldValue>& values);
+
+/**
+ * Returns the hash of AtomDimensionKey(atomTag, HashableDimensionKey(values)), without building
+ * it. Used to look up atoms by their values.
+ */
+android::hash_t hashAtomDimension(int32_t atomTag, const std::vector<FieldValue>& values);
+
+/**
+ * The tag and values of an atom, to look up an AtomDimensionKey without building it.
+ */
+struct AtomDimensionKeyView {
+    int32_t atomTag;
+    const std::vector<FieldValue>& values;
+};
+
+/**
+ * Transparent hash and equality for maps keyed by AtomDimensionKey, so that they can be searched
+ * with an AtomDimensionKeyView.
+ */
+struct AtomDimensionKeyHash {
+    using is_transparent = void;
+
+    std::size_t operator()(const AtomDimensionKey& key) const {
+        return hashAtomDimension(key.getAtomTag(), key.getAtomFieldValues().getValues());
+    }
+
+    std::size_t operator()(const AtomDimensionKeyView& view) const {
+        return hashAtomDimension(view.atomTag, view.values);
+    }
+};
+
+struct AtomDimensionKeyEqual {
+    using is_transparent = void;
+
+    bool operator()(const AtomDimensionKey& lhs, const AtomDimensionKey& rhs) const {
+        return lhs == rhs;
+    }
+
+    bool operator()(const AtomDimensionKey& key, const AtomDimensionKeyView& view) const {
+        return key.equals(view.atomTag, view.values);
+    }
+
+    bool operator()(const AtomDimensionKeyView& view, const AtomDimensionKey& key) const {
+        return key.equals(view.atomTag, view.values);
+    }
+};
+
+/**
+ * Mixes the field and the value of fieldValue into hash. The result is not whitened.
+ */
+android::hash_t hashFieldValue(android::hash_t hash, const FieldValue& fieldValue);
+
 /**
  * Returns true if a FieldValue field matches the matcher field.
  * This function can only be used to match one field (i.e. matcher with position ALL will return
@@ -187,6 +281,13 @@ bool filterValues(const Matcher& matcherField, const std::vector<FieldValue>& va
 bool filterValues(const std::vector<Matcher>& matcherFields, const std::vector<FieldValue>& values,
                   HashableDimensionKey* output);
 
+/**
+ * Same as above, reading the values from their positions in positionCache when they are still
+ * the same. positionCache must only be used with matcherFields.
+ */
+bool filterValues(const std::vector<Matcher>& matcherFields, const std::vector<FieldValue>& values,
+                  FieldPositionCache* positionCache, HashableDimensionKey* output);
+
 /**
  * Filters FieldValues to create HashableDimensionKey using dimensions matcher fields and create
  *  vector of value indices using values matcher fields.
@@ -290,8 +391,6 @@ struct std::hash<android::os::statsd::MetricDimensionKey> {
 template <>
 struct std::hash<android::os::statsd::AtomDimensionKey> {
     std::size_t operator()(const android::os::statsd::AtomDimensionKey& key) const {
-        android::hash_t hash = hashDimension(key.getAtomFieldValues());
-        hash = android::JenkinsHashMix(hash, key.getAtomTag());
-        return android::JenkinsHashWhiten(hash);
+        return hashAtomDimension(key.getAtomTag(), key.getAtomFieldValues().getValues());
     }
 };
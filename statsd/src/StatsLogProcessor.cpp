@@ -21,6 +21,7 @@
 
 #include <android-base/file.h>
 #include <cutils/multiuser.h>
+#include <limits>
 #include <src/active_config_list.pb.h>
 #include <src/experiment_ids.pb.h>
 
@@ -122,6 +123,11 @@ StatsLogProcessor::StatsLogProcessor(
 StatsLogProcessor::~StatsLogProcessor() {
 }
 
+static int64_t getMinByteSizeCheckPeriodNs(MetricsManager& metricsManager) {
+    return metricsManager.useV2SoftMemoryCalculation() ? StatsdStats::kMinByteSizeV2CheckPeriodNs
+                                                       : StatsdStats::kMinByteSizeCheckPeriodNs;
+}
+
 static void flushProtoToBuffer(ProtoOutputStream& proto, vector<uint8_t>* outData) {
     outData->clear();
     outData->resize(proto.size());
@@ -467,37 +473,78 @@ void StatsLogProcessor::OnLogEvent(LogEvent* event, int64_t elapsedRealtimeNs) {
         return;
     }
 
-    std::unordered_set<int> uidsWithActiveConfigsChanged;
-    std::unordered_map<int, std::vector<int64_t>> activeConfigsPerUid;
+    // Collect the configs that need this event.
+    mRoutedConfigs.clear();
+    uint64_t shardMask = 0;
+    const auto addRoutes = [&](const std::vector<ConfigRoute>& routes) {
+        for (const ConfigRoute& route : routes) {
+            if (event->isRestricted() && !route.metricsManager->hasRestrictedMetricsDelegate()) {
+                continue;
+            }
+            mRoutedConfigs.push_back({&route, route.metricsManager->isActive()});
+            shardMask |= uint64_t(1) << route.shard;
+        }
+    };
+    if (atomId == util::STATS_SOCKET_LOSS_REPORTED) {
+        // Socket loss is accounted by every config, see MetricsManager::onLogEventLost().
+        addRoutes(mAllConfigRoutes);
+    } else {
+        addRoutes(mMetricsManagersForAllAtoms);
+        const auto routeIt = mAtomIdToMetricsManagers.find(atomId);
+        if (routeIt != mAtomIdToMetricsManagers.end()) {
+            addRoutes(routeIt->second);
+        }
+    }
+
+    // Evaluate the matchers shared by configs once for all of them.
+    if (!mRoutedConfigs.empty()) {
+        mSharedMatchers->onLogEvent(*event);
+    }
 
     // pass the event to metrics managers.
-    for (auto& pair : mMetricsManagers) {
-        if (event->isRestricted() && !pair.second->hasRestrictedMetricsDelegate()) {
-            continue;
-        }
-        int uid = pair.first.GetUid();
-        int64_t configId = pair.first.GetId();
-        bool isPrevActive = pair.second->isActive();
-        pair.second->onLogEvent(*event);
-        bool isCurActive = pair.second->isActive();
-        // Map all active configs by uid.
-        if (isCurActive) {
-            auto activeConfigs = activeConfigsPerUid.find(uid);
-            if (activeConfigs != activeConfigsPerUid.end()) {
-                activeConfigs->second.push_back(configId);
-            } else {
-                vector<int64_t> newActiveConfigs;
-                newActiveConfigs.push_back(configId);
-                activeConfigsPerUid[uid] = newActiveConfigs;
+    if (mEventWorkers != nullptr) {
+        // While matching an event, configs only share state that is thread safe (StatsdStats,
+        // UidMap, pullers, alarm monitors) or read only (StateManager). State changes have been
+        // delivered above, and all cross config bookkeeping happens below on this thread.
+        mEventWorkers->run(shardMask, [this, event](int shard) {
+            for (const RoutedConfig& routed : mRoutedConfigs) {
+                if (routed.route->shard == shard) {
+                    routed.route->metricsManager->onLogEvent(*event);
+                }
             }
+        });
+    } else {
+        for (const RoutedConfig& routed : mRoutedConfigs) {
+            routed.route->metricsManager->onLogEvent(*event);
         }
+    }
+    mSharedMatchers->clearResults();
+
+    // Read the clock once for the byte size checks of all the configs.
+    const int64_t flushCheckTimeNs = getElapsedRealtimeNs();
+    std::unordered_set<int> uidsWithActiveConfigsChanged;
+    for (const RoutedConfig& routed : mRoutedConfigs) {
+        const ConfigKey& key = routed.route->key;
+        bool isCurActive = routed.route->metricsManager->isActive();
         // The activation state of this config changed.
-        if (isPrevActive != isCurActive) {
-            VLOG("Active status changed for uid  %d", uid);
-            uidsWithActiveConfigsChanged.insert(uid);
-            StatsdStats::getInstance().noteActiveStatusChanged(pair.first, isCurActive);
+        if (routed.wasActive != isCurActive) {
+            VLOG("Active status changed for uid  %d", key.GetUid());
+            uidsWithActiveConfigsChanged.insert(key.GetUid());
+            StatsdStats::getInstance().noteActiveStatusChanged(key, isCurActive);
+        }
+    }
+
+    // Check every config, not only the ones that saw this event: configs also grow through
+    // pulled atoms, and configs with reports on disk ask for a fetch even if they got no event.
+    if (flushCheckTimeNs >= mNextByteSizeCheckTimeNs) {
+        int64_t nextByteSizeCheckTimeNs = std::numeric_limits<int64_t>::max();
+        for (const auto& [key, metricsManager] : mMetricsManagers) {
+            flushIfNecessaryLocked(key, *metricsManager, flushCheckTimeNs);
+            const int64_t nextCheckTimeNs =
+                    mLastByteSizeTimes[key] + getMinByteSizeCheckPeriodNs(*metricsManager);
+            nextByteSizeCheckTimeNs = std::min(nextByteSizeCheckTimeNs, nextCheckTimeNs);
         }
-        flushIfNecessaryLocked(pair.first, *(pair.second));
+        mNextByteSizeCheckTimeNs = nextByteSizeCheckTimeNs;
     }
 
     // Don't use the event timestamp for the guardrail.
@@ -512,18 +559,14 @@ void StatsLogProcessor::OnLogEvent(LogEvent* event, int64_t elapsedRealtimeNs) {
                 return;
             }
         }
-        auto activeConfigs = activeConfigsPerUid.find(uid);
-        if (activeConfigs != activeConfigsPerUid.end()) {
-            if (mSendActivationBroadcast(uid, activeConfigs->second)) {
-                VLOG("StatsD sent activation notice for uid %d", uid);
-                mLastActivationBroadcastTimes[uid] = elapsedRealtimeNs;
-            }
-        } else {
-            std::vector<int64_t> emptyActiveConfigs;
-            if (mSendActivationBroadcast(uid, emptyActiveConfigs)) {
-                VLOG("StatsD sent EMPTY activation notice for uid %d", uid);
-                mLastActivationBroadcastTimes[uid] = elapsedRealtimeNs;
-            }
+        // Configs of the uid that did not see this event keep their activation state, so the
+        // active configs are collected from all configs.
+        vector<int64_t> activeConfigs;
+        GetActiveConfigsLocked(uid, activeConfigs);
+        if (mSendActivationBroadcast(uid, activeConfigs)) {
+            VLOG("StatsD sent activation notice for uid %d (%d active configs)", uid,
+                 (int)activeConfigs.size());
+            mLastActivationBroadcastTimes[uid] = elapsedRealtimeNs;
         }
     }
 }
@@ -558,6 +601,8 @@ void StatsLogProcessor::OnConfigUpdated(const int64_t timestampNs, const ConfigK
 void StatsLogProcessor::OnConfigUpdatedLocked(const int64_t timestampNs, const ConfigKey& key,
                                               const StatsdConfig& config, bool modularUpdate) {
     VLOG("Updated configuration for key %s", key.ToString().c_str());
+    // Check the size of the new or updated config on the next event.
+    mNextByteSizeCheckTimeNs = 0;
     const auto& it = mMetricsManagers.find(key);
     bool configValid = false;
     if (isAtLeastU() && it != mMetricsManagers.end()) {
@@ -634,6 +679,7 @@ void StatsLogProcessor::OnConfigUpdatedLocked(const int64_t timestampNs, const C
     }
 
     updateLogEventFilterLocked();
+    updateAtomRoutingLocked();
 }
 
 size_t StatsLogProcessor::GetMetricsSize(const ConfigKey& key) const {
@@ -693,13 +739,25 @@ void StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTim
         // filling the buffer again soon.
         mLastBroadcastTimes.erase(key);
 
-        vector<uint8_t> buffer;
-        onConfigMetricsReportLocked(key, dumpTimeStampNs, wallClockNs,
-                                    include_current_partial_bucket, erase_data, dumpReportReason,
-                                    dumpLatency, false /* is this data going to be saved on disk */,
-                                    &buffer);
-        proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
-                     reinterpret_cast<char*>(buffer.data()), buffer.size());
+        if (erase_data && it->second->shouldPersistLocalHistory()) {
+            // The local history is saved from the serialized report.
+            vector<uint8_t> buffer;
+            onConfigMetricsReportLocked(key, dumpTimeStampNs, wallClockNs,
+                                        include_current_partial_bucket, erase_data,
+                                        dumpReportReason, dumpLatency,
+                                        false /* is this data going to be saved on disk */,
+                                        &buffer);
+            proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
+                         reinterpret_cast<char*>(buffer.data()), buffer.size());
+        } else {
+            // Write the report into proto directly, so that it is not held twice in memory.
+            uint64_t reportsToken =
+                    proto->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS);
+            onConfigMetricsReportLocked(key, dumpTimeStampNs, wallClockNs,
+                                        include_current_partial_bucket, erase_data,
+                                        dumpReportReason, dumpLatency, proto);
+            proto->end(reportsToken);
+        }
     } else {
         ALOGW("Config source %s does not exist", key.ToString().c_str());
     }
@@ -755,6 +813,30 @@ void StatsLogProcessor::onConfigMetricsReportLocked(
         const bool include_current_partial_bucket, const bool erase_data,
         const DumpReportReason dumpReportReason, const DumpLatency dumpLatency,
         const bool dataSavedOnDisk, vector<uint8_t>* buffer) {
+    ProtoOutputStream tempProto;
+    onConfigMetricsReportLocked(key, dumpTimeStampNs, wallClockNs, include_current_partial_bucket,
+                                erase_data, dumpReportReason, dumpLatency, &tempProto);
+    flushProtoToBuffer(tempProto, buffer);
+
+    // save buffer to disk if needed
+    const auto it = mMetricsManagers.find(key);
+    if (erase_data && !dataSavedOnDisk && it != mMetricsManagers.end() &&
+        it->second->shouldPersistLocalHistory()) {
+        VLOG("save history to disk");
+        string file_name = StorageManager::getDataHistoryFileName((long)getWallClockSec(),
+                                                                  key.GetUid(), key.GetId());
+        StorageManager::writeFile(file_name.c_str(), buffer->data(), buffer->size());
+    }
+}
+
+/*
+ * onConfigMetricsReportLocked writes the fields of ConfigMetricsReport into proto.
+ */
+void StatsLogProcessor::onConfigMetricsReportLocked(
+        const ConfigKey& key, const int64_t dumpTimeStampNs, const int64_t wallClockNs,
+        const bool include_current_partial_bucket, const bool erase_data,
+        const DumpReportReason dumpReportReason, const DumpLatency dumpLatency,
+        ProtoOutputStream* proto) {
     // We already checked whether key exists in mMetricsManagers in
     // WriteDataToDisk.
     auto it = mMetricsManagers.find(key);
@@ -770,61 +852,53 @@ void StatsLogProcessor::onConfigMetricsReportLocked(
     int64_t lastReportTimeNs = it->second->getLastReportTimeNs();
     int64_t lastReportWallClockNs = it->second->getLastReportWallClockNs();
 
-    std::set<string> str_set;
+    mReportStrings.clear();
 
     int64_t totalSize = it->second->byteSize();
 
-    ProtoOutputStream tempProto;
     // First, fill in ConfigMetricsReport using current data on memory, which
     // starts from filling in StatsLogReport's.
     it->second->onDumpReport(dumpTimeStampNs, wallClockNs, include_current_partial_bucket,
-                             erase_data, dumpLatency, &str_set, &tempProto);
+                             erase_data, dumpLatency, &mReportStrings, proto);
 
     // Fill in UidMap if there is at least one metric to report.
     // This skips the uid map if it's an empty config.
     if (it->second->getNumMetrics() > 0) {
-        uint64_t uidMapToken = tempProto.start(FIELD_TYPE_MESSAGE | FIELD_ID_UID_MAP);
+        uint64_t uidMapToken = proto->start(FIELD_TYPE_MESSAGE | FIELD_ID_UID_MAP);
         mUidMap->appendUidMap(dumpTimeStampNs, key, it->second->versionStringsInReport(),
                               it->second->installerInReport(),
                               it->second->packageCertificateHashSizeBytes(),
                               it->second->omitSystemUidsInUidMap(),
-                              it->second->hashStringInReport() ? &str_set : nullptr, &tempProto);
-        tempProto.end(uidMapToken);
+                              it->second->incrementalUidMapInReport(), erase_data,
+                              it->second->hashStringInReport() ? &mReportStrings : nullptr,
+                              proto);
+        proto->end(uidMapToken);
     }
 
     // Fill in the timestamps.
-    tempProto.write(FIELD_TYPE_INT64 | FIELD_ID_LAST_REPORT_ELAPSED_NANOS,
-                    (long long)lastReportTimeNs);
-    tempProto.write(FIELD_TYPE_INT64 | FIELD_ID_CURRENT_REPORT_ELAPSED_NANOS,
-                    (long long)dumpTimeStampNs);
-    tempProto.write(FIELD_TYPE_INT64 | FIELD_ID_LAST_REPORT_WALL_CLOCK_NANOS,
-                    (long long)lastReportWallClockNs);
-    tempProto.write(FIELD_TYPE_INT64 | FIELD_ID_CURRENT_REPORT_WALL_CLOCK_NANOS,
-                    (long long)wallClockNs);
+    proto->write(FIELD_TYPE_INT64 | FIELD_ID_LAST_REPORT_ELAPSED_NANOS,
+                 (long long)lastReportTimeNs);
+    proto->write(FIELD_TYPE_INT64 | FIELD_ID_CURRENT_REPORT_ELAPSED_NANOS,
+                 (long long)dumpTimeStampNs);
+    proto->write(FIELD_TYPE_INT64 | FIELD_ID_LAST_REPORT_WALL_CLOCK_NANOS,
+                 (long long)lastReportWallClockNs);
+    proto->write(FIELD_TYPE_INT64 | FIELD_ID_CURRENT_REPORT_WALL_CLOCK_NANOS,
+                 (long long)wallClockNs);
     // Dump report reason
-    tempProto.write(FIELD_TYPE_INT32 | FIELD_ID_DUMP_REPORT_REASON, dumpReportReason);
+    proto->write(FIELD_TYPE_INT32 | FIELD_ID_DUMP_REPORT_REASON, dumpReportReason);
 
-    for (const auto& str : str_set) {
-        tempProto.write(FIELD_TYPE_STRING | FIELD_COUNT_REPEATED | FIELD_ID_STRINGS, str);
+    for (const std::string_view str : mReportStrings) {
+        proto->write(FIELD_TYPE_STRING | FIELD_COUNT_REPEATED | FIELD_ID_STRINGS, str.data(),
+                     str.size());
     }
 
     // Data corrupted reason
-    writeDataCorruptedReasons(tempProto, FIELD_ID_DATA_CORRUPTED_REASON,
+    writeDataCorruptedReasons(*proto, FIELD_ID_DATA_CORRUPTED_REASON,
                               StatsdStats::getInstance().hasEventQueueOverflow(),
                               StatsdStats::getInstance().hasSocketLoss());
 
     // Estimated memory bytes
-    tempProto.write(FIELD_TYPE_INT64 | FIELD_ID_ESTIMATED_DATA_BYTES, totalSize);
-
-    flushProtoToBuffer(tempProto, buffer);
-
-    // save buffer to disk if needed
-    if (erase_data && !dataSavedOnDisk && it->second->shouldPersistLocalHistory()) {
-        VLOG("save history to disk");
-        string file_name = StorageManager::getDataHistoryFileName((long)getWallClockSec(),
-                                                                  key.GetUid(), key.GetId());
-        StorageManager::writeFile(file_name.c_str(), buffer->data(), buffer->size());
-    }
+    proto->write(FIELD_TYPE_INT64 | FIELD_ID_ESTIMATED_DATA_BYTES, totalSize);
 }
 
 void StatsLogProcessor::resetConfigsLocked(const int64_t timestampNs,
@@ -896,6 +970,7 @@ void StatsLogProcessor::OnConfigRemoved(const ConfigKey& key) {
     }
 
     updateLogEventFilterLocked();
+    updateAtomRoutingLocked();
 }
 
 // TODO(b/267501143): Add unit tests when metric producer is ready
@@ -1112,14 +1187,12 @@ void StatsLogProcessor::flushRestrictedDataLocked(const int64_t elapsedRealtimeN
 }
 
 void StatsLogProcessor::flushIfNecessaryLocked(const ConfigKey& key,
-                                               MetricsManager& metricsManager) {
-    int64_t elapsedRealtimeNs = getElapsedRealtimeNs();
+                                               MetricsManager& metricsManager,
+                                               int64_t elapsedRealtimeNs) {
     auto lastCheckTime = mLastByteSizeTimes.find(key);
-    int64_t minCheckPeriodNs = metricsManager.useV2SoftMemoryCalculation()
-                                       ? StatsdStats::kMinByteSizeV2CheckPeriodNs
-                                       : StatsdStats::kMinByteSizeCheckPeriodNs;
     if (lastCheckTime != mLastByteSizeTimes.end()) {
-        if (elapsedRealtimeNs - lastCheckTime->second < minCheckPeriodNs) {
+        if (elapsedRealtimeNs - lastCheckTime->second <
+            getMinByteSizeCheckPeriodNs(metricsManager)) {
             return;
         }
     }
@@ -1471,6 +1544,16 @@ void StatsLogProcessor::onStatsdInitCompleted(const int64_t elapsedTimeNs) {
     }
 }
 
+void StatsLogProcessor::setEventWorkerCount(int numWorkers) {
+    std::lock_guard<std::mutex> lock(mMetricsMutex);
+    // Joins the threads of the previous workers.
+    mEventWorkers.reset();
+    if (numWorkers > 1) {
+        mEventWorkers = std::make_unique<ShardedExecutor>(numWorkers);
+    }
+    updateAtomRoutingLocked();
+}
+
 void StatsLogProcessor::noteOnDiskData(const ConfigKey& key) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
     mOnDiskDataConfigs.insert(key);
@@ -1520,6 +1603,38 @@ void StatsLogProcessor::updateLogEventFilterLocked() const {
     mLogEventFilter->setAtomIds(std::move(allAtomIds), this);
 }
 
+void StatsLogProcessor::updateAtomRoutingLocked() {
+    mRoutedConfigs.clear();
+    mAtomIdToMetricsManagers.clear();
+    mMetricsManagersForAllAtoms.clear();
+    mAllConfigRoutes.clear();
+    mSharedMatchers->clear();
+    const int numShards = mEventWorkers != nullptr ? mEventWorkers->getNumShards() : 1;
+    int nextShard = 0;
+    for (const auto& [key, metricsManager] : mMetricsManagers) {
+        const ConfigRoute route{key, metricsManager, nextShard};
+        nextShard = (nextShard + 1) % numShards;
+        mAllConfigRoutes.push_back(route);
+        // Invalid configs drop all events.
+        if (!metricsManager->isConfigValid()) {
+            continue;
+        }
+        metricsManager->setSharedMatchers(mSharedMatchers);
+        if (metricsManager->hasMetricsWithActivation()) {
+            mMetricsManagersForAllAtoms.push_back(route);
+            continue;
+        }
+        LogEventFilter::AtomIdSet atomIds;
+        metricsManager->addAllAtomIds(atomIds);
+        for (const int atomId : atomIds) {
+            mAtomIdToMetricsManagers[atomId].push_back(route);
+        }
+    }
+    VLOG("StatsLogProcessor: %d atoms routed, %d configs see all atoms, %d shared matchers",
+         (int)mAtomIdToMetricsManagers.size(), (int)mMetricsManagersForAllAtoms.size(),
+         (int)mSharedMatchers->size());
+}
+
 bool StatsLogProcessor::validateAppBreadcrumbEvent(const LogEvent& event) const {
     if (event.GetTagId() == util::APP_BREADCRUMB_REPORTED) {
         // Check that app breadcrumb reported fields are valid.
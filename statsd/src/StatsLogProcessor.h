@@ -30,6 +30,8 @@
 #include "socket/LogEventFilter.h"
 #include "src/statsd_config.pb.h"
 #include "src/statsd_metadata.pb.h"
+#include "utils/ShardedExecutor.h"
+#include "utils/StringDictionary.h"
 
 namespace android {
 namespace os {
@@ -154,6 +156,10 @@ public:
         mLogEventFilter->setFilteringEnabled(!enabled);
     }
 
+    // Spreads the configs over numWorkers threads which match log events in parallel. Everything
+    // else in OnLogEvent stays on the calling thread. 1 or less disables the workers (default).
+    void setEventWorkerCount(int numWorkers);
+
     // Add a specific config key to the possible configs to dump ASAP.
     void noteOnDiskData(const ConfigKey& key);
 
@@ -199,9 +205,15 @@ private:
     // Tracks when we last checked the bytes consumed for each config key.
     std::unordered_map<ConfigKey, int64_t> mLastByteSizeTimes;
 
+    // Time before which no config is due for a byte size check.
+    int64_t mNextByteSizeCheckTimeNs = 0;
+
     // Tracks the number of times a config with a specified config key has been dumped.
     std::unordered_map<ConfigKey, int32_t> mDumpReportNumbers;
 
+    // Strings hashed in the report being written. Reused across reports to keep its storage.
+    StringDictionary mReportStrings;
+
     // Tracks when we last checked the ttl for restricted metrics.
     int64_t mLastTtlTime;
 
@@ -224,6 +236,39 @@ private:
 
     std::shared_ptr<LogEventFilter> mLogEventFilter;
 
+    struct ConfigRoute {
+        ConfigKey key;
+        sp<MetricsManager> metricsManager;
+        // Event worker shard that processes the config, 0 without event workers.
+        int shard;
+    };
+
+    // Valid configs that need to see an atom, keyed by atom id. Configs in
+    // mMetricsManagersForAllAtoms are not repeated here.
+    std::unordered_map<int, std::vector<ConfigRoute>> mAtomIdToMetricsManagers;
+
+    // Valid configs that need to see every atom.
+    std::vector<ConfigRoute> mMetricsManagersForAllAtoms;
+
+    // All configs, valid or not.
+    std::vector<ConfigRoute> mAllConfigRoutes;
+
+    struct RoutedConfig {
+        const ConfigRoute* route;
+        bool wasActive;
+    };
+
+    // Configs that the event being processed is routed to. Only used by OnLogEvent, kept as a
+    // member to reuse its allocation.
+    std::vector<RoutedConfig> mRoutedConfigs;
+
+    // Matchers that are identical across configs, evaluated once per log event.
+    const std::shared_ptr<SharedMatcherTable> mSharedMatchers =
+            std::make_shared<SharedMatcherTable>();
+
+    // Matches log events for the configs of each shard in parallel, null when disabled.
+    std::unique_ptr<ShardedExecutor> mEventWorkers;
+
     void OnLogEvent(LogEvent* event, int64_t elapsedRealtimeNs);
 
     void resetIfConfigTtlExpiredLocked(const int64_t eventTimeNs);
@@ -263,6 +308,11 @@ private:
              (e.g., before reboot). So no need to further persist local history.*/
             const bool dataSavedToDisk, vector<uint8_t>* proto);
 
+    void onConfigMetricsReportLocked(const ConfigKey& key, int64_t dumpTimeStampNs,
+                                     int64_t wallClockNs, const bool include_current_partial_bucket,
+                                     const bool erase_data, const DumpReportReason dumpReportReason,
+                                     const DumpLatency dumpLatency, ProtoOutputStream* proto);
+
     /* Check if it is time enforce data ttls for restricted metrics, and if it is, enforce ttls
      * on all restricted metrics. */
     void enforceDataTtlsIfNecessaryLocked(const int64_t wallClockNs,
@@ -277,7 +327,8 @@ private:
 
     /* Check if we should send a broadcast if approaching memory limits and if we're over, we
      * actually delete the data. */
-    void flushIfNecessaryLocked(const ConfigKey& key, MetricsManager& metricsManager);
+    void flushIfNecessaryLocked(const ConfigKey& key, MetricsManager& metricsManager,
+                                int64_t elapsedRealtimeNs);
 
     set<ConfigKey> getRestrictedConfigKeysToQueryLocked(int32_t callingUid, const int64_t configId,
                                                         const set<int32_t>& configPackageUids,
@@ -327,6 +378,9 @@ private:
     /* Tells LogEventFilter about atom ids to parse */
     void updateLogEventFilterLocked() const;
 
+    /* Rebuilds the atom id to config routing used by OnLogEvent */
+    void updateAtomRoutingLocked();
+
     bool validateAppBreadcrumbEvent(const LogEvent& event) const;
 
     // Function used to send a broadcast so that receiver for the config key can call getData
@@ -371,6 +425,7 @@ private:
     FRIEND_TEST(StatsLogProcessorTest, TestRateLimitByteSize);
     FRIEND_TEST(StatsLogProcessorTest, TestRateLimitBroadcast);
     FRIEND_TEST(StatsLogProcessorTest, TestDropWhenByteSizeTooLarge);
+    FRIEND_TEST(StatsLogProcessorTest, TestByteSizeCheckedForConfigsWithoutEvent);
     FRIEND_TEST(StatsLogProcessorTest, InvalidConfigRemoved);
     FRIEND_TEST(StatsLogProcessorTest, TestActiveConfigMetricDiskWriteRead);
     FRIEND_TEST(StatsLogProcessorTest, TestActivationOnBoot);
@@ -383,6 +438,10 @@ private:
     FRIEND_TEST(StatsLogProcessorTest, TestEmptyConfigHasNoUidMap);
     FRIEND_TEST(StatsLogProcessorTest, TestReportIncludesSubConfig);
     FRIEND_TEST(StatsLogProcessorTest, TestPullUidProviderSetOnConfigUpdate);
+    FRIEND_TEST(StatsLogProcessorTest, TestAtomRouting);
+    FRIEND_TEST(StatsLogProcessorTest, TestLogEventNotRoutedToUnrelatedConfig);
+    FRIEND_TEST(StatsLogProcessorTest, TestEventWorkersShardConfigs);
+    FRIEND_TEST(StatsLogProcessorTest, TestSharedMatchers);
     FRIEND_TEST(StatsLogProcessorTestRestricted, TestInconsistentRestrictedMetricsConfigUpdate);
     FRIEND_TEST(StatsLogProcessorTestRestricted, TestRestrictedLogEventPassed);
     FRIEND_TEST(StatsLogProcessorTestRestricted, TestRestrictedLogEventNotPassed);
@@ -221,6 +221,9 @@ StatsService::StatsService(const sp<UidMap>& uidMap, shared_ptr<LogEventQueue> q
                                                                delegateUids, restrictedMetrics);
             },
             logEventFilter);
+#ifdef STATSD_EVENT_WORKERS
+    mProcessor->setEventWorkerCount(STATSD_EVENT_WORKERS);
+#endif
 
     mUidMap->setListener(mProcessor);
     mConfigManager->AddListener(mProcessor);
@@ -1173,23 +1176,18 @@ Status StatsService::getDataFd(int64_t key, const int32_t callingUid,
                                const ScopedFileDescriptor& fd) {
     ATRACE_CALL();
     ENFORCE_UID(AID_SYSTEM);
-    vector<uint8_t> reportData;
-    getDataChecked(key, callingUid, &reportData);
+    ProtoOutputStream proto;
+    getDataChecked(key, callingUid, &proto);
 
-    if (reportData.size() >= std::numeric_limits<int32_t>::max()) {
+    if (proto.size() >= std::numeric_limits<int32_t>::max()) {
         ALOGE("Report size is infeasible big and can not be returned");
         return exception(EX_ILLEGAL_STATE, "Report size is infeasible big.");
     }
+    VLOG("StatsService::getDataFd report size %zu", proto.size());
 
-    const uint32_t bytesToWrite = static_cast<uint32_t>(reportData.size());
-    VLOG("StatsService::getDataFd report size %d", bytesToWrite);
-
-    // write 4 bytes of report size for correct buffer allocation
-    const uint32_t bytesToWriteBE = htonl(bytesToWrite);
-    if (!android::base::WriteFully(fd.get(), &bytesToWriteBE, sizeof(uint32_t))) {
-        return exception(EX_ILLEGAL_STATE, "Failed to write report data size to file descriptor");
-    }
-    if (!android::base::WriteFully(fd.get(), reportData.data(), reportData.size())) {
+    // The report is preceded by 4 bytes of its size for correct buffer allocation. It is written
+    // straight from the chunks of proto, multi-megabyte reports are not copied.
+    if (!writeSizePrefixedProtoToFd(proto, fd.get())) {
         return exception(EX_ILLEGAL_STATE, "Failed to write report data to file descriptor");
     }
 
@@ -1198,13 +1196,20 @@ Status StatsService::getDataFd(int64_t key, const int32_t callingUid,
 }
 
 void StatsService::getDataChecked(int64_t key, const int32_t callingUid, vector<uint8_t>* output) {
+    ProtoOutputStream proto;
+    getDataChecked(key, callingUid, &proto);
+    proto.serializeToVector(output);
+}
+
+void StatsService::getDataChecked(int64_t key, const int32_t callingUid,
+                                  ProtoOutputStream* proto) {
     VLOG("StatsService::getData with Uid %i", callingUid);
     ConfigKey configKey(callingUid, key);
     // The dump latency does not matter here since we do not include the current bucket, we do not
     // need to pull any new data anyhow.
     mProcessor->onDumpReport(configKey, getElapsedRealtimeNs(), getWallClockNs(),
                              false /* include_current_bucket*/, true /* erase_data */,
-                             GET_DATA_CALLED, FAST, output);
+                             GET_DATA_CALLED, FAST, proto);
 }
 
 Status StatsService::getMetadata(vector<uint8_t>* output) {
@@ -365,6 +365,8 @@ private:
      */
     void getDataChecked(int64_t key, const int32_t callingUid, vector<uint8_t>* output);
 
+    void getDataChecked(int64_t key, const int32_t callingUid, ProtoOutputStream* proto);
+
     /**
      * Writes the value of args[uidArgIndex] into uid.
      * Returns whether the uid is reasonable (type uid_t) and whether
@@ -16,9 +16,12 @@
 
 #pragma once
 
+#include "anomaly/AlarmTimingWheel.h"
+#include "anomaly/InternalAlarm.h"
 #include "anomaly/indexed_priority_queue.h"
 
 #include <aidl/android/os/IStatsCompanionService.h>
+#include <gtest/gtest_prod.h>
 #include <utils/RefBase.h>
 
 #include <unordered_set>
@@ -35,26 +38,6 @@ namespace android {
 namespace os {
 namespace statsd {
 
-/**
- * Represents an alarm, associated with some aggregate metric, holding a
- * projected time at which the metric is expected to exceed its anomaly
- * threshold.
- * Timestamps are in seconds since epoch in a uint32, so will fail in year 2106.
- */
-struct InternalAlarm : public RefBase {
-    explicit InternalAlarm(uint32_t timestampSec) : timestampSec(timestampSec) {
-    }
-
-    const uint32_t timestampSec;
-
-    /** InternalAlarm a is smaller (higher priority) than b if its timestamp is sooner. */
-    struct SmallerTimestamp {
-        bool operator()(const sp<const InternalAlarm>& a, const sp<const InternalAlarm>& b) const {
-            return (a->timestampSec < b->timestampSec);
-        }
-    };
-};
-
 /**
  * Manages internal alarms that may get registered with the AlarmManager.
  */
@@ -113,15 +96,16 @@ private:
     /**
      * Timestamp (seconds since epoch) of the alarm registered with
      * StatsCompanionService. This, in general, may not be equal to the soonest
-     * alarm stored in mPq, but should be within minUpdateTimeSec of it.
+     * alarm stored in mAlarms, but should be within minUpdateTimeSec of it.
      * A value of 0 indicates that no alarm is currently registered.
      */
     uint32_t mRegisteredAlarmTimeSec;
 
     /**
-     * Priority queue of alarms, prioritized by soonest alarm.timestampSec.
+     * Alarms by timestamp. Duration anomaly trackers add and remove alarms on most duration
+     * starts and stops, which the timing wheel does without lookups or allocations.
      */
-    indexed_priority_queue<InternalAlarm, InternalAlarm::SmallerTimestamp> mPq;
+    AlarmTimingWheel mAlarms;
 
     /**
      * Binder interface for communicating with StatsCompanionService.
@@ -155,6 +139,7 @@ private:
     // Callback function to cancel the alarm via StatsCompanionService.
     std::function<void(const shared_ptr<IStatsCompanionService>)> mCancelAlarm;
 
+    FRIEND_TEST(AlarmMonitor, TestElapsedTimeAlarmsInWheelSlots);
 };
 
 }  // namespace statsd
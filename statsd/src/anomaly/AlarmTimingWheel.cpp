@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define STATSD_DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "anomaly/AlarmTimingWheel.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::unordered_set;
+using std::vector;
+
+AlarmTimingWheel::AlarmTimingWheel()
+    : mSlots(kNumSlots),
+      mOccupiedSlots(),
+      mNowSec(0),
+      mSize(0),
+      mSoonestSec(0),
+      mSoonestSecValid(true) {
+}
+
+AlarmTimingWheel::~AlarmTimingWheel() {
+    // The alarms may outlive the wheel.
+    for (const vector<sp<const InternalAlarm>>& slot : mSlots) {
+        for (const sp<const InternalAlarm>& alarm : slot) {
+            alarm->mWheelSlot = -1;
+        }
+    }
+}
+
+bool AlarmTimingWheel::add(const sp<const InternalAlarm>& alarm, uint32_t nowSec) {
+    if (alarm == nullptr || alarm->mWheelSlot >= 0) {
+        return false;
+    }
+    const uint32_t timestampSec = alarm->timestampSec;
+    if (mSize == 0) {
+        // No alarm depends on the current time of the wheel. Anchor it to the time of the caller
+        // rather than to the alarm, so that later alarms sooner than this one aren't overdue.
+        mNowSec = nowSec;
+        mSoonestSec = timestampSec;
+        mSoonestSecValid = true;
+    } else if (mSoonestSecValid && timestampSec < mSoonestSec) {
+        mSoonestSec = timestampSec;
+    }
+    insert(alarm, getSlot(timestampSec));
+    return true;
+}
+
+bool AlarmTimingWheel::remove(const sp<const InternalAlarm>& alarm) {
+    if (alarm == nullptr || alarm->mWheelSlot < 0 || alarm->mWheelSlot >= kNumSlots) {
+        return false;
+    }
+    const vector<sp<const InternalAlarm>>& slot = mSlots[alarm->mWheelSlot];
+    if (alarm->mWheelIndex >= slot.size() || slot[alarm->mWheelIndex] != alarm) {
+        // Held by another wheel.
+        return false;
+    }
+    erase(*alarm);
+    if (mSize == 0) {
+        mSoonestSec = 0;
+        mSoonestSecValid = true;
+    } else if (alarm->timestampSec == mSoonestSec) {
+        mSoonestSecValid = false;
+    }
+    return true;
+}
+
+void AlarmTimingWheel::popSoonerThan(
+        uint32_t timestampSec,
+        unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>>* alarms) {
+    // The overdue alarms can be later than timestampSec if it is before the current time.
+    takeSlot(kOverdueSlot, &mPendingAlarms);
+
+    if (timestampSec > mNowSec) {
+        const uint32_t oldNowSec = mNowSec;
+        mNowSec = timestampSec;
+        int level = 0;
+        for (; level < kNumLevels; level++) {
+            const int levelShift = kSlotBits * (level + 1);
+            const bool inLevelRange = (timestampSec >> levelShift) == (oldNowSec >> levelShift);
+            uint64_t slots = mOccupiedSlots[level];
+            if (inLevelRange) {
+                // The slots before the one of timestampSec expired. The alarms of its slot are
+                // re-distributed to the lower levels, and the later slots don't need to change.
+                const uint32_t index = (timestampSec >> (kSlotBits * level)) & kSlotMask;
+                slots &= (uint64_t(2) << index) - 1;
+            }
+            // Else timestampSec is past the range of the level, all of its alarms expired.
+            while (slots != 0) {
+                const int index = __builtin_ctzll(slots);
+                slots &= slots - 1;
+                takeSlot(level * kSlotsPerLevel + index, &mPendingAlarms);
+            }
+            if (inLevelRange) {
+                break;
+            }
+        }
+        if (level == kNumLevels) {
+            takeSlot(kOverflowSlot, &mPendingAlarms);
+        }
+    }
+
+    for (sp<const InternalAlarm>& alarm : mPendingAlarms) {
+        if (alarm->timestampSec <= timestampSec) {
+            alarms->insert(std::move(alarm));
+        } else {
+            insert(alarm, getSlot(alarm->timestampSec));
+        }
+    }
+    mPendingAlarms.clear();
+
+    mSoonestSec = 0;
+    mSoonestSecValid = mSize == 0;
+}
+
+uint32_t AlarmTimingWheel::getSoonestTimestampSec() const {
+    if (mSoonestSecValid) {
+        return mSoonestSec;
+    }
+    // The overdue alarms are sooner than the ones in the wheel, the lower levels are sooner than
+    // the higher ones, and the slots of a level are in time order.
+    int soonestSlot = -1;
+    if (!mSlots[kOverdueSlot].empty()) {
+        soonestSlot = kOverdueSlot;
+    } else {
+        for (int level = 0; level < kNumLevels; level++) {
+            if (mOccupiedSlots[level] != 0) {
+                soonestSlot = level * kSlotsPerLevel + __builtin_ctzll(mOccupiedSlots[level]);
+                break;
+            }
+        }
+        if (soonestSlot < 0 && !mSlots[kOverflowSlot].empty()) {
+            soonestSlot = kOverflowSlot;
+        }
+    }
+    mSoonestSec = soonestSlot < 0 ? 0 : getSoonestInSlot(soonestSlot);
+    mSoonestSecValid = true;
+    return mSoonestSec;
+}
+
+int AlarmTimingWheel::getSlot(uint32_t timestampSec) const {
+    if (timestampSec <= mNowSec) {
+        return kOverdueSlot;
+    }
+    for (int level = 0; level < kNumLevels; level++) {
+        const int levelShift = kSlotBits * (level + 1);
+        if ((timestampSec >> levelShift) == (mNowSec >> levelShift)) {
+            return level * kSlotsPerLevel + ((timestampSec >> (kSlotBits * level)) & kSlotMask);
+        }
+    }
+    return kOverflowSlot;
+}
+
+void AlarmTimingWheel::insert(const sp<const InternalAlarm>& alarm, int slot) {
+    vector<sp<const InternalAlarm>>& alarms = mSlots[slot];
+    alarm->mWheelSlot = slot;
+    alarm->mWheelIndex = alarms.size();
+    alarms.push_back(alarm);
+    if (slot < kNumWheelSlots) {
+        mOccupiedSlots[slot / kSlotsPerLevel] |= uint64_t(1) << (slot % kSlotsPerLevel);
+    }
+    mSize++;
+}
+
+void AlarmTimingWheel::erase(const InternalAlarm& alarm) {
+    const int slot = alarm.mWheelSlot;
+    const uint32_t index = alarm.mWheelIndex;
+    alarm.mWheelSlot = -1;
+
+    vector<sp<const InternalAlarm>>& alarms = mSlots[slot];
+    if (index + 1 != alarms.size()) {
+        alarms[index] = std::move(alarms.back());
+        alarms[index]->mWheelIndex = index;
+    }
+    alarms.pop_back();
+    if (alarms.empty() && slot < kNumWheelSlots) {
+        mOccupiedSlots[slot / kSlotsPerLevel] &= ~(uint64_t(1) << (slot % kSlotsPerLevel));
+    }
+    mSize--;
+}
+
+void AlarmTimingWheel::takeSlot(int slot, vector<sp<const InternalAlarm>>* alarms) {
+    vector<sp<const InternalAlarm>>& slotAlarms = mSlots[slot];
+    for (sp<const InternalAlarm>& alarm : slotAlarms) {
+        alarm->mWheelSlot = -1;
+        alarms->push_back(std::move(alarm));
+    }
+    mSize -= slotAlarms.size();
+    slotAlarms.clear();
+    if (slot < kNumWheelSlots) {
+        mOccupiedSlots[slot / kSlotsPerLevel] &= ~(uint64_t(1) << (slot % kSlotsPerLevel));
+    }
+}
+
+uint32_t AlarmTimingWheel::getSoonestInSlot(int slot) const {
+    uint32_t soonest = UINT32_MAX;
+    for (const sp<const InternalAlarm>& alarm : mSlots[slot]) {
+        soonest = std::min(soonest, alarm->timestampSec);
+    }
+    return soonest;
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
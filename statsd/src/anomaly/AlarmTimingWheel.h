@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <gtest/gtest_prod.h>
+
+#include <unordered_set>
+#include <vector>
+
+#include "anomaly/InternalAlarm.h"
+#include "anomaly/indexed_priority_queue.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Hierarchical timing wheel of InternalAlarms with second granularity.
+ *
+ * Level L has 64 slots of 64^L seconds each. An alarm is kept at the lowest level whose range
+ * contains both the alarm and the current time of the wheel, in the slot of its timestamp. Alarms
+ * too far in the future for the top level are kept in an overflow slot, and alarms added with a
+ * timestamp that already passed in an overdue slot. The current time of the wheel is the time of
+ * the last popSoonerThan(), or the time of the caller when an alarm is added to an empty wheel.
+ *
+ * Adding and removing an alarm is O(1) and doesn't allocate once the slots have grown: each alarm
+ * records its position in the wheel. Popping alarms expires whole slots at once and only
+ * re-distributes the alarms of the slot the new time falls into.
+ *
+ * Not thread safe.
+ */
+class AlarmTimingWheel {
+public:
+    AlarmTimingWheel();
+
+    AlarmTimingWheel(const AlarmTimingWheel&) = delete;
+    AlarmTimingWheel& operator=(const AlarmTimingWheel&) = delete;
+
+    ~AlarmTimingWheel();
+
+    /**
+     * Adds the alarm. nowSec is the current time of the caller, used as the time of the wheel if
+     * it is empty. Returns false if the alarm is null or already in the wheel.
+     */
+    bool add(const sp<const InternalAlarm>& alarm, uint32_t nowSec);
+
+    /** Removes the alarm. Returns true if it had been in the wheel. */
+    bool remove(const sp<const InternalAlarm>& alarm);
+
+    /**
+     * Removes all alarms whose timestamp <= timestampSec and adds them to alarms. Advances the
+     * time of the wheel to timestampSec.
+     */
+    void popSoonerThan(uint32_t timestampSec,
+                       std::unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>>* alarms);
+
+    /** Returns the soonest alarm timestamp, or 0 if the wheel is empty. */
+    uint32_t getSoonestTimestampSec() const;
+
+    inline size_t size() const {
+        return mSize;
+    }
+
+    inline bool empty() const {
+        return mSize == 0;
+    }
+
+private:
+    static constexpr int kSlotBits = 6;
+    static constexpr int kSlotsPerLevel = 1 << kSlotBits;
+    static constexpr uint32_t kSlotMask = kSlotsPerLevel - 1;
+    static constexpr int kNumLevels = 4;
+    static constexpr int kNumWheelSlots = kNumLevels * kSlotsPerLevel;
+    static constexpr int kOverdueSlot = kNumWheelSlots;
+    static constexpr int kOverflowSlot = kNumWheelSlots + 1;
+    static constexpr int kNumSlots = kNumWheelSlots + 2;
+
+    // Slot of an alarm with the given timestamp relative to mNowSec.
+    int getSlot(uint32_t timestampSec) const;
+
+    void insert(const sp<const InternalAlarm>& alarm, int slot);
+
+    void erase(const InternalAlarm& alarm);
+
+    // Moves all alarms of the slot to alarms.
+    void takeSlot(int slot, std::vector<sp<const InternalAlarm>>* alarms);
+
+    // Soonest timestamp among the alarms of the slot. The slot must not be empty.
+    uint32_t getSoonestInSlot(int slot) const;
+
+    std::vector<std::vector<sp<const InternalAlarm>>> mSlots;
+
+    // Bitmask of the non-empty slots of each level.
+    uint64_t mOccupiedSlots[kNumLevels];
+
+    // Current time of the wheel. All alarms outside of the overdue slot are later than it.
+    uint32_t mNowSec;
+
+    size_t mSize;
+
+    // Alarms being re-distributed by popSoonerThan(), kept to reuse the storage.
+    std::vector<sp<const InternalAlarm>> mPendingAlarms;
+
+    // Cache of getSoonestTimestampSec(), valid if mSoonestSecValid.
+    mutable uint32_t mSoonestSec;
+    mutable bool mSoonestSecValid;
+
+    FRIEND_TEST(AlarmTimingWheelTest, TestAnchoredToCurrentTime);
+    FRIEND_TEST(AlarmMonitor, TestElapsedTimeAlarmsInWheelSlots);
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
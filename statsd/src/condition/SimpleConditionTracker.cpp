@@ -334,7 +334,8 @@ void SimpleConditionTracker::evaluateCondition(const LogEvent& event,
                              &overallChanged);
     } else if (!mContainANYPositionInInternalDimensions) {
         HashableDimensionKey outputValue;
-        filterValues(mOutputDimensions, event.getValues(), &outputValue);
+        filterValues(mOutputDimensions, event.getValues(), &mOutputDimensionPositions,
+                     &outputValue);
 
         // If this event has multiple nodes in the attribution chain,  this log event probably will
         // generate multiple dimensions. If so, we will find if the condition changes for any
@@ -113,6 +113,8 @@ private:
 
     std::vector<Matcher> mOutputDimensions;
 
+    FieldPositionCache mOutputDimensionPositions;
+
     bool mContainANYPositionInInternalDimensions;
 
     std::set<HashableDimensionKey> mLastChangedToTrueDimensions;
@@ -27,6 +27,8 @@ public:
     }
 
     virtual bool useV2SoftMemoryCalculation() = 0;
+
+    virtual bool useTrackedMemoryCalculation() = 0;
 };
 
 }  // namespace statsd
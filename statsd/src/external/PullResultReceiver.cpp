@@ -21,8 +21,10 @@ namespace os {
 namespace statsd {
 
 PullResultReceiver::PullResultReceiver(
-        std::function<void(int32_t, bool, const vector<StatsEventParcel>&)> pullFinishCb)
-    : pullFinishCallback(std::move(pullFinishCb)) {
+        std::function<void(int32_t, bool, const vector<StatsEventParcel>&)> pullFinishCb,
+        std::function<void(int32_t, bool, const StatsEventBulkParcel&)> pullFinishBulkCb)
+    : pullFinishCallback(std::move(pullFinishCb)),
+      pullFinishBulkCallback(std::move(pullFinishBulkCb)) {
 }
 
 Status PullResultReceiver::pullFinished(int32_t atomTag, bool success,
@@ -31,6 +33,12 @@ Status PullResultReceiver::pullFinished(int32_t atomTag, bool success,
     return Status::ok();
 }
 
+Status PullResultReceiver::pullFinishedBulk(int32_t atomTag, bool success,
+                                            const StatsEventBulkParcel& output) {
+    pullFinishBulkCallback(atomTag, success, output);
+    return Status::ok();
+}
+
 PullResultReceiver::~PullResultReceiver() {
 }
 
@@ -15,12 +15,14 @@
  */
 
 #include <aidl/android/os/BnPullAtomResultReceiver.h>
+#include <aidl/android/util/StatsEventBulkParcel.h>
 #include <aidl/android/util/StatsEventParcel.h>
 
 using namespace std;
 
 using Status = ::ndk::ScopedAStatus;
 using aidl::android::os::BnPullAtomResultReceiver;
+using aidl::android::util::StatsEventBulkParcel;
 using aidl::android::util::StatsEventParcel;
 
 namespace android {
@@ -30,7 +32,8 @@ namespace statsd {
 class PullResultReceiver : public BnPullAtomResultReceiver {
 public:
     PullResultReceiver(
-            function<void(int32_t, bool, const vector<StatsEventParcel>&)> pullFinishCallback);
+            function<void(int32_t, bool, const vector<StatsEventParcel>&)> pullFinishCallback,
+            function<void(int32_t, bool, const StatsEventBulkParcel&)> pullFinishBulkCallback);
     ~PullResultReceiver();
 
     /**
@@ -39,8 +42,15 @@ public:
     Status pullFinished(int32_t atomTag, bool success,
                         const vector<StatsEventParcel>& output) override;
 
+    /**
+     * Binder call for finishing a pull with the events packed into a single buffer.
+     */
+    Status pullFinishedBulk(int32_t atomTag, bool success,
+                            const StatsEventBulkParcel& output) override;
+
 private:
     function<void(int32_t, bool, const vector<StatsEventParcel>&)> pullFinishCallback;
+    function<void(int32_t, bool, const StatsEventBulkParcel&)> pullFinishBulkCallback;
 };
 
 }  // namespace statsd
@@ -23,11 +23,13 @@
 #include "logd/LogEvent.h"
 #include "stats_log_util.h"
 
+#include <aidl/android/util/StatsEventBulkParcel.h>
 #include <aidl/android/util/StatsEventParcel.h>
 
 using namespace std;
 
 using Status = ::ndk::ScopedAStatus;
+using aidl::android::util::StatsEventBulkParcel;
 using aidl::android::util::StatsEventParcel;
 using ::ndk::SharedRefBase;
 
@@ -35,6 +37,36 @@ namespace android {
 namespace os {
 namespace statsd {
 
+namespace {
+
+void addPulledEvent(const uint8_t* buffer, size_t size, vector<shared_ptr<LogEvent>>& data) {
+    shared_ptr<LogEvent> event = make_shared<LogEvent>(/*uid=*/-1, /*pid=*/-1);
+    if (event->parseBuffer(buffer, size)) {
+        data.push_back(std::move(event));
+    } else {
+        StatsdStats::getInstance().noteAtomError(event->GetTagId(), /*pull=*/true);
+    }
+}
+
+}  // namespace
+
+bool parseStatsEventBulkParcel(const StatsEventBulkParcel& parcel,
+                               vector<shared_ptr<LogEvent>>& data) {
+    const vector<int32_t>& offsets = parcel.eventOffsets;
+    const size_t bufferSize = parcel.buffer.size();
+    data.reserve(data.size() + offsets.size());
+    for (size_t i = 0; i < offsets.size(); i++) {
+        const size_t begin = offsets[i];
+        const size_t end = i + 1 < offsets.size() ? offsets[i + 1] : bufferSize;
+        if (offsets[i] < 0 || begin > end || end > bufferSize) {
+            ALOGW("Malformed StatsEventBulkParcel offsets");
+            return false;
+        }
+        addPulledEvent(parcel.buffer.data() + begin, end - begin, data);
+    }
+    return true;
+}
+
 StatsCallbackPuller::StatsCallbackPuller(int tagId, const shared_ptr<IPullAtomCallback>& callback,
                                          const int64_t coolDownNs, int64_t timeoutNs,
                                          const vector<int>& additiveFields)
@@ -65,21 +97,25 @@ PullErrorCode StatsCallbackPuller::PullInternal(vector<shared_ptr<LogEvent>>* da
                 // data (the output param) if the pointer is in scope and the pull did not time out.
                 {
                     lock_guard<mutex> lk(*cv_mutex);
+                    sharedData->reserve(output.size());
                     for (const StatsEventParcel& parcel: output) {
-                        shared_ptr<LogEvent> event = make_shared<LogEvent>(/*uid=*/-1, /*pid=*/-1);
-                        bool valid = event->parseBuffer((uint8_t*)parcel.buffer.data(),
-                                                        parcel.buffer.size());
-                        if (valid) {
-                            sharedData->push_back(event);
-                        } else {
-                            StatsdStats::getInstance().noteAtomError(event->GetTagId(),
-                                                                     /*pull=*/true);
-                        }
+                        addPulledEvent(parcel.buffer.data(), parcel.buffer.size(), *sharedData);
                     }
                     *pullSuccess = success;
                     *pullFinish = true;
                 }
                 cv->notify_one();
+            },
+            [cv_mutex, cv, pullFinish, pullSuccess, sharedData](
+                    int32_t atomTag, bool success, const StatsEventBulkParcel& output) {
+                // Same as above, the events are parsed directly from the packed buffer.
+                {
+                    lock_guard<mutex> lk(*cv_mutex);
+                    const bool valid = parseStatsEventBulkParcel(output, *sharedData);
+                    *pullSuccess = success && valid;
+                    *pullFinish = true;
+                }
+                cv->notify_one();
             });
 
     // Initiate the pull. This is a oneway call to a different process, except
@@ -17,15 +17,26 @@
 #pragma once
 
 #include <aidl/android/os/IPullAtomCallback.h>
+#include <aidl/android/util/StatsEventBulkParcel.h>
 #include "StatsPuller.h"
 
 using aidl::android::os::IPullAtomCallback;
+using aidl::android::util::StatsEventBulkParcel;
 using std::shared_ptr;
 
 namespace android {
 namespace os {
 namespace statsd {
 
+/**
+ * Parses the events packed in the parcel and appends them to data. Events which fail to parse
+ * are noted in StatsdStats and skipped.
+ *
+ * @return false if the parcel event offsets are malformed
+ */
+bool parseStatsEventBulkParcel(const StatsEventBulkParcel& parcel,
+                               vector<std::shared_ptr<LogEvent>>& data);
+
 class StatsCallbackPuller : public StatsPuller {
 public:
     explicit StatsCallbackPuller(int tagId, const shared_ptr<IPullAtomCallback>& callback,
@@ -39,6 +50,7 @@ private:
     FRIEND_TEST(StatsCallbackPullerTest, PullFail);
     FRIEND_TEST(StatsCallbackPullerTest, PullSuccess);
     FRIEND_TEST(StatsCallbackPullerTest, PullTimeout);
+    FRIEND_TEST(StatsCallbackPullerTest, PullBulkSuccess);
 };
 
 }  // namespace statsd
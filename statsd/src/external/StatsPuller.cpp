@@ -41,13 +41,51 @@ StatsPuller::StatsPuller(const int tagId, const int64_t coolDownNs, const int64_
       mCoolDownNs(coolDownNs),
       mAdditiveFields(additiveFields),
       mLastPullTimeNs(0),
-      mLastEventTimeNs(0) {
+      mLastEventTimeNs(0),
+      mCachedData(std::make_shared<const std::vector<std::shared_ptr<LogEvent>>>()) {
 }
 
 PullErrorCode StatsPuller::Pull(const int64_t eventTimeNs,
                                 std::vector<std::shared_ptr<LogEvent>>* data) {
     ATRACE_CALL();
     lock_guard<std::mutex> lock(mLock);
+    const PullErrorCode status = pullLocked(eventTimeNs);
+    if (status == PULL_SUCCESS) {
+        (*data) = *mCachedData;
+    }
+    return status;
+}
+
+PullErrorCode StatsPuller::Pull(const int64_t eventTimeNs, const int64_t wallClockNs,
+                                PulledData* data) {
+    ATRACE_CALL();
+    lock_guard<std::mutex> lock(mLock);
+    const PullErrorCode status = pullLocked(eventTimeNs);
+    if (status != PULL_SUCCESS) {
+        return status;
+    }
+    if (mCachedDataElapsedTimeNs != eventTimeNs || mCachedDataWallClockNs != wallClockNs) {
+        if (mCachedData.use_count() > 1) {
+            // A previous receiver still holds the snapshot, don't change it under its feet.
+            auto copy = std::make_shared<std::vector<std::shared_ptr<LogEvent>>>();
+            copy->reserve(mCachedData->size());
+            for (const auto& event : *mCachedData) {
+                copy->push_back(std::make_shared<LogEvent>(*event));
+            }
+            mCachedData = std::move(copy);
+        }
+        for (const auto& event : *mCachedData) {
+            event->setElapsedTimestampNs(eventTimeNs);
+            event->setLogdWallClockTimestampNs(wallClockNs);
+        }
+        mCachedDataElapsedTimeNs = eventTimeNs;
+        mCachedDataWallClockNs = wallClockNs;
+    }
+    (*data) = mCachedData;
+    return PULL_SUCCESS;
+}
+
+PullErrorCode StatsPuller::pullLocked(const int64_t eventTimeNs) {
     const int64_t elapsedTimeNs = getElapsedRealtimeNs();
     const int64_t systemUptimeMillis = getSystemUptimeMillis();
     StatsdStats::getInstance().notePull(mTagId);
@@ -55,9 +93,7 @@ PullErrorCode StatsPuller::Pull(const int64_t eventTimeNs,
             (mLastEventTimeNs == eventTimeNs) || (elapsedTimeNs - mLastPullTimeNs < mCoolDownNs);
     if (shouldUseCache) {
         if (mHasGoodData) {
-            (*data) = mCachedData;
             StatsdStats::getInstance().notePullFromCache(mTagId);
-
         }
         return mHasGoodData ? PULL_SUCCESS : PULL_FAIL;
     }
@@ -65,10 +101,13 @@ PullErrorCode StatsPuller::Pull(const int64_t eventTimeNs,
         StatsdStats::getInstance().updateMinPullIntervalSec(
                 mTagId, (elapsedTimeNs - mLastPullTimeNs) / NS_PER_SEC);
     }
-    mCachedData.clear();
+    mCachedData = std::make_shared<const std::vector<std::shared_ptr<LogEvent>>>();
+    mCachedDataElapsedTimeNs = -1;
+    mCachedDataWallClockNs = -1;
     mLastPullTimeNs = elapsedTimeNs;
     mLastEventTimeNs = eventTimeNs;
-    PullErrorCode status = PullInternal(&mCachedData);
+    std::vector<std::shared_ptr<LogEvent>> pulledData;
+    PullErrorCode status = PullInternal(&pulledData);
     mHasGoodData = (status == PULL_SUCCESS);
     if (!mHasGoodData) {
         return status;
@@ -79,7 +118,6 @@ PullErrorCode StatsPuller::Pull(const int64_t eventTimeNs,
     const bool pullTimeOut = pullElapsedDurationNs > mPullTimeoutNs;
     if (pullTimeOut) {
         // Something went wrong. Discard the data.
-        mCachedData.clear();
         mHasGoodData = false;
         StatsdStats::getInstance().notePullTimeout(
                 mTagId, pullSystemUptimeDurationMillis, NanoToMillis(pullElapsedDurationNs));
@@ -88,16 +126,17 @@ PullErrorCode StatsPuller::Pull(const int64_t eventTimeNs,
         return PULL_FAIL;
     }
 
-    if (mCachedData.size() > 0) {
-        mapAndMergeIsolatedUidsToHostUid(mCachedData, mUidMap, mTagId, mAdditiveFields);
+    if (pulledData.size() > 0) {
+        mapAndMergeIsolatedUidsToHostUid(pulledData, mUidMap, mTagId, mAdditiveFields);
     }
 
-    if (mCachedData.empty()) {
+    if (pulledData.empty()) {
         VLOG("Data pulled is empty");
         StatsdStats::getInstance().noteEmptyData(mTagId);
     }
 
-    (*data) = mCachedData;
+    mCachedData = std::make_shared<const std::vector<std::shared_ptr<LogEvent>>>(
+            std::move(pulledData));
     return PULL_SUCCESS;
 }
 
@@ -111,8 +150,10 @@ int StatsPuller::clearCache() {
 }
 
 int StatsPuller::clearCacheLocked() {
-    int ret = mCachedData.size();
-    mCachedData.clear();
+    int ret = mCachedData->size();
+    mCachedData = std::make_shared<const std::vector<std::shared_ptr<LogEvent>>>();
+    mCachedDataElapsedTimeNs = -1;
+    mCachedDataWallClockNs = -1;
     mLastPullTimeNs = 0;
     mLastEventTimeNs = 0;
     return ret;
@@ -33,6 +33,10 @@ namespace android {
 namespace os {
 namespace statsd {
 
+// Immutable, ref-counted snapshot of pulled data. It is shared between the puller cache and all
+// receivers of a pull, so the events must not be modified in place.
+using PulledData = std::shared_ptr<const std::vector<std::shared_ptr<LogEvent>>>;
+
 enum PullErrorCode {
     PULL_SUCCESS = 0,
     PULL_FAIL = 1,
@@ -59,6 +63,12 @@ public:
     // should make a copy as this data may be shared with multiple metrics.
     PullErrorCode Pull(const int64_t eventTimeNs, std::vector<std::shared_ptr<LogEvent>>* data);
 
+    // Same as above, but hands out the cached snapshot without copying it, with the events
+    // timestamped at eventTimeNs and wallClockNs. The timestamps are only rewritten when they
+    // differ from the ones of the cached snapshot. The snapshot is copied before that if it is
+    // still referenced by a previous receiver.
+    PullErrorCode Pull(const int64_t eventTimeNs, const int64_t wallClockNs, PulledData* data);
+
     // Clear cache immediately
     int ForceClearCache();
 
@@ -85,6 +95,9 @@ private:
     // Real puller impl.
     virtual PullErrorCode PullInternal(std::vector<std::shared_ptr<LogEvent>>* data) = 0;
 
+    // Refreshes mCachedData unless it can be served from cache.
+    PullErrorCode pullLocked(const int64_t eventTimeNs);
+
     bool mHasGoodData = false;
 
     // Minimum time before this puller does actual pull again.
@@ -111,7 +124,12 @@ private:
     //   1) A pull fails
     //   2) A new pull request comes after cooldown time.
     //   3) clearCache is called.
-    std::vector<std::shared_ptr<LogEvent>> mCachedData;
+    PulledData mCachedData;
+
+    // Timestamps the events of mCachedData were last rewritten to. -1 if the events still carry
+    // the timestamps set by the puller.
+    int64_t mCachedDataElapsedTimeNs = -1;
+    int64_t mCachedDataWallClockNs = -1;
 
     int clearCache();
 
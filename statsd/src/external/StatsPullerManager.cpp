@@ -69,33 +69,29 @@ bool StatsPullerManager::Pull(int tagId, const vector<int32_t>& uids, const int6
 bool StatsPullerManager::PullLocked(int tagId, const ConfigKey& configKey,
                                     const int64_t eventTimeNs, vector<shared_ptr<LogEvent>>* data) {
     vector<int32_t> uids;
-    const auto& uidProviderIt = mPullUidProviders.find(configKey);
-    if (uidProviderIt == mPullUidProviders.end()) {
-        ALOGE("Error pulling tag %d. No pull uid provider for config key %s", tagId,
-              configKey.ToString().c_str());
-        StatsdStats::getInstance().notePullUidProviderNotFound(tagId);
-        return false;
-    }
-    sp<PullUidProvider> pullUidProvider = uidProviderIt->second.promote();
-    if (pullUidProvider == nullptr) {
-        ALOGE("Error pulling tag %d, pull uid provider for config %s is gone.", tagId,
-              configKey.ToString().c_str());
-        StatsdStats::getInstance().notePullUidProviderNotFound(tagId);
+    if (!getPullAtomUidsLocked(tagId, configKey, &uids)) {
         return false;
     }
-    uids = pullUidProvider->getPullAtomUids(tagId);
     return PullLocked(tagId, uids, eventTimeNs, data);
 }
 
 bool StatsPullerManager::PullLocked(int tagId, const vector<int32_t>& uids,
                                     const int64_t eventTimeNs, vector<shared_ptr<LogEvent>>* data) {
+    return PullLocked(tagId, uids, [eventTimeNs, data](StatsPuller& puller) {
+        const PullErrorCode status = puller.Pull(eventTimeNs, data);
+        VLOG("pulled %zu items", data->size());
+        return status;
+    });
+}
+
+bool StatsPullerManager::PullLocked(int tagId, const vector<int32_t>& uids,
+                                    const std::function<PullErrorCode(StatsPuller&)>& pull) {
     VLOG("Initiating pulling %d", tagId);
     for (int32_t uid : uids) {
         PullerKey key = {.uid = uid, .atomTag = tagId};
         auto pullerIt = kAllPullAtomInfo.find(key);
         if (pullerIt != kAllPullAtomInfo.end()) {
-            PullErrorCode status = pullerIt->second->Pull(eventTimeNs, data);
-            VLOG("pulled %zu items", data->size());
+            PullErrorCode status = pull(*pullerIt->second);
             if (status != PULL_SUCCESS) {
                 StatsdStats::getInstance().notePullFailed(tagId);
             }
@@ -115,6 +111,26 @@ bool StatsPullerManager::PullLocked(int tagId, const vector<int32_t>& uids,
     return false;  // Return early since we don't know what to pull.
 }
 
+bool StatsPullerManager::getPullAtomUidsLocked(int tagId, const ConfigKey& configKey,
+                                               vector<int32_t>* uids) {
+    const auto& uidProviderIt = mPullUidProviders.find(configKey);
+    if (uidProviderIt == mPullUidProviders.end()) {
+        ALOGE("Error pulling tag %d. No pull uid provider for config key %s", tagId,
+              configKey.ToString().c_str());
+        StatsdStats::getInstance().notePullUidProviderNotFound(tagId);
+        return false;
+    }
+    sp<PullUidProvider> pullUidProvider = uidProviderIt->second.promote();
+    if (pullUidProvider == nullptr) {
+        ALOGE("Error pulling tag %d, pull uid provider for config %s is gone.", tagId,
+              configKey.ToString().c_str());
+        StatsdStats::getInstance().notePullUidProviderNotFound(tagId);
+        return false;
+    }
+    (*uids) = pullUidProvider->getPullAtomUids(tagId);
+    return true;
+}
+
 bool StatsPullerManager::PullerForMatcherExists(int tagId) const {
     // Pulled atoms might be registered after we parse the config, so just make sure the id is in
     // an appropriate range.
@@ -253,16 +269,8 @@ void StatsPullerManager::OnAlarmFired(int64_t elapsedTimeNs) {
             }
         }
     }
+    const vector<shared_ptr<LogEvent>> noData;
     for (const auto& pullInfo : needToPull) {
-        vector<shared_ptr<LogEvent>> data;
-        PullResult pullResult =
-                PullLocked(pullInfo.first->atomTag, pullInfo.first->configKey, elapsedTimeNs, &data)
-                        ? PullResult::PULL_RESULT_SUCCESS
-                        : PullResult::PULL_RESULT_FAIL;
-        if (pullResult == PullResult::PULL_RESULT_FAIL) {
-            VLOG("pull failed at %lld, will try again later", (long long)elapsedTimeNs);
-        }
-
         // Convention is to mark pull atom timestamp at request time.
         // If we pull at t0, puller starts at t1, finishes at t2, and send back
         // at t3, we mark t0 as its timestamp, which should correspond to its
@@ -270,10 +278,22 @@ void StatsPullerManager::OnAlarmFired(int64_t elapsedTimeNs) {
         // Here the triggering event is alarm fired from AlarmManager.
         // In ValueMetricProducer and GaugeMetricProducer we do same thing
         // when pull on condition change, etc.
-        for (auto& event : data) {
-            event->setElapsedTimestampNs(elapsedTimeNs);
-            event->setLogdWallClockTimestampNs(wallClockNs);
+        // The puller stamps its cached snapshot, which is then shared by all receivers of the
+        // atom without copying.
+        const int tagId = pullInfo.first->atomTag;
+        PulledData pulledData;
+        vector<int32_t> uids;
+        const bool pullSuccess =
+                getPullAtomUidsLocked(tagId, pullInfo.first->configKey, &uids) &&
+                PullLocked(tagId, uids, [elapsedTimeNs, wallClockNs, &pulledData](StatsPuller& p) {
+                    return p.Pull(elapsedTimeNs, wallClockNs, &pulledData);
+                });
+        PullResult pullResult =
+                pullSuccess ? PullResult::PULL_RESULT_SUCCESS : PullResult::PULL_RESULT_FAIL;
+        if (pullResult == PullResult::PULL_RESULT_FAIL) {
+            VLOG("pull failed at %lld, will try again later", (long long)elapsedTimeNs);
         }
+        const vector<shared_ptr<LogEvent>>& data = pulledData != nullptr ? *pulledData : noData;
 
         for (const auto& receiverInfo : pullInfo.second) {
             sp<PullDataReceiver> receiverPtr = receiverInfo->receiver.promote();
@@ -20,6 +20,7 @@
 #include <aidl/android/os/IStatsCompanionService.h>
 #include <utils/RefBase.h>
 
+#include <functional>
 #include <list>
 #include <vector>
 
@@ -158,6 +159,13 @@ private:
     bool PullLocked(int tagId, const vector<int32_t>& uids, int64_t eventTimeNs,
                     vector<std::shared_ptr<LogEvent>>* data);
 
+    // Runs pull on the puller registered for the first of uids that has one for tagId.
+    bool PullLocked(int tagId, const vector<int32_t>& uids,
+                    const std::function<PullErrorCode(StatsPuller&)>& pull);
+
+    // Gets the uids allowed to provide tagId for configKey from its PullUidProvider.
+    bool getPullAtomUidsLocked(int tagId, const ConfigKey& configKey, vector<int32_t>* uids);
+
     // locks for data receiver and StatsCompanionService changes
     std::mutex mLock;
 
@@ -18,6 +18,11 @@
 #include "Log.h"
 
 #include "puller_util.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "HashableDimensionKey.h"
 #include "stats_log_util.h"
 
 namespace android {
@@ -26,6 +31,67 @@ namespace statsd {
 
 using namespace std;
 
+namespace {
+
+// Repeated additive fields are treated as non-additive fields.
+inline bool isAdditiveField(const FieldValue& fieldValue, const vector<int>& additiveFields) {
+    return !isPrimitiveRepeatedField(fieldValue.mField) &&
+           std::find(additiveFields.begin(), additiveFields.end(),
+                     fieldValue.mField.getPosAtDepth(0)) != additiveFields.end();
+}
+
+// Hashes everything but the values of additive fields, so that events which can be merged
+// always collide.
+android::hash_t hashNonAdditiveFields(const LogEvent& event, const vector<int>& additiveFields) {
+    android::hash_t hash = android::hash_type((int)event.size());
+    for (const FieldValue& fieldValue : event.getValues()) {
+        if (isAdditiveField(fieldValue, additiveFields)) {
+            hash = android::JenkinsHashMix(hash,
+                                           android::hash_type((int)fieldValue.mField.getField()));
+        } else {
+            hash = hashFieldValue(hash, fieldValue);
+        }
+    }
+    return android::JenkinsHashWhiten(hash);
+}
+
+struct MergeKey {
+    android::hash_t hash;
+    LogEvent* event;
+};
+
+struct MergeKeyHash {
+    size_t operator()(const MergeKey& key) const {
+        return key.hash;
+    }
+};
+
+// Two events can be merged if they have the same fields and only differ in additive field
+// values.
+struct MergeKeyEqual {
+    const vector<int>& additiveFields;
+
+    bool operator()(const MergeKey& lhs, const MergeKey& rhs) const {
+        if (lhs.hash != rhs.hash || lhs.event->size() != rhs.event->size()) {
+            return false;
+        }
+        const vector<FieldValue>& lhsValues = lhs.event->getValues();
+        const vector<FieldValue>& rhsValues = rhs.event->getValues();
+        for (size_t p = 0; p < lhsValues.size(); p++) {
+            if (lhsValues[p].mField != rhsValues[p].mField) {
+                return false;
+            }
+            if (lhsValues[p].mValue != rhsValues[p].mValue &&
+                !isAdditiveField(lhsValues[p], additiveFields)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+}  // namespace
+
 /**
  * Process all data and merge isolated with host if necessary.
  * For example:
@@ -80,77 +146,35 @@ void mapAndMergeIsolatedUidsToHostUid(vector<shared_ptr<LogEvent>>& data, const
         }
     }
 
-    // 2. sort the data, bit-wise
-    sort(data.begin(), data.end(),
-         [](const shared_ptr<LogEvent>& lhs, const shared_ptr<LogEvent>& rhs) {
-             if (lhs->size() != rhs->size()) {
-                 return lhs->size() < rhs->size();
-             }
-             const std::vector<FieldValue>& lhsValues = lhs->getValues();
-             const std::vector<FieldValue>& rhsValues = rhs->getValues();
-             for (int i = 0; i < (int)lhs->size(); i++) {
-                 if (lhsValues[i] != rhsValues[i]) {
-                     return lhsValues[i] < rhsValues[i];
-                 }
-             }
-             return false;
-         });
-
-    vector<shared_ptr<LogEvent>> mergedData;
-    const set<int> additiveFields(additiveFieldsVec.begin(), additiveFieldsVec.end());
-    bool needMerge = true;
-
-    // 3. do the merge.
-    // The loop invariant is this: for every event,
-    // - check if it has a different length (means different attribution chains or repeated fields)
-    // - check if fields are different
-    // - check if non-additive field values are different (non-additive is default for repeated
-    // fields)
-    // If any are true, no need to merge, add itself to the result. Otherwise, merge the
-    // value onto the one immediately next to it.
-    for (int i = 0; i < (int)data.size() - 1; i++) {
-        // Size different, must be different chains or repeated fields.
-        if (data[i]->size() != data[i + 1]->size()) {
-            mergedData.push_back(data[i]);
-            continue;
-        }
-        vector<FieldValue>* lhsValues = data[i]->getMutableValues();
-        vector<FieldValue>* rhsValues = data[i + 1]->getMutableValues();
-        needMerge = true;
-        for (int p = 0; p < (int)lhsValues->size(); p++) {
-            if ((*lhsValues)[p].mField != (*rhsValues)[p].mField) {
-                needMerge = false;
-                break;
-            }
-            if ((*lhsValues)[p].mValue != (*rhsValues)[p].mValue) {
-                int pos = (*lhsValues)[p].mField.getPosAtDepth(0);
-                // Differ on non-additive field, abort.
-                // Repeated additive fields are treated as non-additive fields.
-                if (isPrimitiveRepeatedField((*lhsValues)[p].mField) ||
-                    (additiveFields.find(pos) == additiveFields.end())) {
-                    needMerge = false;
-                    break;
-                }
+    // 2. merge the events in a single pass.
+    // Events are grouped by their fields and non-additive field values (non-additive is default
+    // for repeated fields), the first event of a group accumulates the additive field values of
+    // the rest of the group. Merged events keep the order of their first occurrence.
+    const MergeKeyEqual keyEqual{additiveFieldsVec};
+    unordered_set<MergeKey, MergeKeyHash, MergeKeyEqual> groups(data.size(), MergeKeyHash(),
+                                                                 keyEqual);
+    size_t mergedSize = 0;
+    for (size_t i = 0; i < data.size(); i++) {
+        LogEvent* event = data[i].get();
+        const auto [it, inserted] =
+                groups.insert({hashNonAdditiveFields(*event, additiveFieldsVec), event});
+        if (inserted) {
+            if (mergedSize != i) {
+                data[mergedSize] = std::move(data[i]);
             }
-        }
-        if (!needMerge) {
-            mergedData.push_back(data[i]);
+            mergedSize++;
             continue;
         }
         // This should be infrequent operation.
-        for (int p = 0; p < (int)lhsValues->size(); p++) {
-            int pos = (*lhsValues)[p].mField.getPosAtDepth(0);
-            // Don't merge repeated fields.
-            if (!isPrimitiveRepeatedField((*lhsValues)[p].mField) &&
-                (additiveFields.find(pos) != additiveFields.end())) {
-                (*rhsValues)[p].mValue += (*lhsValues)[p].mValue;
+        vector<FieldValue>* mergedValues = it->event->getMutableValues();
+        const vector<FieldValue>& values = event->getValues();
+        for (size_t p = 0; p < values.size(); p++) {
+            if (isAdditiveField(values[p], additiveFieldsVec)) {
+                (*mergedValues)[p].mValue += values[p].mValue;
             }
         }
     }
-    mergedData.push_back(data.back());
-
-    data.clear();
-    data = mergedData;
+    data.resize(mergedSize);
 }
 
 }  // namespace statsd
@@ -25,6 +25,11 @@ namespace android {
 namespace os {
 namespace statsd {
 
+/**
+ * Maps isolated uids in the pulled data to their host uids and merges the events which then
+ * only differ in additive field values. Merged events keep the order of their first occurrence
+ * in data.
+ */
 void mapAndMergeIsolatedUidsToHostUid(std::vector<std::shared_ptr<LogEvent>>& data,
                                       const sp<UidMap>& uidMap, int tagId,
                                       const vector<int>& additiveFieldsVec);
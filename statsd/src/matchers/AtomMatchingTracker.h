@@ -88,6 +88,12 @@ public:
         return mAtomIds;
     }
 
+    // Whether the result of this matcher only depends on the log event, so that it can be shared
+    // with identical matchers of other configs.
+    virtual bool isShareable() const {
+        return false;
+    }
+
     int64_t getId() const {
         return mId;
     }
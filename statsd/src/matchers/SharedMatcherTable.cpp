@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define STATSD_DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "SharedMatcherTable.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+int SharedMatcherTable::add(const sp<AtomMatchingTracker>& tracker) {
+    const auto [it, inserted] =
+            mSlotsByProtoHash.insert({tracker->getProtoHash(), (int)mTrackers.size()});
+    if (!inserted) {
+        return it->second;
+    }
+    const int slot = it->second;
+    mTrackers.push_back(tracker);
+    for (const int atomId : tracker->getAtomIds()) {
+        mSlotsByAtomId[atomId].push_back(slot);
+    }
+    mResults.push_back(MatchingState::kNotComputed);
+    mTransformations.push_back(nullptr);
+    return slot;
+}
+
+void SharedMatcherTable::clear() {
+    mTrackers.clear();
+    mSlotsByProtoHash.clear();
+    mSlotsByAtomId.clear();
+    mResults.clear();
+    mTransformations.clear();
+    mEvaluatedEvent = nullptr;
+}
+
+void SharedMatcherTable::onLogEvent(const LogEvent& event) {
+    clearResults();
+    const auto it = mSlotsByAtomId.find(event.GetTagId());
+    if (it == mSlotsByAtomId.end()) {
+        return;
+    }
+    for (const int slot : it->second) {
+        mResults[slot] = MatchingState::kNotComputed;
+        mTrackers[slot]->onLogEvent(event, slot, mTrackers, mResults, mTransformations);
+    }
+    mEvaluatedEvent = &event;
+}
+
+void SharedMatcherTable::clearResults() {
+    mEvaluatedEvent = nullptr;
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "AtomMatchingTracker.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Atom matchers that are identical across configs, deduplicated by the hash of their proto.
+ * Each of them is evaluated once per log event and all configs read the shared result.
+ *
+ * Only matchers whose result depends on nothing but the event can be added, see
+ * AtomMatchingTracker::isShareable().
+ */
+class SharedMatcherTable {
+public:
+    SharedMatcherTable() = default;
+
+    SharedMatcherTable(const SharedMatcherTable&) = delete;
+    SharedMatcherTable& operator=(const SharedMatcherTable&) = delete;
+
+    // Returns the slot of the matcher's result. Matchers with the same proto hash share a slot.
+    int add(const sp<AtomMatchingTracker>& tracker);
+
+    // Removes all matchers.
+    void clear();
+
+    // Evaluates the matchers of the event's atom. Their results are returned by getResult() until
+    // clearResults() is called.
+    void onLogEvent(const LogEvent& event);
+
+    void clearResults();
+
+    // Result of the matcher in the slot for event, kNotComputed if the event was not evaluated.
+    inline MatchingState getResult(const LogEvent& event, int slot) const {
+        return &event == mEvaluatedEvent ? mResults[slot] : MatchingState::kNotComputed;
+    }
+
+    inline size_t size() const {
+        return mTrackers.size();
+    }
+
+private:
+    // Matchers indexed by slot.
+    std::vector<sp<AtomMatchingTracker>> mTrackers;
+
+    // Slot of each matcher proto hash.
+    std::unordered_map<uint64_t, int> mSlotsByProtoHash;
+
+    // Slots of the matchers of each atom.
+    std::unordered_map<int, std::vector<int>> mSlotsByAtomId;
+
+    // Results of the last evaluated event, indexed by slot.
+    std::vector<MatchingState> mResults;
+
+    // Shareable matchers don't transform events, only needed to call onLogEvent.
+    std::vector<std::shared_ptr<LogEvent>> mTransformations;
+
+    const LogEvent* mEvaluatedEvent = nullptr;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
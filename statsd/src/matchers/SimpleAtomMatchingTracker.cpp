@@ -27,10 +27,26 @@ using std::shared_ptr;
 using std::unordered_map;
 using std::vector;
 
+namespace {
+
+bool hasStringTransformation(const SimpleAtomMatcher& matcher) {
+    for (const FieldValueMatcher& fvm : matcher.field_value_matcher()) {
+        if (fvm.has_replace_string()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
 SimpleAtomMatchingTracker::SimpleAtomMatchingTracker(const int64_t id, const uint64_t protoHash,
                                                      const SimpleAtomMatcher& matcher,
                                                      const sp<UidMap>& uidMap)
-    : AtomMatchingTracker(id, protoHash), mMatcher(matcher), mUidMap(uidMap) {
+    : AtomMatchingTracker(id, protoHash),
+      mMatcher(matcher),
+      mUidMap(uidMap),
+      mHasStringTransformation(hasStringTransformation(matcher)) {
     if (!matcher.has_atom_id()) {
         mInitialized = false;
     } else {
@@ -55,13 +71,8 @@ MatcherInitResult SimpleAtomMatchingTracker::init(
         return result;
     }
 
-    for (const FieldValueMatcher& fvm : mMatcher.field_value_matcher()) {
-        if (fvm.has_replace_string()) {
-            result.hasStringTransformation = true;
-            break;
-        }
-    }
-
+    result.hasStringTransformation = mHasStringTransformation;
+    mCompiledMatcher = compileSimpleAtomMatcher(mMatcher);
     return result;
 }
 
@@ -90,6 +101,14 @@ void SimpleAtomMatchingTracker::onLogEvent(
         return;
     }
 
+    if (mCompiledMatcher) {
+        const bool matched = matchesCompiled(mUidMap, *mCompiledMatcher, event);
+        matcherResults[matcherIndex] =
+                matched ? MatchingState::kMatched : MatchingState::kNotMatched;
+        VLOG("Stats SimpleAtomMatcher %lld matched? %d", (long long)mId, matched);
+        return;
+    }
+
     auto [matched, transformedEvent] = matchesSimple(mUidMap, mMatcher, event);
     matcherResults[matcherIndex] = matched ? MatchingState::kMatched : MatchingState::kNotMatched;
     VLOG("Stats SimpleAtomMatcher %lld matched? %d", (long long)mId, matched);
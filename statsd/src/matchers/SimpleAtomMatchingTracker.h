@@ -17,6 +17,7 @@
 #ifndef SIMPLE_ATOM_MATCHING_TRACKER_H
 #define SIMPLE_ATOM_MATCHING_TRACKER_H
 
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -49,9 +50,17 @@ public:
                     std::vector<MatchingState>& matcherResults,
                     std::vector<std::shared_ptr<LogEvent>>& matcherTransformations) override;
 
+    bool isShareable() const override {
+        return mInitialized && !mHasStringTransformation;
+    }
+
 private:
     const SimpleAtomMatcher mMatcher;
     const sp<UidMap> mUidMap;
+    const bool mHasStringTransformation;
+
+    // mMatcher compiled at init. nullopt if it needs to be interpreted by matchesSimple().
+    std::optional<CompiledSimpleAtomMatcher> mCompiledMatcher;
 };
 
 }  // namespace statsd
@@ -20,6 +20,8 @@
 
 #include <fnmatch.h>
 
+#include <algorithm>
+
 #include "matchers/AtomMatchingTracker.h"
 #include "src/statsd_config.pb.h"
 #include "stats_util.h"
@@ -184,6 +186,33 @@ static pair<int, int> getStartEndAtDepth(int targetField, int start, int end, in
     return {newStart, newEnd};
 }
 
+/*
+ * Narrows [start, end) down to the FIRST or LAST element of the repeated field at depth.
+ */
+static pair<int, int> getFirstOrLastRange(Position position, int start, int end, int depth,
+                                          const vector<FieldValue>& values) {
+    if (position == Position::FIRST) {
+        for (int i = start; i < end; i++) {
+            int pos = values[i].mField.getPosAtDepth(depth);
+            if (pos != 1) {
+                // Again, the log elements are stored in sorted order. so
+                // once the position is > 1, we break;
+                end = i;
+                break;
+            }
+        }
+    } else {
+        // move the starting index to the first LAST field at the depth.
+        for (int i = start; i < end; i++) {
+            if (values[i].mField.isLastPos(depth)) {
+                start = i;
+                break;
+            }
+        }
+    }
+    return {start, end};
+}
+
 /*
  * Returns pairs of start-end indices in vector<FieldValue> that pariticipate in matching.
  * The returned vector is empty if an error was encountered.
@@ -212,28 +241,10 @@ static vector<pair<int, int>> computeRanges(const FieldValueMatcher& matcher,
             return ranges;
         }
         switch (matcher.position()) {
-            case Position::FIRST: {
-                for (int i = start; i < end; i++) {
-                    int pos = values[i].mField.getPosAtDepth(depth);
-                    if (pos != 1) {
-                        // Again, the log elements are stored in sorted order. so
-                        // once the position is > 1, we break;
-                        end = i;
-                        break;
-                    }
-                }
-                ranges.push_back(std::make_pair(start, end));
-                break;
-            }
+            case Position::FIRST:
             case Position::LAST: {
-                // move the starting index to the first LAST field at the depth.
-                for (int i = start; i < end; i++) {
-                    if (values[i].mField.isLastPos(depth)) {
-                        start = i;
-                        break;
-                    }
-                }
-                ranges.push_back(std::make_pair(start, end));
+                ranges.push_back(
+                        getFirstOrLastRange(matcher.position(), start, end, depth, values));
                 break;
             }
             case Position::ALL:
@@ -576,6 +587,198 @@ MatchResult matchesSimple(const sp<UidMap>& uidMap, const SimpleAtomMatcher& sim
     return {true, std::move(transformedEvent)};
 }
 
+static bool compileFieldValueMatcher(const FieldValueMatcher& matcher,
+                                     CompiledFieldValueMatcher& compiled) {
+    if (matcher.has_replace_string()) {
+        return false;
+    }
+    compiled.field = matcher.field();
+    compiled.position = Position::POSITION_UNKNOWN;
+    if (matcher.has_position()) {
+        switch (matcher.position()) {
+            case Position::FIRST:
+            case Position::LAST:
+            case Position::ANY:
+                compiled.position = matcher.position();
+                break;
+            default:
+                return false;
+        }
+    }
+    compiled.intValue = 0;
+    compiled.floatValue = 0;
+    switch (matcher.value_matcher_case()) {
+        case FieldValueMatcher::ValueMatcherCase::kEqBool:
+            compiled.op = CompiledFieldValueMatcher::EQ_BOOL;
+            compiled.intValue = matcher.eq_bool() ? 1 : 0;
+            return true;
+        case FieldValueMatcher::ValueMatcherCase::kEqInt:
+            compiled.op = CompiledFieldValueMatcher::EQ_ANY_INT;
+            compiled.intValues.push_back(matcher.eq_int());
+            return true;
+        case FieldValueMatcher::ValueMatcherCase::kEqAnyInt:
+        case FieldValueMatcher::ValueMatcherCase::kNeqAnyInt: {
+            const bool eq =
+                    matcher.value_matcher_case() == FieldValueMatcher::ValueMatcherCase::kEqAnyInt;
+            compiled.op = eq ? CompiledFieldValueMatcher::EQ_ANY_INT
+                             : CompiledFieldValueMatcher::NEQ_ANY_INT;
+            const auto& intList = eq ? matcher.eq_any_int() : matcher.neq_any_int();
+            compiled.intValues.assign(intList.int_value().begin(), intList.int_value().end());
+            std::sort(compiled.intValues.begin(), compiled.intValues.end());
+            return true;
+        }
+        case FieldValueMatcher::ValueMatcherCase::kLtInt:
+            compiled.op = CompiledFieldValueMatcher::LT_INT;
+            compiled.intValue = matcher.lt_int();
+            return true;
+        case FieldValueMatcher::ValueMatcherCase::kGtInt:
+            compiled.op = CompiledFieldValueMatcher::GT_INT;
+            compiled.intValue = matcher.gt_int();
+            return true;
+        case FieldValueMatcher::ValueMatcherCase::kLteInt:
+            compiled.op = CompiledFieldValueMatcher::LTE_INT;
+            compiled.intValue = matcher.lte_int();
+            return true;
+        case FieldValueMatcher::ValueMatcherCase::kGteInt:
+            compiled.op = CompiledFieldValueMatcher::GTE_INT;
+            compiled.intValue = matcher.gte_int();
+            return true;
+        case FieldValueMatcher::ValueMatcherCase::kLtFloat:
+            compiled.op = CompiledFieldValueMatcher::LT_FLOAT;
+            compiled.floatValue = matcher.lt_float();
+            return true;
+        case FieldValueMatcher::ValueMatcherCase::kGtFloat:
+            compiled.op = CompiledFieldValueMatcher::GT_FLOAT;
+            compiled.floatValue = matcher.gt_float();
+            return true;
+        case FieldValueMatcher::ValueMatcherCase::kEqString:
+            compiled.op = CompiledFieldValueMatcher::EQ_ANY_STRING;
+            compiled.stringValues.insert(matcher.eq_string());
+            return true;
+        case FieldValueMatcher::ValueMatcherCase::kEqAnyString:
+        case FieldValueMatcher::ValueMatcherCase::kNeqAnyString: {
+            const bool eq = matcher.value_matcher_case() ==
+                            FieldValueMatcher::ValueMatcherCase::kEqAnyString;
+            compiled.op = eq ? CompiledFieldValueMatcher::EQ_ANY_STRING
+                             : CompiledFieldValueMatcher::NEQ_ANY_STRING;
+            const auto& strList = eq ? matcher.eq_any_string() : matcher.neq_any_string();
+            compiled.stringValues.insert(strList.str_value().begin(), strList.str_value().end());
+            return true;
+        }
+        default:
+            // matches_tuple, wildcard strings, or no value_matcher.
+            return false;
+    }
+}
+
+std::optional<CompiledSimpleAtomMatcher> compileSimpleAtomMatcher(
+        const SimpleAtomMatcher& simpleMatcher) {
+    CompiledSimpleAtomMatcher compiledMatcher;
+    compiledMatcher.atomId = simpleMatcher.atom_id();
+    compiledMatcher.fieldValueMatchers.resize(simpleMatcher.field_value_matcher_size());
+    for (int i = 0; i < simpleMatcher.field_value_matcher_size(); i++) {
+        if (!compileFieldValueMatcher(simpleMatcher.field_value_matcher(i),
+                                      compiledMatcher.fieldValueMatchers[i])) {
+            return std::nullopt;
+        }
+    }
+    return compiledMatcher;
+}
+
+static inline bool getIntValue(const Value& value, int64_t& intValue) {
+    if (value.getType() == INT) {
+        intValue = value.int_value;
+        return true;
+    }
+    if (value.getType() == LONG) {
+        intValue = value.long_value;
+        return true;
+    }
+    return false;
+}
+
+static bool matchesAnyString(const sp<UidMap>& uidMap, const FieldValue& fieldValue,
+                             const std::unordered_set<string>& strings) {
+    if (isAttributionUidField(fieldValue) || isUidField(fieldValue)) {
+        for (const string& str : strings) {
+            if (tryMatchString(uidMap, fieldValue, str)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return fieldValue.mValue.getType() == STRING &&
+           strings.find(fieldValue.mValue.str_value) != strings.end();
+}
+
+static bool matchesValue(const sp<UidMap>& uidMap, const CompiledFieldValueMatcher& matcher,
+                         const FieldValue& fieldValue) {
+    const Value& value = fieldValue.mValue;
+    int64_t intValue;
+    switch (matcher.op) {
+        case CompiledFieldValueMatcher::EQ_BOOL:
+            return getIntValue(value, intValue) && (intValue != 0) == (matcher.intValue != 0);
+        case CompiledFieldValueMatcher::EQ_ANY_INT:
+            return getIntValue(value, intValue) &&
+                   std::binary_search(matcher.intValues.begin(), matcher.intValues.end(),
+                                      intValue);
+        case CompiledFieldValueMatcher::NEQ_ANY_INT:
+            return !getIntValue(value, intValue) ||
+                   !std::binary_search(matcher.intValues.begin(), matcher.intValues.end(),
+                                       intValue);
+        case CompiledFieldValueMatcher::LT_INT:
+            return getIntValue(value, intValue) && intValue < matcher.intValue;
+        case CompiledFieldValueMatcher::GT_INT:
+            return getIntValue(value, intValue) && intValue > matcher.intValue;
+        case CompiledFieldValueMatcher::LTE_INT:
+            return getIntValue(value, intValue) && intValue <= matcher.intValue;
+        case CompiledFieldValueMatcher::GTE_INT:
+            return getIntValue(value, intValue) && intValue >= matcher.intValue;
+        case CompiledFieldValueMatcher::LT_FLOAT:
+            return value.getType() == FLOAT && value.float_value < matcher.floatValue;
+        case CompiledFieldValueMatcher::GT_FLOAT:
+            return value.getType() == FLOAT && value.float_value > matcher.floatValue;
+        case CompiledFieldValueMatcher::EQ_ANY_STRING:
+            return matchesAnyString(uidMap, fieldValue, matcher.stringValues);
+        case CompiledFieldValueMatcher::NEQ_ANY_STRING:
+            return !matchesAnyString(uidMap, fieldValue, matcher.stringValues);
+    }
+    return false;
+}
+
+bool matchesCompiled(const sp<UidMap>& uidMap, const CompiledSimpleAtomMatcher& compiledMatcher,
+                     const LogEvent& event) {
+    if (event.GetTagId() != compiledMatcher.atomId) {
+        return false;
+    }
+    const vector<FieldValue>& values = event.getValues();
+    for (const CompiledFieldValueMatcher& matcher : compiledMatcher.fieldValueMatchers) {
+        auto [start, end] = getStartEndAtDepth(matcher.field, 0, values.size(), 0, values);
+        if (start == -1) {
+            // No such field found.
+            return false;
+        }
+        if (matcher.position == Position::FIRST || matcher.position == Position::LAST) {
+            // Repeated fields position is stored as a node in the path.
+            std::tie(start, end) =
+                    getFirstOrLastRange(matcher.position, start, end, /*depth=*/1, values);
+        }
+        // If the field matcher ends with ANY, then we have [start, end) range > 1. The matcher
+        // matches when ANY of the values matches.
+        bool matched = false;
+        for (int i = start; i < end; i++) {
+            if (matchesValue(uidMap, matcher, values[i])) {
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            return false;
+        }
+    }
+    return true;
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
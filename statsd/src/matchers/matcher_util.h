@@ -18,6 +18,9 @@
 
 #include "logd/LogEvent.h"
 
+#include <optional>
+#include <string>
+#include <unordered_set>
 #include <vector>
 #include "src/statsd_config.pb.h"
 #include "packages/UidMap.h"
@@ -44,6 +47,57 @@ bool combinationMatch(const std::vector<int>& children, const LogicalOperation&
 MatchResult matchesSimple(const sp<UidMap>& uidMap, const SimpleAtomMatcher& simpleMatcher,
                           const LogEvent& wrapper);
 
+/**
+ * A FieldValueMatcher on a top level field, lowered into a flat predicate that is evaluated
+ * without interpreting the proto and without allocating.
+ */
+struct CompiledFieldValueMatcher {
+    enum Op : uint8_t {
+        EQ_BOOL,
+        EQ_ANY_INT,
+        NEQ_ANY_INT,
+        LT_INT,
+        GT_INT,
+        LTE_INT,
+        GTE_INT,
+        LT_FLOAT,
+        GT_FLOAT,
+        EQ_ANY_STRING,
+        NEQ_ANY_STRING,
+    };
+
+    int32_t field;
+    // POSITION_UNKNOWN if the matcher has no position.
+    Position position;
+    Op op;
+    // Operand of EQ_BOOL (0 or 1) and of the integer comparisons.
+    int64_t intValue;
+    // Operand of the float comparisons.
+    float floatValue;
+    // Operands of EQ_ANY_INT and NEQ_ANY_INT, sorted.
+    std::vector<int64_t> intValues;
+    // Operands of EQ_ANY_STRING and NEQ_ANY_STRING.
+    std::unordered_set<std::string> stringValues;
+};
+
+struct CompiledSimpleAtomMatcher {
+    int32_t atomId;
+    std::vector<CompiledFieldValueMatcher> fieldValueMatchers;
+};
+
+/**
+ * Compiles simpleMatcher. Returns nullopt if simpleMatcher uses features that are only supported
+ * by matchesSimple(): nested fields, matches_tuple, wildcard strings and string transformations.
+ */
+std::optional<CompiledSimpleAtomMatcher> compileSimpleAtomMatcher(
+        const SimpleAtomMatcher& simpleMatcher);
+
+/**
+ * Same result as matchesSimple() for the SimpleAtomMatcher compiledMatcher was compiled from.
+ */
+bool matchesCompiled(const sp<UidMap>& uidMap, const CompiledSimpleAtomMatcher& compiledMatcher,
+                     const LogEvent& event);
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -215,14 +215,16 @@ void CountMetricProducer::onSlicedConditionMayChangeLocked(bool overallCondition
 
 
 void CountMetricProducer::clearPastBucketsLocked(const int64_t dumpTimeNs) {
+    mDeferredClosedCounter = nullptr;
     mPastBuckets.clear();
     mTotalDataSize = 0;
+    mUntrackedDataSize = 0;
 }
 
 void CountMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                                              const bool include_current_partial_bucket,
                                              const bool erase_data, const DumpLatency dumpLatency,
-                                             std::set<string>* str_set,
+                                             StringDictionary* str_set,
                                              ProtoOutputStream* protoOutput) {
     if (include_current_partial_bucket) {
         flushLocked(dumpTimeNs);
@@ -320,6 +322,7 @@ void CountMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
         mPastBuckets.clear();
         mDimensionGuardrailHit = false;
         mTotalDataSize = 0;
+        mUntrackedDataSize = 0;
     }
 }
 
@@ -328,6 +331,7 @@ void CountMetricProducer::dropDataLocked(const int64_t dropTimeNs) {
     StatsdStats::getInstance().noteBucketDropped(mMetricId);
     mPastBuckets.clear();
     mTotalDataSize = 0;
+    mUntrackedDataSize = 0;
 }
 
 void CountMetricProducer::onConditionChangedLocked(const bool conditionMet,
@@ -378,6 +382,11 @@ void CountMetricProducer::onMatchedLogEventInternalLocked(
         return;
     }
 
+    if (mDeferredClosedCounter != nullptr && eventTimeNs < mCurrentBucketStartTimeNs) {
+        countInDeferredClosedBucketLocked(eventKey);
+        return;
+    }
+
     auto it = mCurrentSlicedCounter->find(eventKey);
     if (it == mCurrentSlicedCounter->end()) {
         // ===========GuardRail==============
@@ -408,6 +417,10 @@ void CountMetricProducer::onMatchedLogEventInternalLocked(
 // When a new matched event comes in, we check if event falls into the current
 // bucket. If not, flush the old counter to past buckets and initialize the new bucket.
 void CountMetricProducer::flushIfNeededLocked(const int64_t eventTimeNs) {
+    if (eventTimeNs >= mCurrentBucketStartTimeNs) {
+        // The metric would have closed the bucket closed by flushEndedBucketLocked() by now.
+        mDeferredClosedCounter = nullptr;
+    }
     int64_t currentBucketEndTimeNs = getCurrentBucketEndTimeNs();
     if (eventTimeNs < currentBucketEndTimeNs) {
         return;
@@ -423,6 +436,64 @@ void CountMetricProducer::flushIfNeededLocked(const int64_t eventTimeNs) {
          (long long)mCurrentBucketStartTimeNs);
 }
 
+void CountMetricProducer::flushEndedBucketLocked(const int64_t eventTimeNs) {
+    const int64_t currentBucketEndTimeNs = getCurrentBucketEndTimeNs();
+    if (eventTimeNs < currentBucketEndTimeNs || !supportsDeferredFlushLocked()) {
+        return;
+    }
+    // Only close the ended bucket, so that the events older than the next bucket belong to it.
+    shared_ptr<DimToValMap> counter = mCurrentSlicedCounter;
+    flushIfNeededLocked(currentBucketEndTimeNs);
+    mDeferredClosedCounter = std::move(counter);
+    mDeferredClosedBucket = mLastClosedBucket;
+}
+
+void CountMetricProducer::countInDeferredClosedBucketLocked(const MetricDimensionKey& eventKey) {
+    DimToValMap& counter = *mDeferredClosedCounter;
+    auto it = counter.find(eventKey);
+    if (it == counter.end()) {
+        if (counter.size() >= mDimensionHardLimit) {
+            mDimensionGuardrailHit = true;
+            StatsdStats::getInstance().noteHardDimensionLimitReached(mMetricId);
+            return;
+        }
+        it = counter.emplace(eventKey, 0).first;
+    }
+    const bool passedThreshold = it->second > 0 && countPassesThreshold(it->second);
+    it->second++;
+    const bool passesThreshold = countPassesThreshold(it->second);
+
+    // Update the past bucket of the key as flushCurrentBucketLocked() would have written it.
+    auto& bucketList = mPastBuckets[eventKey];
+    if (passedThreshold && !bucketList.empty() &&
+        bucketList.back().mBucketStartNs == mDeferredClosedBucket.mBucketStartNs) {
+        if (passesThreshold) {
+            bucketList.back().mCount = it->second;
+            return;
+        }
+        bucketList.pop_back();
+        mTotalDataSize -= computeBucketSizeLocked(/*isFullBucket=*/false, eventKey,
+                                                  /*isFirstBucket=*/bucketList.empty());
+        if (bucketList.empty()) {
+            mPastBuckets.erase(eventKey);
+            mUntrackedDataSize -= eventKey.getSize(mShouldUseNestedDimensions);
+        }
+    } else if (passesThreshold) {
+        const bool isFirstBucket = bucketList.empty();
+        CountBucket info = mDeferredClosedBucket;
+        info.mCount = it->second;
+        bucketList.push_back(info);
+        // Sized as flushCurrentBucketLocked() sizes a bucket closed at its end.
+        mTotalDataSize +=
+                computeBucketSizeLocked(/*isFullBucket=*/false, eventKey, isFirstBucket);
+        if (isFirstBucket) {
+            mUntrackedDataSize += eventKey.getSize(mShouldUseNestedDimensions);
+        }
+    } else if (bucketList.empty()) {
+        mPastBuckets.erase(eventKey);
+    }
+}
+
 bool CountMetricProducer::countPassesThreshold(const int64_t count) {
     if (mUploadThreshold == nullopt) {
         return true;
@@ -457,6 +528,7 @@ void CountMetricProducer::flushCurrentBucketLocked(const int64_t eventTimeNs,
     const auto [globalConditionTrueNs, globalConditionCorrectionNs] =
             mConditionTimer.newBucketStart(eventTimeNs, nextBucketStartTimeNs);
     info.mConditionTrueNs = globalConditionTrueNs;
+    mLastClosedBucket = info;
 
     for (const auto& counter : *mCurrentSlicedCounter) {
         if (countPassesThreshold(counter.second)) {
@@ -466,6 +538,10 @@ void CountMetricProducer::flushCurrentBucketLocked(const int64_t eventTimeNs,
             bucketList.push_back(info);
             mTotalDataSize += computeBucketSizeLocked(eventTimeNs < fullBucketEndTimeNs,
                                                       counter.first, isFirstBucket);
+            if (isFirstBucket) {
+                // The values of the key are not allocated through mMemoryResource.
+                mUntrackedDataSize += counter.first.getSize(mShouldUseNestedDimensions);
+            }
             VLOG("metric %lld, dump key value: %s -> %lld", (long long)mMetricId,
                  counter.first.toString().c_str(), (long long)counter.second);
         }
@@ -512,6 +588,11 @@ void CountMetricProducer::flushCurrentBucketLocked(const int64_t eventTimeNs,
 // CountMetricData is  duplicated.
 size_t CountMetricProducer::byteSizeLocked() const {
     sp<ConfigMetadataProvider> configMetadataProvider = getConfigMetadataProvider();
+    if (configMetadataProvider != nullptr &&
+        configMetadataProvider->useTrackedMemoryCalculation()) {
+        return computeOverheadSizeLocked(!mPastBuckets.empty(), mDimensionGuardrailHit) +
+               computeTrackedDataSizeLocked();
+    }
     if (configMetadataProvider != nullptr && configMetadataProvider->useV2SoftMemoryCalculation()) {
         return computeOverheadSizeLocked(!mPastBuckets.empty(), mDimensionGuardrailHit) +
                mTotalDataSize;
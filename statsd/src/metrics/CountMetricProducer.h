@@ -20,6 +20,7 @@
 #include <android/util/ProtoOutputStream.h>
 #include <gtest/gtest_prod.h>
 
+#include <memory_resource>
 #include <unordered_map>
 
 #include "MetricProducer.h"
@@ -76,7 +77,7 @@ private:
                             const bool include_current_partial_bucket,
                             const bool erase_data,
                             const DumpLatency dumpLatency,
-                            std::set<string> *str_set,
+                            StringDictionary* str_set,
                             android::util::ProtoOutputStream* protoOutput) override;
 
     void clearPastBucketsLocked(const int64_t dumpTimeNs) override;
@@ -97,6 +98,19 @@ private:
     // Util function to flush the old packet.
     void flushIfNeededLocked(int64_t newEventTime) override;
 
+    // The late events counted in a bucket closed by flushEndedBucketLocked() are not sent to the
+    // anomaly trackers, which already received the bucket. The late events must go to the bucket
+    // closed before, so the current bucket is not closed until an event of the metric is in it.
+    bool supportsDeferredFlushLocked() const override {
+        return mAnomalyTrackers.empty() && mDeferredClosedCounter == nullptr;
+    }
+
+    void flushEndedBucketLocked(int64_t eventTimeNs) override;
+
+    // Counts an event older than the current bucket in the bucket closed by
+    // flushEndedBucketLocked().
+    void countInDeferredClosedBucketLocked(const MetricDimensionKey& eventKey);
+
     void flushCurrentBucketLocked(int64_t eventTimeNs, int64_t nextBucketStartTimeNs) override;
 
     void onActiveStateChangedLocked(const int64_t eventTimeNs, const bool isActive) override;
@@ -120,7 +134,8 @@ private:
             std::unordered_map<int, std::vector<int>>& deactivationAtomTrackerToMetricMap,
             std::vector<int>& metricsWithActivation) override;
 
-    std::unordered_map<MetricDimensionKey, std::vector<CountBucket>> mPastBuckets;
+    std::pmr::unordered_map<MetricDimensionKey, std::pmr::vector<CountBucket>> mPastBuckets{
+            &mMemoryResource};
 
     // The current bucket (may be a partial bucket).
     std::shared_ptr<DimToValMap> mCurrentSlicedCounter = std::make_shared<DimToValMap>();
@@ -129,6 +144,16 @@ private:
     // partial bucket). This is only updated while flushing the current bucket.
     std::shared_ptr<DimToValMap> mCurrentFullCounters = std::make_shared<DimToValMap>();
 
+    // The last bucket closed by flushCurrentBucketLocked(), without its count.
+    CountBucket mLastClosedBucket;
+
+    // The counters and the bucket closed by flushEndedBucketLocked(), until the metric would have
+    // closed the bucket itself, i.e. until it is flushed at a time of the current bucket. The
+    // events older than the current bucket are counted in it meanwhile, as they would have been
+    // if the bucket was still open. Null if there is no such bucket.
+    std::shared_ptr<DimToValMap> mDeferredClosedCounter;
+    CountBucket mDeferredClosedBucket;
+
     static const size_t kBucketSize = sizeof(CountBucket{});
 
     bool hitGuardRailLocked(const MetricDimensionKey& newKey);
@@ -147,6 +172,7 @@ private:
     FRIEND_TEST(CountMetricProducerTest, TestFirstBucket);
     FRIEND_TEST(CountMetricProducerTest, TestOneWeekTimeUnit);
     FRIEND_TEST(CountMetricProducerTest, TestSplitOnAppUpgradeDisabled);
+    FRIEND_TEST(CountMetricProducerTest, TestTrackedMemory);
 
     FRIEND_TEST(CountMetricProducerTest_PartialBucket, TestSplitInCurrentBucket);
     FRIEND_TEST(CountMetricProducerTest_PartialBucket, TestSplitInNextBucket);
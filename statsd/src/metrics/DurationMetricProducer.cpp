@@ -510,7 +510,7 @@ void DurationMetricProducer::clearPastBucketsLocked(const int64_t dumpTimeNs) {
 
 void DurationMetricProducer::onDumpReportLocked(
         const int64_t dumpTimeNs, const bool include_current_partial_bucket, const bool erase_data,
-        const DumpLatency dumpLatency, std::set<string>* str_set, ProtoOutputStream* protoOutput) {
+        const DumpLatency dumpLatency, StringDictionary* str_set, ProtoOutputStream* protoOutput) {
     if (include_current_partial_bucket) {
         flushLocked(dumpTimeNs);
     } else {
@@ -758,7 +758,7 @@ void DurationMetricProducer::handleMatchedLogEventValuesLocked(const size_t matc
 
     HashableDimensionKey dimensionInWhat = DEFAULT_DIMENSION_KEY;
     if (!mDimensionsInWhat.empty()) {
-        filterValues(mDimensionsInWhat, values, &dimensionInWhat);
+        filterValues(mDimensionsInWhat, values, &mDimensionsInWhatPositions, &dimensionInWhat);
     }
 
     // Stores atom id to primary key pairs for each state atom that the metric is
@@ -867,8 +867,7 @@ size_t DurationMetricProducer::computeBucketSizeLocked(const bool isFullBucket,
 
 size_t DurationMetricProducer::byteSizeLocked() const {
     size_t totalSize = 0;
-    sp<ConfigMetadataProvider> configMetadataProvider = getConfigMetadataProvider();
-    if (configMetadataProvider != nullptr && configMetadataProvider->useV2SoftMemoryCalculation()) {
+    if (useV2SoftMemoryCalculationLocked()) {
         bool hasHitDimensionGuardrail =
                 StatsdStats::getInstance().hasHitDimensionGuardrail(mMetricId);
         totalSize += computeOverheadSizeLocked(!mPastBuckets.empty(), hasHitDimensionGuardrail);
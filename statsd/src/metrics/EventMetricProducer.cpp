@@ -137,7 +137,7 @@ optional<InvalidConfigReason> EventMetricProducer::onConfigUpdatedLocked(
 }
 
 void EventMetricProducer::dropDataLocked(const int64_t dropTimeNs) {
-    mAggregatedAtoms.clear();
+    clearAggregatedAtomsLocked();
     resetDataCorruptionFlagsLocked();
     mTotalDataSize = 0;
     StatsdStats::getInstance().noteBucketDropped(mMetricId);
@@ -165,7 +165,7 @@ std::unique_ptr<std::vector<uint8_t>> serializeProtoLocked(ProtoOutputStream& pr
 }
 
 void EventMetricProducer::clearPastBucketsLocked(const int64_t dumpTimeNs) {
-    mAggregatedAtoms.clear();
+    clearAggregatedAtomsLocked();
     resetDataCorruptionFlagsLocked();
     mTotalDataSize = 0;
 }
@@ -174,7 +174,7 @@ void EventMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                                              const bool include_current_partial_bucket,
                                              const bool erase_data,
                                              const DumpLatency dumpLatency,
-                                             std::set<string> *str_set,
+                                             StringDictionary* str_set,
                                              ProtoOutputStream* protoOutput) {
     protoOutput->write(FIELD_TYPE_INT64 | FIELD_ID_ID, (long long)mMetricId);
     protoOutput->write(FIELD_TYPE_BOOL | FIELD_ID_IS_ACTIVE, isActiveLocked());
@@ -208,7 +208,7 @@ void EventMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
 
     protoOutput->end(protoToken);
     if (erase_data) {
-        mAggregatedAtoms.clear();
+        clearAggregatedAtomsLocked();
         resetDataCorruptionFlagsLocked();
         mTotalDataSize = 0;
     }
@@ -233,9 +233,7 @@ void EventMetricProducer::onMatchedLogEventInternalLocked(
     }
 
     const int64_t elapsedTimeNs = truncateTimestampIfNecessary(event);
-    AtomDimensionKey key(event.GetTagId(), HashableDimensionKey(event.getValues()));
-
-    std::vector<int64_t>& aggregatedTimestampsNs = mAggregatedAtoms[key];
+    auto& [key, aggregatedTimestampsNs] = getOrCreateAggregatedAtomLocked(event);
     if (aggregatedTimestampsNs.empty()) {
         sp<ConfigMetadataProvider> provider = getConfigMetadataProvider();
         if (provider != nullptr && provider->useV2SoftMemoryCalculation()) {
@@ -243,13 +241,38 @@ void EventMetricProducer::onMatchedLogEventInternalLocked(
         } else {
             mTotalDataSize += getSize(key.getAtomFieldValues().getValues());
         }
+        // The values of the key are not allocated through mMemoryResource.
+        mUntrackedDataSize += getFieldValuesSizeV2(key.getAtomFieldValues().getValues());
     }
     aggregatedTimestampsNs.push_back(elapsedTimeNs);
     mTotalDataSize += sizeof(int64_t);  // Add the size of the event timestamp
 }
 
+EventMetricProducer::AggregatedAtom& EventMetricProducer::getOrCreateAggregatedAtomLocked(
+        const LogEvent& event) {
+    const int32_t tagId = event.GetTagId();
+    const vector<FieldValue>& values = event.getValues();
+    const auto it = mAggregatedAtoms.find(AtomDimensionKeyView{tagId, values});
+    if (it != mAggregatedAtoms.end()) {
+        return *it;
+    }
+
+    // First time the atom is seen, copy its values into the key.
+    return *mAggregatedAtoms.try_emplace(AtomDimensionKey(tagId, HashableDimensionKey(values)))
+                    .first;
+}
+
+void EventMetricProducer::clearAggregatedAtomsLocked() {
+    mAggregatedAtoms.clear();
+    mUntrackedDataSize = 0;
+}
+
 size_t EventMetricProducer::byteSizeLocked() const {
     sp<ConfigMetadataProvider> provider = getConfigMetadataProvider();
+    if (provider != nullptr && provider->useTrackedMemoryCalculation()) {
+        return computeTrackedDataSizeLocked() +
+               computeOverheadSizeLocked(/*hasPastBuckets=*/false, /*dimensionGuardrailHit=*/false);
+    }
     if (provider != nullptr && provider->useV2SoftMemoryCalculation()) {
         return mTotalDataSize +
                computeOverheadSizeLocked(/*hasPastBuckets=*/false, /*dimensionGuardrailHit=*/false);
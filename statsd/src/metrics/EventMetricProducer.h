@@ -17,6 +17,7 @@
 #ifndef EVENT_METRIC_PRODUCER_H
 #define EVENT_METRIC_PRODUCER_H
 
+#include <memory_resource>
 #include <unordered_map>
 
 #include <android/util/ProtoOutputStream.h>
@@ -61,7 +62,7 @@ private:
                             const bool include_current_partial_bucket,
                             const bool erase_data,
                             const DumpLatency dumpLatency,
-                            std::set<string> *str_set,
+                            StringDictionary* str_set,
                             android::util::ProtoOutputStream* protoOutput) override;
     void clearPastBucketsLocked(const int64_t dumpTimeNs) override;
 
@@ -98,9 +99,22 @@ private:
                                                        LostAtomType atomType) const override;
 
     // Maps the field/value pairs of an atom to a list of timestamps used to deduplicate atoms.
-    std::unordered_map<AtomDimensionKey, std::vector<int64_t>> mAggregatedAtoms;
+    // The hash and equality are transparent, so that the entry of a logged event is found
+    // without copying its values into an AtomDimensionKey.
+    std::pmr::unordered_map<AtomDimensionKey, std::pmr::vector<int64_t>, AtomDimensionKeyHash,
+                            AtomDimensionKeyEqual>
+            mAggregatedAtoms{&mMemoryResource};
+
+    using AggregatedAtom = std::pair<const AtomDimensionKey, std::pmr::vector<int64_t>>;
+
+    // Returns the entry of the event in mAggregatedAtoms, adding it if needed.
+    AggregatedAtom& getOrCreateAggregatedAtomLocked(const LogEvent& event);
+
+    void clearAggregatedAtomsLocked();
 
     const int mSamplingPercentage;
+
+    FRIEND_TEST(EventMetricProducerTest, TestTrackedMemory);
 };
 
 }  // namespace statsd
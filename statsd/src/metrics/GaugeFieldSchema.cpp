@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define STATSD_DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "GaugeFieldSchema.h"
+
+#include <string.h>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+size_t hashLayout(const vector<FieldValue>& values) {
+    uint32_t hash = 0;
+    for (const FieldValue& fieldValue : values) {
+        hash = android::JenkinsHashMix(hash, android::hash_type(fieldValue.mField.getTag()));
+        hash = android::JenkinsHashMix(hash, android::hash_type(fieldValue.mField.getField()));
+        hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mValue.getType()));
+    }
+    return android::JenkinsHashWhiten(hash);
+}
+
+bool sameLayout(const vector<FieldValue>& layout, const vector<FieldValue>& values) {
+    if (layout.size() != values.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < layout.size(); i++) {
+        if (layout[i].mField != values[i].mField ||
+            layout[i].mValue.getType() != values[i].mValue.getType()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+size_t PackedGaugeAtom::hash() const {
+    uint32_t hash = android::hash_type(mLayoutIndex);
+    hash = android::JenkinsHashMixBytes(hash, reinterpret_cast<const uint8_t*>(mWords.data()),
+                                        mWords.size() * sizeof(int64_t));
+    return android::JenkinsHashWhiten(hash);
+}
+
+PackedGaugeAtom GaugeFieldSchema::pack(const vector<FieldValue>& values) {
+    PackedGaugeAtom atom;
+    atom.mLayoutIndex = getOrAddLayout(values);
+    atom.mWords.resize(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        const Value& value = values[i].mValue;
+        int64_t& word = atom.mWords[i];
+        switch (value.getType()) {
+            case INT:
+                word = value.int_value;
+                break;
+            case LONG:
+                word = value.long_value;
+                break;
+            case FLOAT: {
+                uint32_t bits;
+                memcpy(&bits, &value.float_value, sizeof(bits));
+                word = bits;
+                break;
+            }
+            case DOUBLE:
+                memcpy(&word, &value.double_value, sizeof(word));
+                break;
+            case STRING:
+                word = internString(value.str_value);
+                break;
+            case STORAGE:
+                word = internString(string(value.storage_value.begin(), value.storage_value.end()));
+                break;
+            default:
+                word = 0;
+                break;
+        }
+    }
+    return atom;
+}
+
+void GaugeFieldSchema::unpack(const PackedGaugeAtom& atom, vector<FieldValue>* values) const {
+    *values = mLayouts[atom.mLayoutIndex];
+    for (size_t i = 0; i < values->size(); i++) {
+        Value& value = (*values)[i].mValue;
+        const int64_t word = atom.mWords[i];
+        switch (value.getType()) {
+            case INT:
+                value.int_value = (int32_t)word;
+                break;
+            case LONG:
+                value.long_value = word;
+                break;
+            case FLOAT: {
+                const uint32_t bits = (uint32_t)word;
+                memcpy(&value.float_value, &bits, sizeof(bits));
+                break;
+            }
+            case DOUBLE:
+                memcpy(&value.double_value, &word, sizeof(word));
+                break;
+            case STRING:
+                value.str_value = *mStrings[word];
+                break;
+            case STORAGE: {
+                const string& bytes = *mStrings[word];
+                value.storage_value.assign(bytes.begin(), bytes.end());
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+vector<FieldValue> GaugeFieldSchema::unpack(const PackedGaugeAtom& atom) const {
+    vector<FieldValue> values;
+    unpack(atom, &values);
+    return values;
+}
+
+void GaugeFieldSchema::clear() {
+    mLayouts.clear();
+    mLayoutsByHash.clear();
+    mStrings.clear();
+    mStringIds.clear();
+    mStringsByteSize = 0;
+}
+
+size_t GaugeFieldSchema::getByteSize() const {
+    size_t size = mStringsByteSize + mStrings.size() * sizeof(const string*);
+    for (const vector<FieldValue>& layout : mLayouts) {
+        size += layout.size() * sizeof(FieldValue);
+    }
+    return size;
+}
+
+int32_t GaugeFieldSchema::getOrAddLayout(const vector<FieldValue>& values) {
+    const size_t hash = hashLayout(values);
+    const auto [begin, end] = mLayoutsByHash.equal_range(hash);
+    for (auto it = begin; it != end; it++) {
+        if (sameLayout(mLayouts[it->second], values)) {
+            return it->second;
+        }
+    }
+
+    const int32_t index = mLayouts.size();
+    vector<FieldValue>& layout = mLayouts.emplace_back(values);
+    for (FieldValue& fieldValue : layout) {
+        fieldValue.mValue.long_value = 0;
+        fieldValue.mValue.str_value.clear();
+        fieldValue.mValue.str_value.shrink_to_fit();
+        fieldValue.mValue.storage_value.clear();
+        fieldValue.mValue.storage_value.shrink_to_fit();
+    }
+    mLayoutsByHash.emplace(hash, index);
+    VLOG("GaugeFieldSchema added layout %d with %zu fields", index, layout.size());
+    return index;
+}
+
+int64_t GaugeFieldSchema::internString(const string& str) {
+    const auto it = mStringIds.find(str);
+    if (it != mStringIds.end()) {
+        return it->second;
+    }
+    const int64_t id = mStrings.size();
+    mStrings.push_back(&mStringIds.emplace(str, id).first->first);
+    mStringsByteSize += str.size();
+    return id;
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FieldValue.h"
+#include "HashableDimensionKey.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Gauge atom packed by a GaugeFieldSchema: the index of its layout and one word per field value.
+ * Strings and byte fields are stored as ids in the schema's string pool, so two packed atoms are
+ * equal iff the atoms they were packed from are equal.
+ */
+struct PackedGaugeAtom {
+    int32_t mLayoutIndex = 0;
+    std::vector<int64_t> mWords;
+
+    inline bool operator==(const PackedGaugeAtom& that) const {
+        return mLayoutIndex == that.mLayoutIndex && mWords == that.mWords;
+    }
+
+    size_t hash() const;
+};
+
+/**
+ * Field metadata of the gauge atoms of a metric, kept once instead of next to every value.
+ *
+ * A layout is the sequence of fields and value types of an atom. Most atoms only ever have one
+ * layout, repeated fields and attribution chains add one per distinct length. Strings and byte
+ * fields are interned, so a pulled atom reporting the same strings every bucket only stores them
+ * once.
+ *
+ * Packed atoms are only valid for the schema that packed them, until clear() is called.
+ */
+class GaugeFieldSchema {
+public:
+    GaugeFieldSchema() = default;
+
+    GaugeFieldSchema(const GaugeFieldSchema&) = delete;
+    GaugeFieldSchema& operator=(const GaugeFieldSchema&) = delete;
+
+    PackedGaugeAtom pack(const std::vector<FieldValue>& values);
+
+    // Writes the field values of atom to values, reusing its storage.
+    void unpack(const PackedGaugeAtom& atom, std::vector<FieldValue>* values) const;
+
+    std::vector<FieldValue> unpack(const PackedGaugeAtom& atom) const;
+
+    // Removes all layouts and strings. Must only be called once no packed atom is in use.
+    void clear();
+
+    inline size_t getNumLayouts() const {
+        return mLayouts.size();
+    }
+
+    inline size_t getNumStrings() const {
+        return mStrings.size();
+    }
+
+    // Estimated memory used by the layouts and the string pool.
+    size_t getByteSize() const;
+
+private:
+    // Returns the index of the layout of values, adding it if needed.
+    int32_t getOrAddLayout(const std::vector<FieldValue>& values);
+
+    int64_t internString(const std::string& str);
+
+    // Field values of each layout with the value types set and the contents left empty.
+    std::vector<std::vector<FieldValue>> mLayouts;
+
+    // Indices of mLayouts by the hash of their fields and types.
+    std::unordered_multimap<size_t, int32_t> mLayoutsByHash;
+
+    // Interned strings and byte fields by id. They point to the keys of mStringIds.
+    std::vector<const std::string*> mStrings;
+
+    std::unordered_map<std::string, int64_t> mStringIds;
+
+    size_t mStringsByteSize = 0;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+
+template <>
+struct std::hash<android::os::statsd::PackedGaugeAtom> {
+    std::size_t operator()(const android::os::statsd::PackedGaugeAtom& atom) const {
+        return atom.hash();
+    }
+};
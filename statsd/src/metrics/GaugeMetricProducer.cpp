@@ -106,7 +106,7 @@ GaugeMetricProducer::GaugeMetricProducer(
       mDimensionGuardrailHit(false),
       mSamplingPercentage(metric.sampling_percentage()),
       mPullProbability(metric.pull_probability()) {
-    mCurrentSlicedBucket = std::make_shared<DimToGaugeAtomsMap>();
+    mCurrentSlicedBucket = std::make_shared<DimToGaugeAtomsMap>(&mCurrentBucketArena);
     mCurrentSlicedBucketForAnomaly = std::make_shared<DimToValMap>();
     int64_t bucketSizeMills = 0;
     if (metric.has_bucket()) {
@@ -243,6 +243,7 @@ void GaugeMetricProducer::dumpStatesLocked(int out, bool verbose) const {
 void GaugeMetricProducer::clearPastBucketsLocked(const int64_t dumpTimeNs) {
     flushIfNeededLocked(dumpTimeNs);
     mPastBuckets.clear();
+    mGaugeFieldSchema.clear();
     mSkippedBuckets.clear();
     mTotalDataSize = 0;
 }
@@ -251,7 +252,7 @@ void GaugeMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                                              const bool include_current_partial_bucket,
                                              const bool erase_data,
                                              const DumpLatency dumpLatency,
-                                             std::set<string> *str_set,
+                                             StringDictionary* str_set,
                                              ProtoOutputStream* protoOutput) {
     VLOG("Gauge metric %lld report now...", (long long)mMetricId);
     if (include_current_partial_bucket) {
@@ -308,6 +309,8 @@ void GaugeMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
         protoOutput->end(wrapperToken);
     }
 
+    // Reused to unpack the atoms of all buckets.
+    vector<FieldValue> atomValues;
     for (const auto& pair : mPastBuckets) {
         const MetricDimensionKey& dimensionKey = pair.first;
 
@@ -342,15 +345,13 @@ void GaugeMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
             }
 
             if (!bucket.mAggregatedAtoms.empty()) {
-                for (const auto& [atomDimensionKey, elapsedTimestampsNs] :
-                     bucket.mAggregatedAtoms) {
+                for (const auto& [packedAtom, elapsedTimestampsNs] : bucket.mAggregatedAtoms) {
                     uint64_t aggregatedAtomToken = protoOutput->start(
                             FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_AGGREGATED_ATOM);
                     uint64_t atomToken =
                             protoOutput->start(FIELD_TYPE_MESSAGE | FIELD_ID_ATOM_VALUE);
-                    writeFieldValueTreeToStream(mAtomId,
-                                                atomDimensionKey.getAtomFieldValues().getValues(),
-                                                protoOutput);
+                    mGaugeFieldSchema.unpack(packedAtom, &atomValues);
+                    writeFieldValueTreeToStream(mAtomId, atomValues, protoOutput);
                     protoOutput->end(atomToken);
                     for (int64_t timestampNs : elapsedTimestampsNs) {
                         protoOutput->write(
@@ -373,6 +374,7 @@ void GaugeMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
 
     if (erase_data) {
         mPastBuckets.clear();
+        mGaugeFieldSchema.clear();
         mSkippedBuckets.clear();
         mDimensionGuardrailHit = false;
         mTotalDataSize = 0;
@@ -625,10 +627,19 @@ void GaugeMetricProducer::updateCurrentSlicedBucketForAnomaly() {
     }
 }
 
+void GaugeMetricProducer::resetCurrentSlicedBucketLocked() {
+    // The atoms were copied into mPastBuckets, only the keys and the fields of the atoms still
+    // need to be destroyed. Freeing the nodes is a no-op until the arena is released.
+    mCurrentSlicedBucket = nullptr;
+    mCurrentBucketArena.release();
+    mCurrentSlicedBucket = std::make_shared<DimToGaugeAtomsMap>(&mCurrentBucketArena);
+}
+
 void GaugeMetricProducer::dropDataLocked(const int64_t dropTimeNs) {
     flushIfNeededLocked(dropTimeNs);
     StatsdStats::getInstance().noteBucketDropped(mMetricId);
     mPastBuckets.clear();
+    mGaugeFieldSchema.clear();
     mTotalDataSize = 0;
 }
 
@@ -671,17 +682,21 @@ void GaugeMetricProducer::flushCurrentBucketLocked(const int64_t eventTimeNs,
     if (isBucketLargeEnough) {
         for (const auto& slice : *mCurrentSlicedBucket) {
             info.mAggregatedAtoms.clear();
+            size_t atomsSize = 0;
             for (const GaugeAtom& atom : slice.second) {
-                AtomDimensionKey key(mAtomId, HashableDimensionKey(*atom.mFields));
-                vector<int64_t>& elapsedTimestampsNs = info.mAggregatedAtoms[key];
-                elapsedTimestampsNs.push_back(atom.mElapsedTimestampNs);
+                const auto [it, inserted] =
+                        info.mAggregatedAtoms.try_emplace(mGaugeFieldSchema.pack(*atom.mFields));
+                if (inserted) {
+                    atomsSize += getFieldValuesSizeV2(*atom.mFields);
+                }
+                it->second.push_back(atom.mElapsedTimestampNs);
             }
             auto& bucketList = mPastBuckets[slice.first];
             const bool isFirstBucket = bucketList.empty();
-            bucketList.push_back(info);
-            mTotalDataSize += computeGaugeBucketSizeLocked(eventTimeNs >= fullBucketEndTimeNs,
-                                                           /*dimKey=*/slice.first, isFirstBucket,
-                                                           info.mAggregatedAtoms);
+            mTotalDataSize += computeGaugeBucketSizeLocked(
+                    eventTimeNs >= fullBucketEndTimeNs, /*dimKey=*/slice.first, isFirstBucket,
+                    atomsSize, /*numTimestamps=*/slice.second.size());
+            bucketList.push_back(std::move(info));
             VLOG("Gauge gauge metric %lld, dump key value: %s", (long long)mMetricId,
                  slice.first.toString().c_str());
         }
@@ -710,7 +725,7 @@ void GaugeMetricProducer::flushCurrentBucketLocked(const int64_t eventTimeNs,
     }
 
     StatsdStats::getInstance().noteBucketCount(mMetricId);
-    mCurrentSlicedBucket = std::make_shared<DimToGaugeAtomsMap>();
+    resetCurrentSlicedBucketLocked();
     mCurrentBucketStartTimeNs = nextBucketStartTimeNs;
     mCurrentSkippedBucket.reset();
     // Reset mHasHitGuardrail boolean since bucket was reset
@@ -718,34 +733,32 @@ void GaugeMetricProducer::flushCurrentBucketLocked(const int64_t eventTimeNs,
 }
 
 // Estimate for the size of a GaugeBucket.
-size_t GaugeMetricProducer::computeGaugeBucketSizeLocked(
-        const bool isFullBucket, const MetricDimensionKey& dimKey, const bool isFirstBucket,
-        const std::unordered_map<AtomDimensionKey, std::vector<int64_t>>& aggregatedAtoms) const {
+size_t GaugeMetricProducer::computeGaugeBucketSizeLocked(const bool isFullBucket,
+                                                         const MetricDimensionKey& dimKey,
+                                                         const bool isFirstBucket,
+                                                         const size_t atomsSize,
+                                                         const size_t numTimestamps) const {
     size_t bucketSize =
             MetricProducer::computeBucketSizeLocked(isFullBucket, dimKey, isFirstBucket);
 
     // Gauge Atoms and timestamps
-    for (const auto& pair : aggregatedAtoms) {
-        bucketSize += getFieldValuesSizeV2(pair.first.getAtomFieldValues().getValues());
-        bucketSize += sizeof(int64_t) * pair.second.size();
-    }
+    bucketSize += atomsSize;
+    bucketSize += sizeof(int64_t) * numTimestamps;
 
     return bucketSize;
 }
 
 size_t GaugeMetricProducer::byteSizeLocked() const {
-    sp<ConfigMetadataProvider> configMetadataProvider = getConfigMetadataProvider();
-    if (configMetadataProvider != nullptr && configMetadataProvider->useV2SoftMemoryCalculation()) {
+    if (useV2SoftMemoryCalculationLocked()) {
         return computeOverheadSizeLocked(!mPastBuckets.empty() || !mSkippedBuckets.empty(),
                                          mDimensionGuardrailHit) +
                mTotalDataSize;
     }
-    size_t totalSize = 0;
+    size_t totalSize = mGaugeFieldSchema.getByteSize();
     for (const auto& pair : mPastBuckets) {
         for (const auto& bucket : pair.second) {
-            for (const auto& [atomDimensionKey, elapsedTimestampsNs] : bucket.mAggregatedAtoms) {
-                totalSize += sizeof(FieldValue) *
-                             atomDimensionKey.getAtomFieldValues().getValues().size();
+            for (const auto& [packedAtom, elapsedTimestampsNs] : bucket.mAggregatedAtoms) {
+                totalSize += sizeof(int64_t) * packedAtom.mWords.size();
                 totalSize += sizeof(int64_t) * elapsedTimestampsNs.size();
             }
         }
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <memory_resource>
 #include <unordered_map>
 
 #include <android/util/ProtoOutputStream.h>
@@ -25,6 +26,7 @@
 #include "../external/StatsPullerManager.h"
 #include "../matchers/matcher_util.h"
 #include "../matchers/EventMatcherWizard.h"
+#include "GaugeFieldSchema.h"
 #include "MetricProducer.h"
 #include "src/statsd_config.pb.h"
 #include "../stats_util.h"
@@ -46,11 +48,12 @@ struct GaugeBucket {
     int64_t mBucketEndNs;
     std::vector<GaugeAtom> mGaugeAtoms;
 
-    // Maps the field/value pairs of an atom to a list of timestamps used to deduplicate atoms.
-    std::unordered_map<AtomDimensionKey, std::vector<int64_t>> mAggregatedAtoms;
+    // Maps the field/value pairs of an atom to a list of timestamps used to deduplicate atoms. The
+    // atoms are packed by the GaugeFieldSchema of the metric.
+    std::unordered_map<PackedGaugeAtom, std::vector<int64_t>> mAggregatedAtoms;
 };
 
-typedef std::unordered_map<MetricDimensionKey, std::vector<GaugeAtom>>
+typedef std::pmr::unordered_map<MetricDimensionKey, std::pmr::vector<GaugeAtom>>
     DimToGaugeAtomsMap;
 
 // This gauge metric producer first register the puller to automatically pull the gauge at the
@@ -119,7 +122,7 @@ private:
                             const bool include_current_partial_bucket,
                             const bool erase_data,
                             const DumpLatency dumpLatency,
-                            std::set<string> *str_set,
+                            StringDictionary* str_set,
                             android::util::ProtoOutputStream* protoOutput) override;
     void clearPastBucketsLocked(const int64_t dumpTimeNs) override;
 
@@ -149,10 +152,10 @@ private:
     // Only call if mCondition == ConditionState::kTrue && metric is active.
     void pullAndMatchEventsLocked(const int64_t timestampNs);
 
-    size_t computeGaugeBucketSizeLocked(
-            const bool isFullBucket, const MetricDimensionKey& dimKey, const bool isFirstBucket,
-            const std::unordered_map<AtomDimensionKey, std::vector<int64_t>>& aggregatedAtoms)
-            const;
+    // atomsSize is the estimated size of the distinct atoms of the bucket.
+    size_t computeGaugeBucketSizeLocked(const bool isFullBucket, const MetricDimensionKey& dimKey,
+                                        const bool isFirstBucket, const size_t atomsSize,
+                                        const size_t numTimestamps) const;
 
     optional<InvalidConfigReason> onConfigUpdatedLocked(
             const StatsdConfig& config, int configIndex, int metricIndex,
@@ -195,9 +198,21 @@ private:
     // Save the past buckets and we can clear when the StatsLogReport is dumped.
     std::unordered_map<MetricDimensionKey, std::vector<GaugeBucket>> mPastBuckets;
 
+    // Fields and strings of the atoms in mPastBuckets.
+    GaugeFieldSchema mGaugeFieldSchema;
+
+    // Arena of the nodes and atom lists of mCurrentSlicedBucket. The current bucket is only
+    // added to until it is flushed, so its memory is released all at once when the bucket is
+    // reset instead of node by node. Allocates from mMemoryResource so that it is tracked. Must be
+    // declared before mCurrentSlicedBucket.
+    std::pmr::monotonic_buffer_resource mCurrentBucketArena{&mMemoryResource};
+
     // The current partial bucket.
     std::shared_ptr<DimToGaugeAtomsMap> mCurrentSlicedBucket;
 
+    // Releases the arena of the current bucket and starts an empty one.
+    void resetCurrentSlicedBucketLocked();
+
     // The current full bucket for anomaly detection. This is updated to the latest value seen for
     // this slice (ie, for partial buckets, we use the last partial bucket in this full bucket).
     std::shared_ptr<DimToValMap> mCurrentSlicedBucketForAnomaly;
@@ -237,6 +252,8 @@ private:
     const int mPullProbability;
 
     FRIEND_TEST(GaugeMetricProducerTest, TestPulledEventsWithCondition);
+    FRIEND_TEST(GaugeMetricProducerTest, TestCurrentBucketArenaReleasedOnFlush);
+    FRIEND_TEST(GaugeMetricProducerTest, TestTrackedMemoryUsesV2Estimate);
     FRIEND_TEST(GaugeMetricProducerTest, TestPulledEventsWithSlicedCondition);
     FRIEND_TEST(GaugeMetricProducerTest, TestPulledEventsNoCondition);
     FRIEND_TEST(GaugeMetricProducerTest, TestPulledWithAppUpgradeDisabled);
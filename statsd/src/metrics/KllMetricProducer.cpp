@@ -22,6 +22,8 @@
 #include <limits.h>
 #include <stdlib.h>
 
+#include <memory>
+
 #include "guardrail/StatsdStats.h"
 #include "metrics/parsing_utils/metrics_manager_util.h"
 #include "stats_log_util.h"
@@ -31,6 +33,8 @@ using android::util::FIELD_TYPE_BYTES;
 using android::util::FIELD_TYPE_INT32;
 using android::util::FIELD_TYPE_MESSAGE;
 using android::util::ProtoOutputStream;
+using dist_proc::aggregation::CompactorPool;
+using dist_proc::aggregation::XorShiftRandomGenerator;
 using std::nullopt;
 using std::optional;
 using std::string;
@@ -63,6 +67,8 @@ KllMetricProducer::KllMetricProducer(const ConfigKey& key, const KllMetric& metr
     : ValueMetricProducer(metric.id(), key, protoHash, pullOptions, bucketOptions, whatOptions,
                           conditionOptions, stateOptions, activationOptions, guardrailOptions,
                           configMetadataProvider) {
+    mKllOptions.set_shared_random(std::make_shared<XorShiftRandomGenerator>());
+    mKllOptions.set_compactor_pool(std::make_shared<CompactorPool>());
 }
 
 KllMetricProducer::DumpProtoFields KllMetricProducer::getDumpProtoFields() const {
@@ -128,7 +134,7 @@ bool KllMetricProducer::aggregateFields(const int64_t eventTimeNs,
         // 2. Ownership of the unique_ptr<KllQuantile> at interval.aggregate being transferred to
         // PastBucket after flushing.
         if (!interval.aggregate) {
-            interval.aggregate = KllQuantile::Create();
+            interval.aggregate = KllQuantile::Create(mKllOptions);
         }
         seenNewData = true;
         interval.aggregate->Add(valueOpt.value());
@@ -159,15 +165,14 @@ size_t KllMetricProducer::getAggregatedValueSize(const std::unique_ptr<KllQuanti
     // Index
     valueSize += sizeof(int32_t);
 
-    // Value
-    valueSize += kll->SerializeToProto().ByteSizeLong();
+    // Value, estimated without serializing the sketch.
+    valueSize += kll->SerializedSizeEstimate();
 
     return valueSize;
 }
 
 size_t KllMetricProducer::byteSizeLocked() const {
-    sp<ConfigMetadataProvider> configMetadataProvider = getConfigMetadataProvider();
-    if (configMetadataProvider != nullptr && configMetadataProvider->useV2SoftMemoryCalculation()) {
+    if (useV2SoftMemoryCalculationLocked()) {
         bool dimensionGuardrailHit = StatsdStats::getInstance().hasHitDimensionGuardrail(mMetricId);
         return computeOverheadSizeLocked(!mPastBuckets.empty() || !mSkippedBuckets.empty(),
                                          dimensionGuardrailHit) +
@@ -31,6 +31,7 @@
 #include "stats_log_util.h"
 
 using dist_proc::aggregation::KllQuantile;
+using dist_proc::aggregation::KllQuantileOptions;
 
 namespace android {
 namespace os {
@@ -112,6 +113,12 @@ private:
     // Internal function to calculate the current used bytes.
     size_t byteSizeLocked() const override;
 
+    // Options of all sketches of this metric. They share one small PRNG and a pool of compactor
+    // storage instead of each owning a MTRandomGenerator and its own compactors. Both are guarded
+    // by mMutex like the sketches, and are kept alive by the sketches themselves since those are
+    // owned by the base class.
+    KllQuantileOptions mKllOptions;
+
     FRIEND_TEST(KllMetricProducerTest, TestByteSize);
     FRIEND_TEST(KllMetricProducerTest, TestPushedEventsWithoutCondition);
     FRIEND_TEST(KllMetricProducerTest, TestPushedEventsWithCondition);
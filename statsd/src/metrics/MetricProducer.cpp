@@ -129,9 +129,18 @@ void MetricProducer::onMatchedLogEventLocked(const size_t matcherIndex, const Lo
         return;
     }
 
+    // Matching a pulled event from onMatchedLogEventInternalLocked() re-enters this method, so the
+    // reused keys are moved out for the duration of the call. The nested call starts from empty
+    // keys.
+    MatchedEventKeys keys = std::move(mMatchedEventKeys);
+
     bool condition;
-    ConditionKey conditionKey;
+    ConditionKey& conditionKey = keys.conditionKey;
     if (mConditionSliced) {
+        // The links are fixed, so the keys of the map are the same for every event.
+        for (auto& [conditionId, conditionDimension] : conditionKey) {
+            conditionDimension.mutableValues()->clear();
+        }
         for (const auto& link : mMetric2ConditionLinks) {
             getDimensionForCondition(event.getValues(), link, &conditionKey[link.conditionId]);
         }
@@ -146,7 +155,10 @@ void MetricProducer::onMatchedLogEventLocked(const size_t matcherIndex, const Lo
 
     // Stores atom id to primary key pairs for each state atom that the metric is
     // sliced by.
-    std::map<int32_t, HashableDimensionKey> statePrimaryKeys;
+    std::map<int32_t, HashableDimensionKey>& statePrimaryKeys = keys.statePrimaryKeys;
+    for (auto& [atomId, primaryKey] : statePrimaryKeys) {
+        primaryKey.mutableValues()->clear();
+    }
 
     // For states with primary fields, use MetricStateLinks to get the primary
     // field values from the log event. These values will form a primary key
@@ -164,26 +176,34 @@ void MetricProducer::onMatchedLogEventLocked(const size_t matcherIndex, const Lo
     // links are provided for a state with primary fields, links are provided
     // in the wrong order, etc.), StateTracker will simply return kStateUnknown
     // when queried using an incorrect key.
-    HashableDimensionKey stateValuesKey;
-    for (auto atomId : mSlicedStateAtoms) {
-        FieldValue value;
-        if (statePrimaryKeys.find(atomId) != statePrimaryKeys.end()) {
+    MetricDimensionKey& metricKey = keys.metricKey;
+    std::vector<FieldValue>& stateValues = *metricKey.getMutableStateValuesKey()->mutableValues();
+    stateValues.resize(mSlicedStateAtoms.size());
+    for (size_t i = 0; i < mSlicedStateAtoms.size(); i++) {
+        const int32_t atomId = mSlicedStateAtoms[i];
+        FieldValue& value = stateValues[i];
+        // queryStateValue() doesn't set the field when the StateTracker is missing.
+        value = FieldValue();
+        const auto primaryKeyIt = statePrimaryKeys.find(atomId);
+        if (primaryKeyIt != statePrimaryKeys.end()) {
             // found a primary key for this state, query using the key
-            queryStateValue(atomId, statePrimaryKeys[atomId], &value);
+            queryStateValue(atomId, primaryKeyIt->second, &value);
         } else {
             // if no MetricStateLinks exist for this state atom,
             // query using the default dimension key (empty HashableDimensionKey)
             queryStateValue(atomId, DEFAULT_DIMENSION_KEY, &value);
         }
         mapStateValue(atomId, &value);
-        stateValuesKey.addValue(value);
     }
 
-    HashableDimensionKey dimensionInWhat;
-    filterValues(mDimensionsInWhat, event.getValues(), &dimensionInWhat);
-    MetricDimensionKey metricKey(dimensionInWhat, stateValuesKey);
+    HashableDimensionKey* dimensionInWhat = metricKey.getMutableDimensionKeyInWhat();
+    dimensionInWhat->mutableValues()->clear();
+    filterValues(mDimensionsInWhat, event.getValues(), &mDimensionsInWhatPositions,
+                 dimensionInWhat);
     onMatchedLogEventInternalLocked(matcherIndex, metricKey, conditionKey, condition, event,
                                     statePrimaryKeys);
+
+    mMatchedEventKeys = std::move(keys);
 }
 
 /**
@@ -426,6 +446,12 @@ sp<ConfigMetadataProvider> MetricProducer::getConfigMetadataProvider() const {
     return provider;
 }
 
+bool MetricProducer::useV2SoftMemoryCalculationLocked() const {
+    sp<ConfigMetadataProvider> provider = getConfigMetadataProvider();
+    return provider != nullptr &&
+           (provider->useV2SoftMemoryCalculation() || provider->useTrackedMemoryCalculation());
+}
+
 size_t MetricProducer::computeBucketSizeLocked(const bool isFullBucket,
                                                const MetricDimensionKey& dimKey,
                                                const bool isFirstBucket) const {
@@ -21,6 +21,7 @@
 #include <src/guardrail/stats_log_enums.pb.h>
 #include <utils/RefBase.h>
 
+#include <limits>
 #include <unordered_map>
 
 #include "HashableDimensionKey.h"
@@ -38,6 +39,8 @@
 #include "state/StateManager.h"
 #include "utils/DbUtils.h"
 #include "utils/ShardOffsetProvider.h"
+#include "utils/StringDictionary.h"
+#include "utils/TrackingMemoryResource.h"
 #include "utils/api_tracing.h"
 
 namespace android {
@@ -243,7 +246,7 @@ public:
     // This method clears all the past buckets.
     void onDumpReport(const int64_t dumpTimeNs, const bool include_current_partial_bucket,
                       const bool erase_data, const DumpLatency dumpLatency,
-                      std::set<string>* str_set, android::util::ProtoOutputStream* protoOutput) {
+                      StringDictionary* str_set, android::util::ProtoOutputStream* protoOutput) {
         std::lock_guard<std::mutex> lock(mMutex);
         onDumpReportLocked(dumpTimeNs, include_current_partial_bucket, erase_data, dumpLatency,
                            str_set, protoOutput);
@@ -282,6 +285,28 @@ public:
         return byteSizeLocked();
     }
 
+    // Returns the bytes currently allocated for this metric's data through mMemoryResource.
+    size_t getTrackedMemoryBytes() const {
+        return mMemoryResource.getBytesAllocated();
+    }
+
+    // Returns the time after which the current bucket of the metric has ended and can be closed
+    // before the next event of the metric. Returns INT64_MAX if the metric is not active or if its
+    // buckets are only closed by its own events and pulls.
+    int64_t getDeferredFlushTimeNs() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mIsActive || !supportsDeferredFlushLocked()) {
+            return std::numeric_limits<int64_t>::max();
+        }
+        return getCurrentBucketEndTimeNs();
+    }
+
+    // Closes the current bucket if it ended before eventTimeNs.
+    void flushEndedBucket(int64_t eventTimeNs) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        flushEndedBucketLocked(eventTimeNs);
+    }
+
     void dumpStates(int out, bool verbose) const {
         std::lock_guard<std::mutex> lock(mMutex);
         dumpStatesLocked(out, verbose);
@@ -390,6 +415,23 @@ protected:
      */
     virtual void flushIfNeededLocked(int64_t eventTime){};
 
+    /**
+     * Whether the current bucket can be closed by flushEndedBucket() as soon as it has ended,
+     * rather than by the next event of the metric. Closing the bucket earlier must not change its
+     * content: the events processed late, until the metric would have closed the bucket itself,
+     * must still be added to it.
+     */
+    virtual bool supportsDeferredFlushLocked() const {
+        return false;
+    }
+
+    /**
+     * Closes the current bucket for flushEndedBucket() if it ended before eventTimeNs.
+     */
+    virtual void flushEndedBucketLocked(int64_t eventTimeNs) {
+        flushIfNeededLocked(eventTimeNs);
+    }
+
     /**
      * For metrics that aggregate (ie, every metric producer except for EventMetricProducer),
      * we need to be able to flush the current buckets on demand (ie, end the current bucket and
@@ -444,7 +486,7 @@ protected:
     virtual void onDumpReportLocked(const int64_t dumpTimeNs,
                                     const bool include_current_partial_bucket,
                                     const bool erase_data, const DumpLatency dumpLatency,
-                                    std::set<string>* str_set,
+                                    StringDictionary* str_set,
                                     android::util::ProtoOutputStream* protoOutput) = 0;
     virtual void clearPastBucketsLocked(const int64_t dumpTimeNs) = 0;
     virtual void prepareFirstBucketLocked(){};
@@ -464,6 +506,16 @@ protected:
                                      const bool dimensionGuardrailHit) const;
     size_t computeSkippedBucketSizeLocked(const SkippedBucket& skippedBucket) const;
 
+    // Data size used by byteSizeLocked() when the config uses tracked memory calculation.
+    size_t computeTrackedDataSizeLocked() const {
+        return mMemoryResource.getBytesAllocated() + mUntrackedDataSize;
+    }
+
+    // Whether byteSizeLocked() of a metric that doesn't store its buckets through mMemoryResource
+    // uses the V2 estimate. The tracked memory calculation implies it, so that the sizes of the
+    // metrics of a config are not a mix of tracked bytes and V1 estimates.
+    bool useV2SoftMemoryCalculationLocked() const;
+
     bool evaluateActiveStateLocked(int64_t elapsedTimestampNs);
 
     virtual void onActiveStateChangedLocked(const int64_t eventTimeNs, const bool isActive) {
@@ -550,6 +602,9 @@ protected:
 
     vector<Matcher> mDimensionsInWhat;  // The dimensions_in_what defined in statsd_config
 
+    // Positions of the mDimensionsInWhat values in the events of the what atom.
+    FieldPositionCache mDimensionsInWhatPositions;
+
     // True iff the metric to condition links cover all dimension fields in the condition tracker.
     // This field is always false for combinational condition trackers.
     bool mHasLinksToAllConditionDimensionsInTracker;
@@ -579,6 +634,15 @@ protected:
     // atom to fields in the "what" atom.
     std::vector<Metric2State> mMetric2StateLinks;
 
+    // Keys resolved for a matched event in onMatchedLogEventLocked. They are kept between events
+    // so that their nodes and value vectors are reused instead of allocated for every event.
+    struct MatchedEventKeys {
+        ConditionKey conditionKey;
+        std::map<int32_t, HashableDimensionKey> statePrimaryKeys;
+        MetricDimensionKey metricKey;
+    };
+    MatchedEventKeys mMatchedEventKeys;
+
     optional<UploadThreshold> mUploadThreshold;
 
     const optional<bool> mSplitBucketForAppUpgrade;
@@ -621,6 +685,15 @@ protected:
 
     size_t mTotalDataSize = 0;
 
+    // Memory resource of the containers holding the past buckets of the metric, so that their
+    // size is counted instead of estimated. Declared in the base class so that it outlives the
+    // containers of the subclasses.
+    TrackingMemoryResource mMemoryResource;
+
+    // Estimated size of the data referenced by the tracked containers but allocated outside of
+    // mMemoryResource, such as the values of the dimension keys.
+    size_t mUntrackedDataSize = 0;
+
     FRIEND_TEST(CountMetricE2eTest, TestSlicedState);
     FRIEND_TEST(CountMetricE2eTest, TestSlicedStateWithMap);
     FRIEND_TEST(CountMetricE2eTest, TestMultipleSlicedStates);
@@ -85,7 +85,9 @@ MetricsManager::MetricsManager(const ConfigKey& key, const StatsdConfig& config,
                           config.whitelisted_atom_ids().end()),
       mShouldPersistHistory(config.persist_locally()),
       mUseV2SoftMemoryCalculation(config.statsd_config_options().use_v2_soft_memory_limit()),
-      mOmitSystemUidsInUidMap(config.statsd_config_options().omit_system_uids_in_uidmap()) {
+      mUseTrackedMemoryCalculation(config.statsd_config_options().use_tracked_memory_limit()),
+      mOmitSystemUidsInUidMap(config.statsd_config_options().omit_system_uids_in_uidmap()),
+      mIncrementalUidMap(config.statsd_config_options().incremental_uid_map()) {
     if (!isAtLeastU() && config.has_restricted_metrics_delegate_package_name()) {
         mInvalidConfigReason =
                 InvalidConfigReason(INVALID_CONFIG_REASON_RESTRICTED_METRIC_NOT_ENABLED);
@@ -142,6 +144,8 @@ bool MetricsManager::updateConfig(const StatsdConfig& config, const int64_t time
                 InvalidConfigReason(INVALID_CONFIG_REASON_RESTRICTED_METRIC_NOT_ENABLED);
         return false;
     }
+    // Matcher indices change, the owner shares the matchers of the new config again.
+    setSharedMatchers(nullptr);
     if (config.has_restricted_metrics_delegate_package_name()) {
         mRestrictedMetricsDelegatePackageName = config.restricted_metrics_delegate_package_name();
     } else {
@@ -181,6 +185,8 @@ bool MetricsManager::updateConfig(const StatsdConfig& config, const int64_t time
     mAllConditionTrackers = newConditionTrackers;
     mConditionTrackerMap = newConditionTrackerMap;
     mAllMetricProducers = newMetricProducers;
+    mDeferredFlushIndex = 0;
+    mNextDeferredFlushTimeNs = 0;
     mMetricProducerMap = newMetricProducerMap;
     mStateProtoHashes = newStateProtoHashes;
     mAllAnomalyTrackers = newAnomalyTrackers;
@@ -199,7 +205,9 @@ bool MetricsManager::updateConfig(const StatsdConfig& config, const int64_t time
     mShouldPersistHistory = config.persist_locally();
     mPackageCertificateHashSizeBytes = config.package_certificate_hash_size_bytes();
     mUseV2SoftMemoryCalculation = config.statsd_config_options().use_v2_soft_memory_limit();
+    mUseTrackedMemoryCalculation = config.statsd_config_options().use_tracked_memory_limit();
     mOmitSystemUidsInUidMap = config.statsd_config_options().omit_system_uids_in_uidmap();
+    mIncrementalUidMap = config.statsd_config_options().incremental_uid_map();
 
     // Store the sub-configs used.
     mAnnotations.clear();
@@ -456,6 +464,10 @@ bool MetricsManager::useV2SoftMemoryCalculation() {
     return mUseV2SoftMemoryCalculation;
 }
 
+bool MetricsManager::useTrackedMemoryCalculation() {
+    return mUseTrackedMemoryCalculation;
+}
+
 void MetricsManager::dumpStates(int out, bool verbose) {
     dprintf(out, "ConfigKey %s, allowed source:", mConfigKey.ToString().c_str());
     {
@@ -468,6 +480,14 @@ void MetricsManager::dumpStates(int out, bool verbose) {
     for (const auto& producer : mAllMetricProducers) {
         producer->dumpStates(out, verbose);
     }
+    if (mUseTrackedMemoryCalculation) {
+        size_t trackedBytes = 0;
+        for (const auto& producer : mAllMetricProducers) {
+            trackedBytes += producer->getTrackedMemoryBytes();
+        }
+        dprintf(out, "Tracked metric memory: %zu bytes, total metric size: %zu bytes\n",
+                trackedBytes, byteSize());
+    }
 }
 
 void MetricsManager::dropData(const int64_t dropTimeNs) {
@@ -478,7 +498,7 @@ void MetricsManager::dropData(const int64_t dropTimeNs) {
 
 void MetricsManager::onDumpReport(const int64_t dumpTimeStampNs, const int64_t wallClockNs,
                                   const bool include_current_partial_bucket, const bool erase_data,
-                                  const DumpLatency dumpLatency, std::set<string>* str_set,
+                                  const DumpLatency dumpLatency, StringDictionary* str_set,
                                   ProtoOutputStream* protoOutput) {
     if (hasRestrictedMetricsDelegate()) {
         // TODO(b/268150038): report error to statsdstats
@@ -588,6 +608,8 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
 
     mIsActive = isActive || !activeMetricsIndices.empty();
 
+    flushEndedBucketsIncrementally(eventTimeNs);
+
     const auto matchersIt = mTagIdsToMatchersMap.find(tagId);
 
     if (matchersIt == mTagIdsToMatchersMap.end()) {
@@ -608,6 +630,15 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
                                        MatchingState::kNotComputed);
     vector<shared_ptr<LogEvent>> matcherTransformations(matcherCache.size(), nullptr);
 
+    if (mSharedMatchers != nullptr) {
+        for (const int matcherIndex : matchersIt->second) {
+            const int slot = mSharedMatcherSlots[matcherIndex];
+            if (slot >= 0) {
+                matcherCache[matcherIndex] = mSharedMatchers->getResult(event, slot);
+            }
+        }
+    }
+
     for (const auto& matcherIndex : matchersIt->second) {
         mAllAtomMatchingTrackers[matcherIndex]->onLogEvent(event, matcherIndex,
                                                            mAllAtomMatchingTrackers, matcherCache,
@@ -725,6 +756,35 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
     }
 }
 
+void MetricsManager::flushEndedBucketsIncrementally(const int64_t eventTimeNs) {
+    if (eventTimeNs < mNextDeferredFlushTimeNs || mAllMetricProducers.empty()) {
+        return;
+    }
+    // Closing a bucket later than its end does not change its content, so the metrics can be
+    // flushed in any order, over several events.
+    const int64_t flushBeforeNs = eventTimeNs - kDeferredFlushDelayNs;
+    int64_t nextFlushTimeNs = eventTimeNs + kDeferredFlushMaxScanIntervalNs;
+    size_t numFlushed = 0;
+    for (size_t i = 0; i < mAllMetricProducers.size(); i++) {
+        const sp<MetricProducer>& producer = mAllMetricProducers[mDeferredFlushIndex];
+        int64_t flushTimeNs = producer->getDeferredFlushTimeNs();
+        if (flushTimeNs <= flushBeforeNs) {
+            if (numFlushed == kMaxDeferredFlushesPerEvent) {
+                // Continue with this metric on the next event.
+                return;
+            }
+            producer->flushEndedBucket(eventTimeNs);
+            numFlushed++;
+            flushTimeNs = producer->getDeferredFlushTimeNs();
+        }
+        if (flushTimeNs != std::numeric_limits<int64_t>::max()) {
+            nextFlushTimeNs = std::min(nextFlushTimeNs, flushTimeNs + kDeferredFlushDelayNs);
+        }
+        mDeferredFlushIndex = (mDeferredFlushIndex + 1) % mAllMetricProducers.size();
+    }
+    mNextDeferredFlushTimeNs = nextFlushTimeNs;
+}
+
 void MetricsManager::onLogEventLost(const SocketLossInfo& socketLossInfo) {
     // socketLossInfo stores atomId per UID - to eliminate duplicates using set
     const set<int> uniqueLostAtomIds(socketLossInfo.atomIds.begin(), socketLossInfo.atomIds.end());
@@ -951,6 +1011,19 @@ vector<int64_t> MetricsManager::getAllMetricIds() const {
     return metricIds;
 }
 
+void MetricsManager::setSharedMatchers(const shared_ptr<SharedMatcherTable>& sharedMatchers) {
+    mSharedMatchers = sharedMatchers;
+    mSharedMatcherSlots.assign(mAllAtomMatchingTrackers.size(), -1);
+    if (sharedMatchers == nullptr) {
+        return;
+    }
+    for (size_t i = 0; i < mAllAtomMatchingTrackers.size(); i++) {
+        if (mAllAtomMatchingTrackers[i]->isShareable()) {
+            mSharedMatcherSlots[i] = sharedMatchers->add(mAllAtomMatchingTrackers[i]);
+        }
+    }
+}
+
 void MetricsManager::addAllAtomIds(LogEventFilter::AtomIdSet& allIds) const {
     for (const auto& [atomId, _] : mTagIdsToMatchersMap) {
         allIds.insert(atomId);
@@ -28,6 +28,7 @@
 #include "guardrail/StatsdStats.h"
 #include "logd/LogEvent.h"
 #include "matchers/AtomMatchingTracker.h"
+#include "matchers/SharedMatcherTable.h"
 #include "metrics/MetricProducer.h"
 #include "packages/UidMap.h"
 #include "src/statsd_config.pb.h"
@@ -81,6 +82,8 @@ public:
 
     bool useV2SoftMemoryCalculation() override;
 
+    bool useTrackedMemoryCalculation() override;
+
     bool shouldWriteToDisk() const {
         return mNoReportMetricIds.size() != mAllMetricProducers.size();
     }
@@ -135,7 +138,7 @@ public:
 
     virtual void onDumpReport(const int64_t dumpTimeNs, int64_t wallClockNs,
                               const bool include_current_partial_bucket, const bool erase_data,
-                              const DumpLatency dumpLatency, std::set<string>* str_set,
+                              const DumpLatency dumpLatency, StringDictionary* str_set,
                               android::util::ProtoOutputStream* protoOutput);
 
     // Computes the total byte size of all metrics managed by a single config source.
@@ -184,6 +187,15 @@ public:
     // Adds all atom ids referenced by matchers in the MetricsManager's config
     void addAllAtomIds(LogEventFilter::AtomIdSet& allIds) const;
 
+    // Adds the shareable matchers of the config to sharedMatchers, and reads their results from it
+    // instead of evaluating them. nullptr evaluates all matchers in this config.
+    void setSharedMatchers(const std::shared_ptr<SharedMatcherTable>& sharedMatchers);
+
+    // Metric activations expire with time, so configs that have them need to see every event.
+    inline bool hasMetricsWithActivation() const {
+        return !mMetricIndexesWithActivation.empty();
+    }
+
     // Gets the memory limit for the MetricsManager's config
     inline size_t getMaxMetricsBytes() const {
         return mMaxMetricsBytes;
@@ -197,6 +209,10 @@ public:
         return mOmitSystemUidsInUidMap;
     }
 
+    inline bool incrementalUidMapInReport() const {
+        return mIncrementalUidMap;
+    }
+
 private:
     // For test only.
     inline int64_t getTtlEndNs() const {
@@ -255,9 +271,12 @@ private:
 
     bool mShouldPersistHistory;
     bool mUseV2SoftMemoryCalculation;
+    bool mUseTrackedMemoryCalculation;
 
     bool mOmitSystemUidsInUidMap;
 
+    bool mIncrementalUidMap;
+
     // All event tags that are interesting to config metrics matchers.
     std::unordered_map<int, std::vector<int>> mTagIdsToMatchersMap;
 
@@ -271,6 +290,12 @@ private:
     // Hold all the atom matchers from the config.
     std::vector<sp<AtomMatchingTracker>> mAllAtomMatchingTrackers;
 
+    // Results of matchers shared with other configs, nullptr if not shared.
+    std::shared_ptr<SharedMatcherTable> mSharedMatchers;
+
+    // Slot in mSharedMatchers of each matcher in mAllAtomMatchingTrackers, -1 if not shared.
+    std::vector<int> mSharedMatcherSlots;
+
     // Hold all the conditions from the config.
     std::vector<sp<ConditionTracker>> mAllConditionTrackers;
 
@@ -378,6 +403,29 @@ private:
     // Parse SocketLossInfo and propagate info to the metrics
     void onLogEventLost(const SocketLossInfo& socketLossInfo);
 
+    // Closes the ended buckets of up to kMaxDeferredFlushesPerEvent metrics, so that the flushes
+    // after a bucket boundary are spread over the following events of the config instead of all
+    // happening on the first events matched by the metrics.
+    void flushEndedBucketsIncrementally(int64_t eventTimeNs);
+
+    // Maximum number of metrics flushed by flushEndedBucketsIncrementally() per event.
+    static const size_t kMaxDeferredFlushesPerEvent = 2;
+
+    // Delay after the end of a bucket before flushEndedBucketsIncrementally() closes it, to still
+    // count events that were logged before the bucket boundary but are processed after it.
+    static const int64_t kDeferredFlushDelayNs = 5 * NS_PER_SEC;
+
+    // Maximum time between two scans of the metrics by flushEndedBucketsIncrementally(), so that
+    // metrics that became active or got an event in their current bucket since the last scan are
+    // picked up.
+    static const int64_t kDeferredFlushMaxScanIntervalNs = 60 * NS_PER_SEC;
+
+    // Index of the next metric checked by flushEndedBucketsIncrementally().
+    size_t mDeferredFlushIndex = 0;
+
+    // Time before which flushEndedBucketsIncrementally() has no bucket to close.
+    int64_t mNextDeferredFlushTimeNs = 0;
+
     /**
      * @brief Update metrics depending on #lostAtomId that it was lost due to #reason
      * @return number of notified metrics
@@ -445,6 +493,8 @@ private:
     FRIEND_TEST(MetricsManagerTest, TestLogSources);
     FRIEND_TEST(MetricsManagerTest, TestCheckLogCredentialsWhitelistedAtom);
     FRIEND_TEST(MetricsManagerTest, TestLogSourcesOnConfigUpdate);
+    FRIEND_TEST(MetricsManagerTest, TestFlushEndedBucketsIncrementally);
+    FRIEND_TEST(MetricsManagerTest, TestFlushEndedBucketsIncrementallyLateEvent);
     FRIEND_TEST(MetricsManagerTest_SPlus, TestRestrictedMetricsConfig);
     FRIEND_TEST(MetricsManagerTest_SPlus, TestRestrictedMetricsConfigUpdate);
     FRIEND_TEST(MetricsManagerUtilTest, TestSampledMetrics);
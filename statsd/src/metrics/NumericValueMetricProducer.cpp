@@ -656,8 +656,7 @@ size_t NumericValueMetricProducer::getAggregatedValueSize(const NumericValue& va
 }
 
 size_t NumericValueMetricProducer::byteSizeLocked() const {
-    sp<ConfigMetadataProvider> configMetadataProvider = getConfigMetadataProvider();
-    if (configMetadataProvider != nullptr && configMetadataProvider->useV2SoftMemoryCalculation()) {
+    if (useV2SoftMemoryCalculationLocked()) {
         bool dimensionGuardrailHit = StatsdStats::getInstance().hasHitDimensionGuardrail(mMetricId);
         return computeOverheadSizeLocked(!mPastBuckets.empty() || !mSkippedBuckets.empty(),
                                          dimensionGuardrailHit) +
@@ -323,7 +323,7 @@ void ValueMetricProducer<AggregatedValue, DimExtras>::clearPastBucketsLocked(
 template <typename AggregatedValue, typename DimExtras>
 void ValueMetricProducer<AggregatedValue, DimExtras>::onDumpReportLocked(
         const int64_t dumpTimeNs, const bool includeCurrentPartialBucket, const bool eraseData,
-        const DumpLatency dumpLatency, set<string>* strSet, ProtoOutputStream* protoOutput) {
+        const DumpLatency dumpLatency, StringDictionary* strSet, ProtoOutputStream* protoOutput) {
     VLOG("metric %lld dump report now...", (long long)mMetricId);
 
     // Pulled metrics need to pull before flushing, which is why they do not call flushIfNeeded.
@@ -697,7 +697,7 @@ void ValueMetricProducer<AggregatedValue, DimExtras>::onMatchedLogEventInternalL
         return;
     }
 
-    const auto whatKey = eventKey.getDimensionKeyInWhat();
+    const HashableDimensionKey& whatKey = eventKey.getDimensionKeyInWhat();
     mMatchedMetricDimensionKeys.insert(whatKey);
 
     if (!isPulled()) {
@@ -709,22 +709,35 @@ void ValueMetricProducer<AggregatedValue, DimExtras>::onMatchedLogEventInternalL
         return;
     }
 
-    if (hitGuardRailLocked(eventKey)) {
+    // Pointers rather than iterators, since they stay valid when other keys are inserted.
+    const auto bucketIt = mCurrentSlicedBucket.find(eventKey);
+    CurrentBucket* eventBucket =
+            bucketIt == mCurrentSlicedBucket.end() ? nullptr : &bucketIt->second;
+    if (eventBucket == nullptr && hitGuardRailLocked(eventKey)) {
         return;
     }
 
-    const auto& returnVal = mDimInfos.emplace(whatKey, DimensionsInWhatInfo(getUnknownStateKey()));
-    DimensionsInWhatInfo& dimensionsInWhatInfo = returnVal.first->second;
+    auto dimInfoIt = mDimInfos.find(whatKey);
+    if (dimInfoIt == mDimInfos.end()) {
+        dimInfoIt = mDimInfos.emplace(whatKey, DimensionsInWhatInfo(getUnknownStateKey())).first;
+    }
+    DimensionsInWhatInfo& dimensionsInWhatInfo = dimInfoIt->second;
     const HashableDimensionKey& oldStateKey = dimensionsInWhatInfo.currentState;
-    CurrentBucket& currentBucket = mCurrentSlicedBucket[MetricDimensionKey(whatKey, oldStateKey)];
 
     // Ensure we turn on the condition timer in the case where dimensions
     // were missing on a previous pull due to a state change.
-    const auto stateKey = eventKey.getStateValuesKey();
-    const bool stateChange = oldStateKey != stateKey || !dimensionsInWhatInfo.hasCurrentState;
+    const HashableDimensionKey& stateKey = eventKey.getStateValuesKey();
+    const bool sameStateKey = oldStateKey == stateKey;
+    const bool stateChange = !sameStateKey || !dimensionsInWhatInfo.hasCurrentState;
 
     // We need to get the intervals stored with the previous state key so we can
-    // close these value intervals.
+    // close these value intervals. That is the bucket of the event unless the state changed.
+    if (eventBucket == nullptr && sameStateKey) {
+        eventBucket = &mCurrentSlicedBucket[eventKey];
+    }
+    CurrentBucket& currentBucket =
+            sameStateKey ? *eventBucket
+                         : mCurrentSlicedBucket[MetricDimensionKey(whatKey, oldStateKey)];
     vector<Interval>& intervals = currentBucket.intervals;
     if (intervals.size() < mFieldMatchers.size()) {
         VLOG("Resizing number of intervals to %d", (int)mFieldMatchers.size());
@@ -732,7 +745,9 @@ void ValueMetricProducer<AggregatedValue, DimExtras>::onMatchedLogEventInternalL
     }
 
     dimensionsInWhatInfo.hasCurrentState = true;
-    dimensionsInWhatInfo.currentState = stateKey;
+    if (!sameStateKey) {
+        dimensionsInWhatInfo.currentState = stateKey;
+    }
 
     dimensionsInWhatInfo.seenNewData |= aggregateFields(eventTimeNs, eventKey, event, intervals,
                                                         dimensionsInWhatInfo.dimExtras);
@@ -743,8 +758,10 @@ void ValueMetricProducer<AggregatedValue, DimExtras>::onMatchedLogEventInternalL
         currentBucket.conditionTimer.onConditionChanged(false, eventTimeNs);
 
         // Turn ON the condition timer for the new state key.
-        mCurrentSlicedBucket[MetricDimensionKey(whatKey, stateKey)]
-                .conditionTimer.onConditionChanged(true, eventTimeNs);
+        if (eventBucket == nullptr) {
+            eventBucket = &mCurrentSlicedBucket[eventKey];
+        }
+        eventBucket->conditionTimer.onConditionChanged(true, eventTimeNs);
     }
 }
 
@@ -156,7 +156,7 @@ protected:
 
     void onDumpReportLocked(const int64_t dumpTimeNs, const bool includeCurrentPartialBucket,
                             const bool eraseData, const DumpLatency dumpLatency,
-                            std::set<string>* strSet,
+                            StringDictionary* strSet,
                             android::util::ProtoOutputStream* protoOutput) override;
 
     struct DumpProtoFields {
@@ -21,6 +21,8 @@
 #include <inttypes.h>
 #include <private/android_filesystem_config.h>
 
+#include <algorithm>
+
 #include "guardrail/StatsdStats.h"
 #include "hash.h"
 #include "stats_log_util.h"
@@ -204,8 +206,9 @@ void UidMap::updateApp(const int64_t timestamp, const string& appName, const int
             mMap[key] = AppData(versionCode, versionString, installer, certificateHashString);
         }
 
-        mChanges.emplace_back(false, timestamp, appName, uid, versionCode, versionString,
-                              prevVersion, prevVersionString);
+        mChanges.emplace_back(false, timestamp, mChangeStrings.intern(appName), uid, versionCode,
+                              mChangeStrings.intern(versionString), prevVersion,
+                              mChangeStrings.intern(prevVersionString));
         mBytesUsed += kBytesChangeRecord;
         ensureBytesUsedBelowLimit();
         StatsdStats::getInstance().setCurrentUidMapMemory(mBytesUsed);
@@ -229,10 +232,30 @@ void UidMap::ensureBytesUsedBelowLimit() {
         ALOGI("Bytes used %zu is above limit %zu, need to delete something", mBytesUsed, limit);
         if (mChanges.size() > 0) {
             mBytesUsed -= kBytesChangeRecord;
+            mLastDroppedChangeNs = std::max(mLastDroppedChangeNs, mChanges.front().timestampNs);
             mChanges.pop_front();
             StatsdStats::getInstance().noteUidMapDropped(1);
         }
     }
+    compactChangeStringsLocked();
+}
+
+void UidMap::compactChangeStringsLocked() {
+    if (mChanges.empty()) {
+        mChangeStrings.clear();
+        return;
+    }
+    // A record uses at most 3 distinct strings.
+    if (mChangeStrings.size() <= 2 * 3 * mChanges.size()) {
+        return;
+    }
+    StringDictionary changeStrings;
+    for (ChangeRecord& record : mChanges) {
+        record.package = changeStrings.intern(record.package);
+        record.versionString = changeStrings.intern(record.versionString);
+        record.prevVersionString = changeStrings.intern(record.prevVersionString);
+    }
+    mChangeStrings = std::move(changeStrings);
 }
 
 void UidMap::removeApp(const int64_t timestamp, const string& app, const int32_t uid) {
@@ -257,7 +280,9 @@ void UidMap::removeApp(const int64_t timestamp, const string& app, const int32_t
             mMap.erase(oldest);
             StatsdStats::getInstance().noteUidMapAppDeletionDropped();
         }
-        mChanges.emplace_back(true, timestamp, app, uid, 0, "", prevVersion, prevVersionString);
+        mChanges.emplace_back(true, timestamp, mChangeStrings.intern(app), uid, 0,
+                              mChangeStrings.intern(""), prevVersion,
+                              mChangeStrings.intern(prevVersionString));
         mBytesUsed += kBytesChangeRecord;
         ensureBytesUsedBelowLimit();
         StatsdStats::getInstance().setCurrentUidMapMemory(mBytesUsed);
@@ -303,6 +328,9 @@ int UidMap::getHostUidOrSelf(int uid) const {
 
 void UidMap::clearOutput() {
     mChanges.clear();
+    mChangeStrings.clear();
+    // The configs with incremental uid maps need a new snapshot.
+    mIncrementalReportsPerConfigKey.clear();
     // Also update the guardrail trackers.
     StatsdStats::getInstance().setUidMapChanges(0);
     mBytesUsed = 0;
@@ -328,7 +356,7 @@ size_t UidMap::getBytesUsed() const {
 void UidMap::writeUidMapSnapshot(int64_t timestamp, bool includeVersionStrings,
                                  bool includeInstaller, const uint8_t truncatedCertificateHashSize,
                                  bool omitSystemUids, const std::set<int32_t>& interestingUids,
-                                 map<string, int>* installerIndices, std::set<string>* str_set,
+                                 map<string, int>* installerIndices, StringDictionary* str_set,
                                  ProtoOutputStream* proto) const {
     lock_guard<mutex> lock(mMutex);
 
@@ -343,7 +371,7 @@ void UidMap::writeUidMapSnapshotLocked(const int64_t timestamp, const bool inclu
                                        const bool omitSystemUids,
                                        const std::set<int32_t>& interestingUids,
                                        map<string, int>* installerIndices,
-                                       std::set<string>* str_set, ProtoOutputStream* proto) const {
+                                       StringDictionary* str_set, ProtoOutputStream* proto) const {
     int curInstallerIndex = 0;
 
     proto->write(FIELD_TYPE_INT64 | FIELD_ID_SNAPSHOT_TIMESTAMP, (long long)timestamp);
@@ -425,9 +453,23 @@ void UidMap::writeUidMapSnapshotLocked(const int64_t timestamp, const bool inclu
 void UidMap::appendUidMap(const int64_t timestamp, const ConfigKey& key,
                           const bool includeVersionStrings, const bool includeInstaller,
                           const uint8_t truncatedCertificateHashSize, const bool omitSystemUids,
-                          std::set<string>* str_set, ProtoOutputStream* proto) {
+                          const bool incremental, const bool eraseData,
+                          StringDictionary* str_set, ProtoOutputStream* proto) {
     lock_guard<mutex> lock(mMutex);  // Lock for updates
 
+    bool writeSnapshot = true;
+    if (incremental && eraseData) {
+        const auto it = mIncrementalReportsPerConfigKey.find(key);
+        writeSnapshot = it == mIncrementalReportsPerConfigKey.end() ||
+                        it->second >= kMaxIncrementalReports ||
+                        mLastDroppedChangeNs >= mLastUpdatePerConfigKey[key];
+        if (writeSnapshot) {
+            mIncrementalReportsPerConfigKey[key] = 0;
+        } else {
+            it->second++;
+        }
+    }
+
     for (const ChangeRecord& record : mChanges) {
         if (omitUid(record.uid, omitSystemUids) ||
             record.timestampNs <= mLastUpdatePerConfigKey[key]) {
@@ -441,22 +483,25 @@ void UidMap::appendUidMap(const int64_t timestamp, const ConfigKey& key,
         if (str_set != nullptr) {
             str_set->insert(record.package);
             proto->write(FIELD_TYPE_UINT64 | FIELD_ID_CHANGE_PACKAGE_HASH,
-                         (long long)Hash64(record.package));
+                         (long long)Hash64(record.package.data(), record.package.size()));
             if (includeVersionStrings) {
                 str_set->insert(record.versionString);
                 proto->write(FIELD_TYPE_UINT64 | FIELD_ID_CHANGE_NEW_VERSION_STRING_HASH,
-                             (long long)Hash64(record.versionString));
+                             (long long)Hash64(record.versionString.data(),
+                                               record.versionString.size()));
                 str_set->insert(record.prevVersionString);
                 proto->write(FIELD_TYPE_UINT64 | FIELD_ID_CHANGE_PREV_VERSION_STRING_HASH,
-                             (long long)Hash64(record.prevVersionString));
+                             (long long)Hash64(record.prevVersionString.data(),
+                                               record.prevVersionString.size()));
             }
         } else {
-            proto->write(FIELD_TYPE_STRING | FIELD_ID_CHANGE_PACKAGE, record.package);
+            proto->write(FIELD_TYPE_STRING | FIELD_ID_CHANGE_PACKAGE, record.package.data(),
+                         record.package.size());
             if (includeVersionStrings) {
                 proto->write(FIELD_TYPE_STRING | FIELD_ID_CHANGE_NEW_VERSION_STRING,
-                             record.versionString);
+                             record.versionString.data(), record.versionString.size());
                 proto->write(FIELD_TYPE_STRING | FIELD_ID_CHANGE_PREV_VERSION_STRING,
-                             record.prevVersionString);
+                             record.prevVersionString.data(), record.prevVersionString.size());
             }
         }
 
@@ -470,13 +515,15 @@ void UidMap::appendUidMap(const int64_t timestamp, const ConfigKey& key,
     map<string, int> installerIndices;
 
     // Write snapshot from current uid map state.
-    uint64_t snapshotsToken =
-            proto->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_SNAPSHOTS);
-    writeUidMapSnapshotLocked(timestamp, includeVersionStrings, includeInstaller,
-                              truncatedCertificateHashSize, omitSystemUids,
-                              std::set<int32_t>() /*empty uid set means including every uid*/,
-                              &installerIndices, str_set, proto);
-    proto->end(snapshotsToken);
+    if (writeSnapshot) {
+        uint64_t snapshotsToken =
+                proto->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_SNAPSHOTS);
+        writeUidMapSnapshotLocked(timestamp, includeVersionStrings, includeInstaller,
+                                  truncatedCertificateHashSize, omitSystemUids,
+                                  std::set<int32_t>() /*empty uid set means including every uid*/,
+                                  &installerIndices, str_set, proto);
+        proto->end(snapshotsToken);
+    }
 
     vector<string> installers(installerIndices.size(), "");
     for (const auto& [installer, index] : installerIndices) {
@@ -497,20 +544,23 @@ void UidMap::appendUidMap(const int64_t timestamp, const ConfigKey& key,
         }
     }
 
-    int64_t prevMin = getMinimumTimestampNs();
-    mLastUpdatePerConfigKey[key] = timestamp;
-    int64_t newMin = getMinimumTimestampNs();
-
-    if (newMin > prevMin) {  // Delete anything possible now that the minimum has
-                             // moved forward.
-        int64_t cutoff_nanos = newMin;
-        for (auto it_changes = mChanges.begin(); it_changes != mChanges.end();) {
-            if (it_changes->timestampNs < cutoff_nanos) {
-                mBytesUsed -= kBytesChangeRecord;
-                it_changes = mChanges.erase(it_changes);
-            } else {
-                ++it_changes;
-            }
+    // An incremental report that keeps the data leaves the changes to the next report that erases
+    // it, since the next reports may not have a snapshot.
+    if (!incremental || eraseData) {
+        int64_t prevMin = getMinimumTimestampNs();
+        mLastUpdatePerConfigKey[key] = timestamp;
+        int64_t newMin = getMinimumTimestampNs();
+
+        if (newMin > prevMin) {  // Delete anything possible now that the minimum has
+                                 // moved forward.
+            int64_t cutoff_nanos = newMin;
+            const auto removed = std::remove_if(mChanges.begin(), mChanges.end(),
+                                                [cutoff_nanos](const ChangeRecord& record) {
+                                                    return record.timestampNs < cutoff_nanos;
+                                                });
+            mBytesUsed -= kBytesChangeRecord * (mChanges.end() - removed);
+            mChanges.erase(removed, mChanges.end());
+            compactChangeStringsLocked();
         }
     }
     StatsdStats::getInstance().setCurrentUidMapMemory(mBytesUsed);
@@ -539,10 +589,12 @@ void UidMap::printUidMap(int out, bool includeCertificateHash) const {
 
 void UidMap::OnConfigUpdated(const ConfigKey& key) {
     mLastUpdatePerConfigKey[key] = -1;
+    mIncrementalReportsPerConfigKey.erase(key);
 }
 
 void UidMap::OnConfigRemoved(const ConfigKey& key) {
     mLastUpdatePerConfigKey.erase(key);
+    mIncrementalReportsPerConfigKey.erase(key);
 }
 
 set<int32_t> UidMap::getAppUid(const string& package) const {
@@ -22,15 +22,18 @@
 #include <utils/RefBase.h>
 #include <utils/String16.h>
 
+#include <deque>
 #include <list>
 #include <mutex>
 #include <set>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "config/ConfigKey.h"
 #include "packages/PackageInfoListener.h"
 #include "stats_util.h"
+#include "utils/StringDictionary.h"
 
 using namespace android;
 using namespace std;
@@ -63,19 +66,21 @@ struct AppData {
 
 // When calling appendUidMap, we retrieve all the ChangeRecords since the last
 // timestamp we called appendUidMap for this configuration key.
+// The strings are interned in UidMap::mChangeStrings, so that the records of the same package
+// share them.
 struct ChangeRecord {
-    const bool deletion;
-    const int64_t timestampNs;
-    const string package;
-    const int32_t uid;
-    const int64_t version;
-    const int64_t prevVersion;
-    const string versionString;
-    const string prevVersionString;
-
-    ChangeRecord(const bool isDeletion, int64_t timestampNs, const string& package,
-                 const int32_t uid, int64_t version, const string& versionString,
-                 const int64_t prevVersion, const string& prevVersionString)
+    bool deletion;
+    int64_t timestampNs;
+    std::string_view package;
+    int32_t uid;
+    int64_t version;
+    int64_t prevVersion;
+    std::string_view versionString;
+    std::string_view prevVersionString;
+
+    ChangeRecord(const bool isDeletion, int64_t timestampNs, std::string_view package,
+                 const int32_t uid, int64_t version, std::string_view versionString,
+                 const int64_t prevVersion, std::string_view prevVersionString)
         : deletion(isDeletion),
           timestampNs(timestampNs),
           package(package),
@@ -138,10 +143,19 @@ public:
     // Gets all snapshots and changes that have occurred since the last output.
     // If every config key has received a change or snapshot record, then this
     // record is deleted.
+    // incremental: if true, the snapshot is only written when the config has not received one in
+    //              its last kMaxIncrementalReports reports, or may have missed changes since its
+    //              last report. Otherwise only the changes are written.
+    // eraseData: if false for an incremental report, the report keeps the data, so the snapshot is
+    //            always written and the changes are not marked as sent to the config.
     void appendUidMap(int64_t timestamp, const ConfigKey& key, const bool includeVersionStrings,
                       const bool includeInstaller, const uint8_t truncatedCertificateHashSize,
-                      const bool omitSystemUids, std::set<string>* str_set,
-                      ProtoOutputStream* proto);
+                      const bool omitSystemUids, const bool incremental, const bool eraseData,
+                      StringDictionary* str_set, ProtoOutputStream* proto);
+
+    // Maximum number of consecutive reports without a snapshot for configs with incremental uid
+    // maps.
+    static const int kMaxIncrementalReports = 10;
 
     // Forces the output to be cleared. We still generate a snapshot based on the current state.
     // This results in extra data uploaded but helps us reconstruct the uid mapping on the server
@@ -161,7 +175,7 @@ public:
     void writeUidMapSnapshot(int64_t timestamp, bool includeVersionStrings, bool includeInstaller,
                              const uint8_t truncatedCertificateHashSize, bool omitSystemUids,
                              const std::set<int32_t>& interestingUids,
-                             std::map<string, int>* installerIndices, std::set<string>* str_set,
+                             std::map<string, int>* installerIndices, StringDictionary* str_set,
                              ProtoOutputStream* proto) const;
 
 private:
@@ -174,7 +188,7 @@ private:
                                    const bool omitSystemUids,
                                    const std::set<int32_t>& interestingUids,
                                    std::map<string, int>* installerIndices,
-                                   std::set<string>* str_set, ProtoOutputStream* proto) const;
+                                   StringDictionary* str_set, ProtoOutputStream* proto) const;
 
     mutable mutex mMutex;
     mutable mutex mIsolatedMutex;
@@ -193,7 +207,21 @@ private:
     std::unordered_map<int, int> mIsolatedUidMap;
 
     // Record the changes that can be provided with the uploads.
-    std::list<ChangeRecord> mChanges;
+    std::deque<ChangeRecord> mChanges;
+
+    // Strings of mChanges.
+    StringDictionary mChangeStrings;
+
+    // Rebuilds mChangeStrings once most of its strings are no longer used by mChanges.
+    void compactChangeStringsLocked();
+
+    // Number of reports since the last snapshot for the configs with incremental uid maps. The next
+    // report of a config without an entry includes a snapshot.
+    std::unordered_map<ConfigKey, int> mIncrementalReportsPerConfigKey;
+
+    // Timestamp of the latest change dropped by the memory guardrail. Configs whose last report is
+    // older than it have missed a change, so their next report includes a snapshot.
+    int64_t mLastDroppedChangeNs = -1;
 
     // Store which uid and apps represent deleted ones.
     std::list<std::pair<int, string>> mDeletedApps;
@@ -231,6 +259,9 @@ private:
     FRIEND_TEST(UidMapTest, TestOutputIncludesAtLeastOneSnapshot);
     FRIEND_TEST(UidMapTest, TestMemoryComputed);
     FRIEND_TEST(UidMapTest, TestMemoryGuardrail);
+    FRIEND_TEST(UidMapTest, TestIncrementalUidMap);
+    FRIEND_TEST(UidMapTest, TestIncrementalUidMapKeepData);
+    FRIEND_TEST(UidMapTest, TestChangeStringsCompacted);
 };
 
 }  // namespace statsd
@@ -22,6 +22,7 @@
 #include <cutils/sockets.h>
 #include <limits.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/cdefs.h>
 #include <sys/prctl.h>
 #include <sys/socket.h>
@@ -68,10 +69,7 @@ bool StatsSocketListener::onDataAvailable(SocketClient* cli) {
     };
 
     const int socket = cli->getSocket();
-    int i = 0;
-    int64_t minAtomReadTime = INT64_MAX;
-    int64_t maxAtomReadTime = -1;
-    mAtomCounts.clear();
+    mReadStats.reset();
     ssize_t n = 0;
     while (n = recvmsg(socket, &hdr, MSG_DONTWAIT), n > 0) {
         // To clear the entire buffer is secure/safe, but this contributes to 1.68%
@@ -83,7 +81,6 @@ bool StatsSocketListener::onDataAvailable(SocketClient* cli) {
             return false;
         }
         buffer[n] = 0;
-        i++;
 
         struct ucred* cred = NULL;
 
@@ -106,30 +103,44 @@ bool StatsSocketListener::onDataAvailable(SocketClient* cli) {
         const uint32_t uid = cred->uid;
         const uint32_t pid = cred->pid;
 
-        auto [atomId, atomTimeNs] =
-                processSocketMessage(buffer, n, uid, pid, *mQueue, *mLogEventFilter);
-        mAtomCounts[atomId]++;
-        minAtomReadTime = min(minAtomReadTime, atomTimeNs);
-        maxAtomReadTime = max(maxAtomReadTime, atomTimeNs);
+        processSocketMessage(buffer, n, uid, pid, *mQueue, *mLogEventFilter, mReadStats);
     }
 
-    StatsdStats::getInstance().noteBatchSocketRead(i, mLastSocketReadTimeNs, elapsedTimeNs,
-                                                   minAtomReadTime, maxAtomReadTime, mAtomCounts);
+    StatsdStats::getInstance().noteBatchSocketRead(
+            mReadStats.atomCount, mLastSocketReadTimeNs, elapsedTimeNs,
+            mReadStats.minAtomReadTimeNs, mReadStats.maxAtomReadTimeNs, mReadStats.atomCounts);
     mLastSocketReadTimeNs = elapsedTimeNs;
-    mAtomCounts.clear();
+    mReadStats.reset();
     return true;
 }
 
-tuple<int32_t, int64_t> StatsSocketListener::processSocketMessage(const char* buffer,
-                                                                  const uint32_t len, uint32_t uid,
-                                                                  uint32_t pid,
-                                                                  LogEventQueue& queue,
-                                                                  const LogEventFilter& filter) {
+void StatsSocketListener::AtomReadStats::noteAtom(int32_t atomId, int64_t atomTimeNs) {
+    atomCount++;
+    atomCounts[atomId]++;
+    minAtomReadTimeNs = min(minAtomReadTimeNs, atomTimeNs);
+    maxAtomReadTimeNs = max(maxAtomReadTimeNs, atomTimeNs);
+}
+
+void StatsSocketListener::AtomReadStats::reset() {
+    atomCount = 0;
+    minAtomReadTimeNs = INT64_MAX;
+    maxAtomReadTimeNs = -1;
+    atomCounts.clear();
+}
+
+void StatsSocketListener::processSocketMessage(const char* buffer, const uint32_t len,
+                                               uint32_t uid, uint32_t pid, LogEventQueue& queue,
+                                               const LogEventFilter& filter,
+                                               AtomReadStats& readStats) {
     ATRACE_CALL();
     static const uint32_t kStatsEventTag = 1937006964;
+    // Multiple StatsEvents packed into one datagram by libstatssocket batched writes.
+    // (*FORMAT MUST BE IN SYNC WITH libstatssocket/stats_buffer_writer.c*)
+    static const uint32_t kStatsEventBatchTag = 1937006946;
 
     if (len <= (ssize_t)(sizeof(android_log_header_t)) + sizeof(uint32_t)) {
-        return {-1, 0};
+        readStats.noteAtom(-1, 0);
+        return;
     }
 
     const uint8_t* ptr = ((uint8_t*)buffer) + sizeof(android_log_header_t);
@@ -157,21 +168,55 @@ tuple<int32_t, int64_t> StatsSocketListener::processSocketMessage(const char* bu
                   long_event->header.tag, last_atom_tag, uid);
             StatsdStats::getInstance().noteLogLost((int32_t)getWallClockSec(), dropped_count,
                                                    long_event->header.tag, last_atom_tag, uid, pid);
-            return {-1, 0};
+            readStats.noteAtom(-1, 0);
+            return;
         }
     }
 
     // test that received valid StatsEvent buffer
     const uint32_t statsEventTag = *reinterpret_cast<const uint32_t*>(ptr);
-    if (statsEventTag != kStatsEventTag) {
-        return {-1, 0};
+    if (statsEventTag != kStatsEventTag && statsEventTag != kStatsEventBatchTag) {
+        readStats.noteAtom(-1, 0);
+        return;
     }
 
     // move past the 4-byte StatsEventTag
     const uint8_t* msg = ptr + sizeof(uint32_t);
     bufferLen -= sizeof(uint32_t);
 
-    return processStatsEventBuffer(msg, bufferLen, uid, pid, queue, filter);
+    if (statsEventTag == kStatsEventBatchTag) {
+        processStatsEventBatch(msg, bufferLen, uid, pid, queue, filter, readStats);
+        return;
+    }
+
+    auto [atomId, atomTimeNs] = processStatsEventBuffer(msg, bufferLen, uid, pid, queue, filter);
+    readStats.noteAtom(atomId, atomTimeNs);
+}
+
+void StatsSocketListener::processStatsEventBatch(const uint8_t* msg, const uint32_t len,
+                                                 uint32_t uid, uint32_t pid, LogEventQueue& queue,
+                                                 const LogEventFilter& filter,
+                                                 AtomReadStats& readStats) {
+    ATRACE_CALL();
+    uint32_t offset = 0;
+    while (offset < len) {
+        uint32_t atomSize = 0;
+        if (len - offset < sizeof(atomSize)) {
+            readStats.noteAtom(-1, 0);
+            return;
+        }
+        // records are not aligned within the batch
+        memcpy(&atomSize, msg + offset, sizeof(atomSize));
+        offset += sizeof(atomSize);
+        if (atomSize == 0 || atomSize > len - offset) {
+            readStats.noteAtom(-1, 0);
+            return;
+        }
+        auto [atomId, atomTimeNs] =
+                processStatsEventBuffer(msg + offset, atomSize, uid, pid, queue, filter);
+        readStats.noteAtom(atomId, atomTimeNs);
+        offset += atomSize;
+    }
 }
 
 tuple<int32_t, int64_t> StatsSocketListener::processStatsEventBuffer(const uint8_t* msg,
@@ -49,6 +49,21 @@ protected:
 private:
     static int getLogSocket();
 
+    /**
+     * Per socket read accounting of the processed atoms, reported to StatsdStats once the socket
+     * is drained.
+     */
+    struct AtomReadStats {
+        int32_t atomCount = 0;
+        int64_t minAtomReadTimeNs = INT64_MAX;
+        int64_t maxAtomReadTimeNs = -1;
+        std::unordered_map<int32_t, int32_t> atomCounts;
+
+        void noteAtom(int32_t atomId, int64_t atomTimeNs);
+
+        void reset();
+    };
+
     /**
      * @brief Helper API to parse raw socket data buffer, make the LogEvent & submit it into the
      * queue. Performs preliminary data validation.
@@ -60,12 +75,28 @@ private:
      * @param pid arguments for LogEvent constructor
      * @param queue queue to submit the event
      * @param filter to be used for event evaluation
-     * @return tuple of <atom id, elapsed time>
+     * @param readStats to account the processed atoms, a batched message yields multiple atoms
+     */
+    static void processSocketMessage(const char* buffer, uint32_t len, uint32_t uid, uint32_t pid,
+                                     LogEventQueue& queue, const LogEventFilter& filter,
+                                     AtomReadStats& readStats);
+
+    /**
+     * @brief Helper API to split a batched message into StatsEvent buffers. The batch is a
+     * sequence of |uint32_t size|StatsEvent buffer| records, each one is submitted via
+     * processStatsEventBuffer(). Parsing stops on the first malformed record.
+     *
+     * @param msg batch buffer to parse, excluding the batch tag
+     * @param len size of buffer in bytes
+     * @param uid arguments for LogEvent constructor
+     * @param pid arguments for LogEvent constructor
+     * @param queue queue to submit the events
+     * @param filter to be used for event evaluation
+     * @param readStats to account the processed atoms
      */
-    static std::tuple<int32_t, int64_t> processSocketMessage(const char* buffer, uint32_t len,
-                                                             uint32_t uid, uint32_t pid,
-                                                             LogEventQueue& queue,
-                                                             const LogEventFilter& filter);
+    static void processStatsEventBatch(const uint8_t* msg, uint32_t len, uint32_t uid, uint32_t pid,
+                                       LogEventQueue& queue, const LogEventFilter& filter,
+                                       AtomReadStats& readStats);
 
     /**
      * @brief Helper API to parse buffer, make the LogEvent & submit it into the queue
@@ -94,7 +125,7 @@ private:
     int64_t mLastSocketReadTimeNs;
 
     // Tracks the atom counts per read. Member variable to avoid churn.
-    std::unordered_map<int32_t, int32_t> mAtomCounts;
+    AtomReadStats mReadStats;
 
     friend void fuzzSocket(const uint8_t* data, size_t size);
 
@@ -107,6 +138,8 @@ private:
     FRIEND_TEST(SocketParseMessageTest, TestProcessMessageFilterCompleteSet);
     FRIEND_TEST(SocketParseMessageTest, TestProcessMessageFilterPartialSet);
     FRIEND_TEST(SocketParseMessageTest, TestProcessMessageFilterToggle);
+    FRIEND_TEST(SocketParseMessageTest, TestProcessBatchedMessage);
+    FRIEND_TEST(SocketParseMessageTest, TestProcessBatchedMessageMalformed);
     FRIEND_TEST(LogEventQueue_test, TestQueueMaxSize);
 };
 
@@ -18,8 +18,13 @@
 #include "stats_log_util.h"
 
 #include <aidl/android/os/IStatsCompanionService.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
 #include <private/android_filesystem_config.h>
 #include <set>
+#include <string.h>
+#include <sys/uio.h>
 #include <utils/SystemClock.h>
 
 #include "statscompanion_util.h"
@@ -104,7 +109,7 @@ const int FIELD_ID_BUCKET_COUNT = 12;
 namespace {
 
 void writeDimensionToProtoHelper(const std::vector<FieldValue>& dims, size_t* index, int depth,
-                                 int prefix, std::set<string>* str_set,
+                                 int prefix, StringDictionary* str_set,
                                  ProtoOutputStream* protoOutput) {
     size_t count = dims.size();
     while (*index < count) {
@@ -173,7 +178,7 @@ void writeDimensionToProtoHelper(const std::vector<FieldValue>& dims, size_t* in
 
 void writeDimensionLeafToProtoHelper(const std::vector<FieldValue>& dims,
                                      const int dimensionLeafField, size_t* index, int depth,
-                                     int prefix, std::set<string>* str_set,
+                                     int prefix, StringDictionary* str_set,
                                      ProtoOutputStream* protoOutput) {
     size_t count = dims.size();
     while (*index < count) {
@@ -272,7 +277,7 @@ void writeDimensionPathToProtoHelper(const std::vector<Matcher>& fieldMatchers,
 
 }  // namespace
 
-void writeDimensionToProto(const HashableDimensionKey& dimension, std::set<string> *str_set,
+void writeDimensionToProto(const HashableDimensionKey& dimension, StringDictionary* str_set,
                            ProtoOutputStream* protoOutput) {
     if (dimension.getValues().size() == 0) {
         return;
@@ -287,7 +292,7 @@ void writeDimensionToProto(const HashableDimensionKey& dimension, std::set<strin
 
 void writeDimensionLeafNodesToProto(const HashableDimensionKey& dimension,
                                     const int dimensionLeafFieldId,
-                                    std::set<string> *str_set,
+                                    StringDictionary* str_set,
                                     ProtoOutputStream* protoOutput) {
     if (dimension.getValues().size() == 0) {
         return;
@@ -646,6 +651,39 @@ void mapIsolatedUidsToHostUidInLogEvent(const sp<UidMap>& uidMap, LogEvent& even
     }
 }
 
+bool writeSizePrefixedProtoToFd(ProtoOutputStream& proto, int fd) {
+    const uint32_t sizeBE = htonl(static_cast<uint32_t>(proto.size()));
+    vector<iovec> iovs;
+    iovs.push_back({const_cast<uint32_t*>(&sizeBE), sizeof(sizeBE)});
+    sp<android::util::ProtoReader> reader = proto.data();
+    while (reader->readBuffer() != NULL) {
+        const size_t toRead = reader->currentToRead();
+        iovs.push_back({const_cast<uint8_t*>(reader->readBuffer()), toRead});
+        reader->move(toRead);
+    }
+
+    size_t first = 0;
+    while (first < iovs.size()) {
+        const int count = std::min(iovs.size() - first, static_cast<size_t>(IOV_MAX));
+        const ssize_t written = TEMP_FAILURE_RETRY(writev(fd, &iovs[first], count));
+        if (written < 0) {
+            ALOGE("Failed to write proto to fd %d: %s", fd, strerror(errno));
+            return false;
+        }
+        // Skip the buffers written completely and the written part of the next one.
+        size_t remaining = written;
+        while (first < iovs.size() && remaining >= iovs[first].iov_len) {
+            remaining -= iovs[first].iov_len;
+            first++;
+        }
+        if (remaining > 0) {
+            iovs[first].iov_base = static_cast<uint8_t*>(iovs[first].iov_base) + remaining;
+            iovs[first].iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
 std::string toHexString(const string& bytes) {
     static const char* kLookup = "0123456789ABCDEF";
     string hex;
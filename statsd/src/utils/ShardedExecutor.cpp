@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define STATSD_DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "ShardedExecutor.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <string>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::function;
+
+ShardedExecutor::ShardedExecutor(int numShards)
+    : mNumShards(std::clamp(numShards, 1, kMaxShards)) {
+    mWorkers.resize(mNumShards);
+    for (int shard = 1; shard < mNumShards; shard++) {
+        mWorkers[shard] = std::make_unique<Worker>();
+    }
+    // Start the threads once all workers exist.
+    for (int shard = 1; shard < mNumShards; shard++) {
+        Worker& worker = *mWorkers[shard];
+        worker.thread = std::thread([this, shard] { workerLoop(shard); });
+        const std::string name = "statsd.worker" + std::to_string(shard);
+        pthread_setname_np(worker.thread.native_handle(), name.c_str());
+    }
+    VLOG("ShardedExecutor started with %d shards", mNumShards);
+}
+
+ShardedExecutor::~ShardedExecutor() {
+    for (int shard = 1; shard < mNumShards; shard++) {
+        Worker& worker = *mWorkers[shard];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.stopping = true;
+        }
+        worker.cv.notify_one();
+    }
+    for (int shard = 1; shard < mNumShards; shard++) {
+        mWorkers[shard]->thread.join();
+    }
+}
+
+void ShardedExecutor::run(uint64_t shardMask, const function<void(int)>& task) {
+    if (mNumShards < kMaxShards) {
+        shardMask &= (uint64_t(1) << mNumShards) - 1;
+    }
+    if (shardMask == 0) {
+        return;
+    }
+    if ((shardMask & (shardMask - 1)) == 0) {
+        task(__builtin_ctzll(shardMask));
+        return;
+    }
+
+    const uint64_t workerShardMask = shardMask & ~uint64_t(1);
+    {
+        std::lock_guard<std::mutex> lock(mDoneMutex);
+        mPendingShards = __builtin_popcountll(workerShardMask);
+    }
+    for (int shard = 1; shard < mNumShards; shard++) {
+        if ((workerShardMask & (uint64_t(1) << shard)) == 0) {
+            continue;
+        }
+        Worker& worker = *mWorkers[shard];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.task = &task;
+        }
+        worker.cv.notify_one();
+    }
+
+    if (shardMask & 1) {
+        task(0);
+    }
+
+    std::unique_lock<std::mutex> lock(mDoneMutex);
+    mDoneCv.wait(lock, [this] { return mPendingShards == 0; });
+}
+
+void ShardedExecutor::workerLoop(int shard) {
+    Worker& worker = *mWorkers[shard];
+    while (true) {
+        const function<void(int)>* task;
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.cv.wait(lock, [&worker] { return worker.task != nullptr || worker.stopping; });
+            if (worker.stopping) {
+                return;
+            }
+            task = worker.task;
+            worker.task = nullptr;
+        }
+        (*task)(shard);
+        onShardDone();
+    }
+}
+
+void ShardedExecutor::onShardDone() {
+    std::lock_guard<std::mutex> lock(mDoneMutex);
+    if (--mPendingShards == 0) {
+        mDoneCv.notify_one();
+    }
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Runs a task on a set of shards in parallel and waits for all of them to complete.
+ *
+ * Shard 0 runs on the calling thread. Every other shard is owned by a worker thread with its own
+ * lock and input slot, so state that belongs to a shard is only touched by one thread at a time.
+ */
+class ShardedExecutor {
+public:
+    static const int kMaxShards = 64;
+
+    // numShards is clamped to [1, kMaxShards]. numShards - 1 worker threads are started.
+    explicit ShardedExecutor(int numShards);
+
+    ~ShardedExecutor();
+
+    ShardedExecutor(const ShardedExecutor&) = delete;
+    ShardedExecutor& operator=(const ShardedExecutor&) = delete;
+
+    inline int getNumShards() const {
+        return mNumShards;
+    }
+
+    // Runs task(shard) for every shard whose bit is set in shardMask and returns once all of them
+    // are done. A shard that is the only one set runs on the calling thread, there is nothing to
+    // overlap it with. Must not be called concurrently.
+    void run(uint64_t shardMask, const std::function<void(int)>& task);
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable cv;
+        // Task to run next, or nullptr when idle.
+        const std::function<void(int)>* task = nullptr;
+        bool stopping = false;
+        std::thread thread;
+    };
+
+    void workerLoop(int shard);
+
+    void onShardDone();
+
+    const int mNumShards;
+
+    // Indexed by shard, mWorkers[0] is unused as shard 0 runs on the caller.
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    std::mutex mDoneMutex;
+    std::condition_variable mDoneCv;
+    int mPendingShards = 0;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define STATSD_DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "utils/StringDictionary.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::string_view;
+
+namespace {
+
+const size_t kInitialSlots = 64;
+
+}  // namespace
+
+bool StringDictionary::insert(string_view str) {
+    const size_t size = mStrings.size();
+    return findOrAdd(str) == size;
+}
+
+string_view StringDictionary::intern(string_view str) {
+    return mStrings[findOrAdd(str)];
+}
+
+size_t StringDictionary::findOrAdd(string_view str) {
+    // Keep the table at most half full.
+    if ((mStrings.size() + 1) * 2 > mSlots.size()) {
+        grow();
+    }
+    const size_t hash = std::hash<string_view>()(str);
+    const size_t slot = findSlot(str, hash);
+    if (mSlots[slot] != 0) {
+        return mSlots[slot] - 1;
+    }
+    mStrings.push_back(copyToBlock(str));
+    mHashes.push_back(hash);
+    mSlots[slot] = mStrings.size();
+    return mStrings.size() - 1;
+}
+
+bool StringDictionary::contains(string_view str) const {
+    if (mSlots.empty()) {
+        return false;
+    }
+    return mSlots[findSlot(str, std::hash<string_view>()(str))] != 0;
+}
+
+void StringDictionary::clear() {
+    std::fill(mSlots.begin(), mSlots.end(), 0);
+    mStrings.clear();
+    mHashes.clear();
+    if (mBlocks.size() > 1) {
+        mBlocks.resize(1);
+    }
+    mBlockUsed = 0;
+    mLargeStrings.clear();
+}
+
+size_t StringDictionary::findSlot(string_view str, size_t hash) const {
+    const size_t mask = mSlots.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        const uint32_t entry = mSlots[slot];
+        if (entry == 0 || (mHashes[entry - 1] == hash && mStrings[entry - 1] == str)) {
+            return slot;
+        }
+    }
+}
+
+string_view StringDictionary::copyToBlock(string_view str) {
+    char* dest;
+    if (str.size() > kBlockSize / 4) {
+        // Large strings get their own allocation instead of wasting the rest of a block.
+        dest = mLargeStrings.emplace_back(std::make_unique<char[]>(str.size())).get();
+    } else {
+        if (mBlocks.empty() || mBlockUsed + str.size() > kBlockSize) {
+            mBlocks.push_back(std::make_unique<char[]>(kBlockSize));
+            mBlockUsed = 0;
+        }
+        dest = mBlocks.back().get() + mBlockUsed;
+        mBlockUsed += str.size();
+    }
+    memcpy(dest, str.data(), str.size());
+    return string_view(dest, str.size());
+}
+
+void StringDictionary::grow() {
+    const size_t numSlots = mSlots.empty() ? kInitialSlots : mSlots.size() * 2;
+    mSlots.assign(numSlots, 0);
+    const size_t mask = numSlots - 1;
+    for (size_t i = 0; i < mStrings.size(); i++) {
+        size_t slot = mHashes[i] & mask;
+        while (mSlots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        mSlots[slot] = i + 1;
+    }
+    VLOG("StringDictionary grew to %zu slots", numSlots);
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
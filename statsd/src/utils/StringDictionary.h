@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Set of distinct strings collected while writing a report whose strings are hashed, written once
+ * to the report's strings field.
+ *
+ * Strings are copied into large blocks and indexed by an open addressing hash table, so adding a
+ * string that is already present allocates nothing, and adding a new one rarely does. Iteration
+ * is in insertion order. The string_views stay valid until clear() is called.
+ */
+class StringDictionary {
+public:
+    using value_type = std::string_view;
+    using const_iterator = std::vector<std::string_view>::const_iterator;
+
+    StringDictionary() = default;
+
+    StringDictionary(const StringDictionary&) = delete;
+    StringDictionary& operator=(const StringDictionary&) = delete;
+
+    // The string_views of the moved dictionary stay valid.
+    StringDictionary(StringDictionary&&) = default;
+    StringDictionary& operator=(StringDictionary&&) = default;
+
+    // Adds str if it is not present yet. Returns whether it was added.
+    bool insert(std::string_view str);
+
+    // Adds str if it is not present yet. Returns the copy of str held by the dictionary.
+    std::string_view intern(std::string_view str);
+
+    bool contains(std::string_view str) const;
+
+    // Removes all strings. Keeps the first block and the table for reuse.
+    void clear();
+
+    inline size_t size() const {
+        return mStrings.size();
+    }
+
+    inline bool empty() const {
+        return mStrings.empty();
+    }
+
+    inline const_iterator begin() const {
+        return mStrings.begin();
+    }
+
+    inline const_iterator end() const {
+        return mStrings.end();
+    }
+
+private:
+    static const size_t kBlockSize = 4096;
+
+    // Returns the index of str in mStrings, adding it if needed.
+    size_t findOrAdd(std::string_view str);
+
+    // Returns the table slot holding str, or the empty slot where it would go.
+    size_t findSlot(std::string_view str, size_t hash) const;
+
+    // Copies str into the current block, starting a new one if it does not fit.
+    std::string_view copyToBlock(std::string_view str);
+
+    void grow();
+
+    // Indices into mStrings plus one, 0 for empty slots. The size is a power of 2.
+    std::vector<uint32_t> mSlots;
+
+    // Added strings in insertion order and their hashes.
+    std::vector<std::string_view> mStrings;
+    std::vector<size_t> mHashes;
+
+    // Blocks the strings are copied to. Only the last one is being filled.
+    std::vector<std::unique_ptr<char[]>> mBlocks;
+    size_t mBlockUsed = 0;
+
+    std::vector<std::unique_ptr<char[]>> mLargeStrings;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
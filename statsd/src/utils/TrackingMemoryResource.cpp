@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define STATSD_DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "utils/TrackingMemoryResource.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+TrackingMemoryResource::TrackingMemoryResource(std::pmr::memory_resource* upstream)
+    : mUpstream(upstream) {
+}
+
+void* TrackingMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = mUpstream->allocate(bytes, alignment);
+    mBytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+    return p;
+}
+
+void TrackingMemoryResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    mUpstream->deallocate(p, bytes, alignment);
+    mBytesAllocated.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+bool TrackingMemoryResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Memory resource counting the bytes currently allocated through it, for containers with a
+ * polymorphic allocator whose exact size is needed by the memory guardrails. Allocations are
+ * forwarded to the upstream resource.
+ */
+class TrackingMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit TrackingMemoryResource(
+            std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    TrackingMemoryResource(const TrackingMemoryResource&) = delete;
+    TrackingMemoryResource& operator=(const TrackingMemoryResource&) = delete;
+
+    inline size_t getBytesAllocated() const {
+        return mBytesAllocated.load(std::memory_order_relaxed);
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* const mUpstream;
+
+    std::atomic<size_t> mBytesAllocated = 0;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -16,10 +16,15 @@
 
 #include <gtest/gtest.h>
 
-using namespace android::os::statsd;
+#include "stats_log_util.h"
+
 using std::shared_ptr;
 
 #ifdef __ANDROID__
+namespace android {
+namespace os {
+namespace statsd {
+
 TEST(AlarmMonitor, popSoonerThan) {
     std::string emptyMetricId;
     std::string emptyDimensionId;
@@ -64,6 +69,35 @@ TEST(AlarmMonitor, popSoonerThan) {
     ASSERT_EQ(0u, set.size());
 }
 
+TEST(AlarmMonitor, TestElapsedTimeAlarmsInWheelSlots) {
+    AlarmMonitor am(2,
+                    [](const shared_ptr<IStatsCompanionService>&, int64_t){},
+                    [](const shared_ptr<IStatsCompanionService>&){});
+
+    // Alarm timestamps are in elapsed realtime, as the times they are popped with.
+    const uint32_t nowSec = static_cast<uint32_t>(getElapsedRealtimeSec());
+    std::vector<sp<const InternalAlarm>> alarms;
+    for (uint32_t i = 1; i <= 5; i++) {
+        alarms.push_back(new InternalAlarm{nowSec + 100 * i});
+        am.add(alarms.back());
+    }
+    EXPECT_TRUE(am.mAlarms.mSlots[AlarmTimingWheel::kOverdueSlot].empty());
+    EXPECT_LE(am.mAlarms.mNowSec, nowSec + 100);
+
+    for (uint32_t i = 1; i <= 5; i++) {
+        unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>> set =
+                am.popSoonerThan(nowSec + 100 * i);
+        ASSERT_EQ(1u, set.size());
+        EXPECT_EQ(1u, set.count(alarms[i - 1]));
+        EXPECT_EQ(nowSec + 100 * i, am.mAlarms.mNowSec);
+        EXPECT_TRUE(am.mAlarms.mSlots[AlarmTimingWheel::kOverdueSlot].empty());
+    }
+    EXPECT_TRUE(am.mAlarms.empty());
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
 #else
 GTEST_LOG_(INFO) << "This test does nothing.\n";
 #endif
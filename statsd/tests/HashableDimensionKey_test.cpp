@@ -164,6 +164,118 @@ TEST(HashableDimensionKeyTest, TestHashDimensionDouble) {
               std::hash<HashableDimensionKey>{}(dimKey2));
 }
 
+/**
+ * Test that atoms can be hashed and compared by their values without building an AtomDimensionKey.
+ */
+TEST(HashableDimensionKeyTest, TestAtomDimensionKeyFromValues) {
+    vector<FieldValue> values = {
+            FieldValue(Field(10, getSimpleField(1)), Value(1005)),
+            FieldValue(Field(10, getSimpleField(2)), Value(std::string("wakelock")))};
+    AtomDimensionKey key(10, HashableDimensionKey(values));
+
+    EXPECT_EQ(std::hash<AtomDimensionKey>{}(key), hashAtomDimension(10, values));
+    EXPECT_TRUE(key.equals(10, values));
+    EXPECT_FALSE(key.equals(11, values));
+    EXPECT_NE(std::hash<AtomDimensionKey>{}(key), hashAtomDimension(11, values));
+
+    vector<FieldValue> otherValues = values;
+    otherValues[1].mValue = Value(std::string("other"));
+    EXPECT_FALSE(key.equals(10, otherValues));
+    EXPECT_NE(std::hash<AtomDimensionKey>{}(key), hashAtomDimension(10, otherValues));
+}
+
+TEST(HashableDimensionKeyTest, TestAtomDimensionKeyTransparentLookup) {
+    vector<FieldValue> values = {
+            FieldValue(Field(10, getSimpleField(1)), Value(1005)),
+            FieldValue(Field(10, getSimpleField(2)), Value(std::string("wakelock")))};
+    std::unordered_map<AtomDimensionKey, int, AtomDimensionKeyHash, AtomDimensionKeyEqual> map;
+    map[AtomDimensionKey(10, HashableDimensionKey(values))] = 1;
+
+    const auto it = map.find(AtomDimensionKeyView{10, values});
+    ASSERT_NE(it, map.end());
+    EXPECT_EQ(it->second, 1);
+    EXPECT_EQ(map.find(AtomDimensionKeyView{11, values}), map.end());
+
+    vector<FieldValue> otherValues = values;
+    otherValues[1].mValue = Value(std::string("other"));
+    EXPECT_EQ(map.find(AtomDimensionKeyView{10, otherValues}), map.end());
+}
+
+namespace {
+
+vector<Matcher> createAttributionMatchers(int atomId, Position position) {
+    FieldMatcher fieldMatcher;
+    fieldMatcher.set_field(atomId);
+    fieldMatcher.add_child()->set_field(3);
+    FieldMatcher* attribution = fieldMatcher.add_child();
+    attribution->set_field(1);
+    attribution->set_position(position);
+    attribution->add_child()->set_field(1);
+    fieldMatcher.add_child()->set_field(2);
+    vector<Matcher> matchers;
+    translateFieldMatcher(fieldMatcher, &matchers);
+    return matchers;
+}
+
+}  // anonymous namespace
+
+/**
+ * Test that the values read from the cached positions are the same as the ones found by comparing
+ * every value, as the attribution chain length changes.
+ */
+TEST(HashableDimensionKeyTest, TestFilterValuesWithPositionCache) {
+    const int atomId = 10;
+    vector<Matcher> matchers = createAttributionMatchers(atomId, Position::LAST);
+    const vector<Matcher> firstMatchers = createAttributionMatchers(atomId, Position::FIRST);
+    matchers.insert(matchers.end(), firstMatchers.begin(), firstMatchers.end());
+    FieldPositionCache positionCache;
+
+    const vector<vector<int>> chains = {{1001}, {1001}, {1002, 1003}, {1002, 1003}, {1004},
+                                        {1005, 1006, 1007}};
+    for (int i = 0; i < (int)chains.size(); i++) {
+        const vector<string> tags(chains[i].size(), "tag");
+        shared_ptr<LogEvent> event = makeAttributionLogEvent(atomId, /*eventTimeNs=*/i, chains[i],
+                                                             tags, /*data1=*/i, /*data2=*/-i);
+        HashableDimensionKey expected;
+        EXPECT_TRUE(filterValues(matchers, event->getValues(), &expected));
+        HashableDimensionKey output;
+        EXPECT_TRUE(filterValues(matchers, event->getValues(), &positionCache, &output));
+        EXPECT_EQ(expected, output) << "event " << i;
+        ASSERT_EQ(6UL, output.getValues().size());
+        EXPECT_EQ(chains[i].front(), output.getValues()[0].mValue.int_value);
+        EXPECT_EQ(chains[i].back(), output.getValues()[1].mValue.int_value);
+    }
+    EXPECT_EQ(FieldPositionCache::Status::kCacheable, positionCache.status);
+    EXPECT_EQ(6UL, positionCache.positions.size());
+
+    // An event of another atom matches nothing and keeps the positions.
+    shared_ptr<LogEvent> otherEvent = CreateTwoValueLogEvent(atomId + 1, 0, 1, 2);
+    HashableDimensionKey output;
+    EXPECT_FALSE(filterValues(matchers, otherEvent->getValues(), &positionCache, &output));
+    EXPECT_EQ(DEFAULT_DIMENSION_KEY, output);
+    EXPECT_EQ(6UL, positionCache.positions.size());
+}
+
+/**
+ * Test that matchers matching several values of an event are not cached.
+ */
+TEST(HashableDimensionKeyTest, TestFilterValuesWithPositionCacheAllPosition) {
+    const int atomId = 10;
+    const vector<Matcher> matchers = createAttributionMatchers(atomId, Position::ALL);
+    FieldPositionCache positionCache;
+
+    shared_ptr<LogEvent> event = makeAttributionLogEvent(atomId, 0, {1001, 1002}, {"a", "b"},
+                                                         /*data1=*/1, /*data2=*/2);
+    HashableDimensionKey expected;
+    EXPECT_TRUE(filterValues(matchers, event->getValues(), &expected));
+    HashableDimensionKey output;
+    EXPECT_TRUE(filterValues(matchers, event->getValues(), &positionCache, &output));
+    EXPECT_EQ(expected, output);
+    EXPECT_EQ(4UL, output.getValues().size());
+    EXPECT_EQ(FieldPositionCache::Status::kNotCacheable, positionCache.status);
+    EXPECT_TRUE(positionCache.positions.empty());
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -2064,6 +2064,115 @@ TEST(AtomMatcherTest, TestStringReplaceNoop) {
     ASSERT_EQ(transformedEvent, nullptr);
 }
 
+TEST(AtomMatcherTest, TestCompileSimpleMatcher) {
+    SimpleAtomMatcher simpleMatcher;
+    simpleMatcher.set_atom_id(TAG_ID);
+    EXPECT_TRUE(compileSimpleAtomMatcher(simpleMatcher).has_value());
+
+    FieldValueMatcher* fieldValueMatcher = simpleMatcher.add_field_value_matcher();
+    fieldValueMatcher->set_field(FIELD_ID_1);
+    fieldValueMatcher->set_position(Position::FIRST);
+    fieldValueMatcher->mutable_eq_any_string()->add_str_value("str");
+    EXPECT_TRUE(compileSimpleAtomMatcher(simpleMatcher).has_value());
+
+    // Wildcard strings are interpreted.
+    fieldValueMatcher->set_eq_wildcard_string("str*");
+    EXPECT_FALSE(compileSimpleAtomMatcher(simpleMatcher).has_value());
+
+    // Nested fields are interpreted.
+    fieldValueMatcher->mutable_matches_tuple()->add_field_value_matcher()->set_eq_int(1);
+    EXPECT_FALSE(compileSimpleAtomMatcher(simpleMatcher).has_value());
+
+    // String transformations are interpreted.
+    fieldValueMatcher->set_eq_string("str");
+    fieldValueMatcher->mutable_replace_string()->set_regex(R"([0-9]+$)");
+    EXPECT_FALSE(compileSimpleAtomMatcher(simpleMatcher).has_value());
+
+    fieldValueMatcher->clear_replace_string();
+    fieldValueMatcher->set_position(Position::ALL);
+    EXPECT_FALSE(compileSimpleAtomMatcher(simpleMatcher).has_value());
+}
+
+TEST(AtomMatcherTest, TestCompiledMatcherMatchesSimple) {
+    sp<UidMap> uidMap = new UidMap();
+    UidData uidData;
+    *uidData.add_app_info() = createApplicationInfo(/*uid*/ 1111, /*version*/ 1, "v1", "pkg0");
+    uidMap->updateMap(1, uidData);
+
+    vector<std::unique_ptr<LogEvent>> events;
+    events.push_back(std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0));
+    makeIntLogEvent(events.back().get(), TAG_ID, 0, 11);
+    events.push_back(std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0));
+    makeFloatLogEvent(events.back().get(), TAG_ID, 0, 10.5f);
+    events.push_back(std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0));
+    makeStringLogEvent(events.back().get(), TAG_ID, 0, "str");
+    events.push_back(std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0));
+    makeBoolLogEvent(events.back().get(), TAG_ID, 0, true, false);
+    events.push_back(std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0));
+    makeRepeatedIntLogEvent(events.back().get(), TAG_ID, {21, 9});
+    events.push_back(std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0));
+    makeRepeatedStringLogEvent(events.back().get(), TAG_ID, {"str", "other"});
+    events.push_back(std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0));
+    makeIntWithBoolAnnotationLogEvent(events.back().get(), TAG_ID, 1111,
+                                      ASTATSLOG_ANNOTATION_ID_IS_UID, true);
+    events.push_back(std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0));
+    makeIntLogEvent(events.back().get(), TAG_ID_2, 0, 11);
+
+    vector<FieldValueMatcher> fieldValueMatchers;
+    fieldValueMatchers.emplace_back().set_eq_bool(true);
+    fieldValueMatchers.emplace_back().set_eq_bool(false);
+    fieldValueMatchers.emplace_back().set_eq_int(11);
+    fieldValueMatchers.emplace_back().set_eq_int(9);
+    fieldValueMatchers.emplace_back().set_lt_int(11);
+    fieldValueMatchers.emplace_back().set_lte_int(11);
+    fieldValueMatchers.emplace_back().set_gt_int(10);
+    fieldValueMatchers.emplace_back().set_gte_int(21);
+    fieldValueMatchers.emplace_back().set_lt_float(11.0f);
+    fieldValueMatchers.emplace_back().set_gt_float(11.0f);
+    fieldValueMatchers.emplace_back().set_eq_string("str");
+    fieldValueMatchers.emplace_back().set_eq_string("pkg0");
+    for (const vector<int64_t>& intList : vector<vector<int64_t>>{{}, {9, 11}, {21, 9}}) {
+        fieldValueMatchers.emplace_back().mutable_eq_any_int()->mutable_int_value()->Add(
+                intList.begin(), intList.end());
+        fieldValueMatchers.emplace_back().mutable_neq_any_int()->mutable_int_value()->Add(
+                intList.begin(), intList.end());
+    }
+    for (const vector<string>& strList :
+         vector<vector<string>>{{}, {"str"}, {"other", "str"}, {"pkg0", "AID_ROOT"}}) {
+        fieldValueMatchers.emplace_back().mutable_eq_any_string()->mutable_str_value()->Add(
+                strList.begin(), strList.end());
+        fieldValueMatchers.emplace_back().mutable_neq_any_string()->mutable_str_value()->Add(
+                strList.begin(), strList.end());
+    }
+
+    for (size_t i = 0; i < fieldValueMatchers.size(); i++) {
+        for (const int field : {FIELD_ID_1, FIELD_ID_2}) {
+            for (const optional<Position> position :
+                 {optional<Position>(), optional<Position>(Position::FIRST),
+                  optional<Position>(Position::LAST), optional<Position>(Position::ANY)}) {
+                SimpleAtomMatcher simpleMatcher;
+                simpleMatcher.set_atom_id(TAG_ID);
+                FieldValueMatcher* matcher = simpleMatcher.add_field_value_matcher();
+                *matcher = fieldValueMatchers[i];
+                matcher->set_field(field);
+                if (position) {
+                    matcher->set_position(*position);
+                }
+                const optional<CompiledSimpleAtomMatcher> compiledMatcher =
+                        compileSimpleAtomMatcher(simpleMatcher);
+                ASSERT_TRUE(compiledMatcher.has_value());
+                for (const auto& event : events) {
+                    EXPECT_EQ(matchesSimple(uidMap, simpleMatcher, *event).matched,
+                              matchesCompiled(uidMap, *compiledMatcher, *event))
+                            << "matcher " << i << " field " << field << " position "
+                            << position.value_or(Position::POSITION_UNKNOWN) << " event "
+                            << event->ToString();
+                }
+            }
+        }
+    }
+}
+
 #else
 GTEST_LOG_(INFO) << "This test does nothing.\n";
 #endif
@@ -539,6 +539,122 @@ TEST(MetricsManagerTest, TestGetTriggerMemoryKbUnset) {
     EXPECT_TRUE(metricsManager.isConfigValid());
 }
 
+TEST(MetricsManagerTest, TestFlushEndedBucketsIncrementally) {
+    sp<UidMap> uidMap;
+    sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> periodicAlarmMonitor;
+
+    StatsdConfig config;
+    config.set_id(kConfigId);
+    *config.add_atom_matcher() = CreateScreenTurnedOnAtomMatcher();
+    *config.add_atom_matcher() = CreateScreenTurnedOffAtomMatcher();
+    for (int i = 0; i < 3; i++) {
+        CountMetric* metric = config.add_count_metric();
+        metric->set_id(StringToId("ScreenOnCount" + std::to_string(i)));
+        metric->set_what(StringToId("ScreenTurnedOn"));
+        metric->set_bucket(ONE_MINUTE);
+    }
+
+    const int64_t timeBaseNs = timeBaseSec * NS_PER_SEC;
+    const int64_t bucketSizeNs = TimeUnitToBucketSizeInMillis(ONE_MINUTE) * 1000000LL;
+    MetricsManager metricsManager(kConfigKey, config, timeBaseNs, timeBaseNs, uidMap,
+                                  pullerManager, anomalyAlarmMonitor, periodicAlarmMonitor);
+    ASSERT_TRUE(metricsManager.isConfigValid());
+    const vector<sp<MetricProducer>>& producers = metricsManager.mAllMetricProducers;
+    ASSERT_EQ(3UL, producers.size());
+
+    metricsManager.onLogEvent(*CreateScreenStateChangedEvent(
+            timeBaseNs + 10 * NS_PER_SEC, android::view::DISPLAY_STATE_ON));
+    EXPECT_EQ(0, producers[0]->getCurrentBucketNum());
+    EXPECT_EQ(0, producers[1]->getCurrentBucketNum());
+    EXPECT_EQ(0, producers[2]->getCurrentBucketNum());
+
+    // Events shortly after the bucket boundary do not close the buckets of the other metrics.
+    metricsManager.onLogEvent(*CreateScreenStateChangedEvent(timeBaseNs + bucketSizeNs + 1,
+                                                             android::view::DISPLAY_STATE_OFF));
+    EXPECT_EQ(0, producers[0]->getCurrentBucketNum());
+    EXPECT_EQ(0, producers[1]->getCurrentBucketNum());
+    EXPECT_EQ(0, producers[2]->getCurrentBucketNum());
+
+    // The ended buckets are then closed a few metrics per event.
+    const int64_t flushTimeNs = timeBaseNs + bucketSizeNs + MetricsManager::kDeferredFlushDelayNs;
+    metricsManager.onLogEvent(
+            *CreateScreenStateChangedEvent(flushTimeNs, android::view::DISPLAY_STATE_OFF));
+    EXPECT_EQ(1, producers[0]->getCurrentBucketNum());
+    EXPECT_EQ(1, producers[1]->getCurrentBucketNum());
+    EXPECT_EQ(0, producers[2]->getCurrentBucketNum());
+
+    metricsManager.onLogEvent(
+            *CreateScreenStateChangedEvent(flushTimeNs + 1, android::view::DISPLAY_STATE_OFF));
+    EXPECT_EQ(1, producers[0]->getCurrentBucketNum());
+    EXPECT_EQ(1, producers[1]->getCurrentBucketNum());
+    EXPECT_EQ(1, producers[2]->getCurrentBucketNum());
+    // The current buckets are not closed before an event of their metric is in them.
+    EXPECT_EQ(flushTimeNs + 1 + MetricsManager::kDeferredFlushMaxScanIntervalNs,
+              metricsManager.mNextDeferredFlushTimeNs);
+
+    // The closed bucket keeps the count of the first event.
+    android::util::ProtoOutputStream output;
+    StringDictionary strSet;
+    producers[2]->onDumpReport(flushTimeNs + 2, /*include_current_partial_bucket=*/false,
+                               /*erase_data=*/true, FAST, &strSet, &output);
+    StatsLogReport report = outputStreamToProto(&output);
+    ASSERT_EQ(1, report.count_metrics().data_size());
+    ASSERT_EQ(1, report.count_metrics().data(0).bucket_info_size());
+    EXPECT_EQ(1, report.count_metrics().data(0).bucket_info(0).count());
+}
+
+TEST(MetricsManagerTest, TestFlushEndedBucketsIncrementallyLateEvent) {
+    sp<UidMap> uidMap;
+    sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> periodicAlarmMonitor;
+
+    StatsdConfig config;
+    config.set_id(kConfigId);
+    *config.add_atom_matcher() = CreateScreenTurnedOnAtomMatcher();
+    *config.add_atom_matcher() = CreateScreenTurnedOffAtomMatcher();
+    CountMetric* metric = config.add_count_metric();
+    metric->set_id(StringToId("ScreenOnCount"));
+    metric->set_what(StringToId("ScreenTurnedOn"));
+    metric->set_bucket(ONE_MINUTE);
+
+    const int64_t timeBaseNs = timeBaseSec * NS_PER_SEC;
+    const int64_t bucketSizeNs = TimeUnitToBucketSizeInMillis(ONE_MINUTE) * 1000000LL;
+    MetricsManager metricsManager(kConfigKey, config, timeBaseNs, timeBaseNs, uidMap,
+                                  pullerManager, anomalyAlarmMonitor, periodicAlarmMonitor);
+    ASSERT_TRUE(metricsManager.isConfigValid());
+    const vector<sp<MetricProducer>>& producers = metricsManager.mAllMetricProducers;
+    ASSERT_EQ(1UL, producers.size());
+
+    metricsManager.onLogEvent(*CreateScreenStateChangedEvent(
+            timeBaseNs + 10 * NS_PER_SEC, android::view::DISPLAY_STATE_ON));
+
+    // An event of another atom closes the ended bucket.
+    const int64_t flushTimeNs = timeBaseNs + bucketSizeNs + MetricsManager::kDeferredFlushDelayNs;
+    metricsManager.onLogEvent(
+            *CreateScreenStateChangedEvent(flushTimeNs, android::view::DISPLAY_STATE_OFF));
+    EXPECT_EQ(1, producers[0]->getCurrentBucketNum());
+
+    // A late event of the metric is still counted in the closed bucket.
+    metricsManager.onLogEvent(*CreateScreenStateChangedEvent(timeBaseNs + bucketSizeNs - 1,
+                                                             android::view::DISPLAY_STATE_ON));
+    // The events of the current bucket are counted in it.
+    metricsManager.onLogEvent(
+            *CreateScreenStateChangedEvent(flushTimeNs + 1, android::view::DISPLAY_STATE_ON));
+
+    android::util::ProtoOutputStream output;
+    StringDictionary strSet;
+    producers[0]->onDumpReport(flushTimeNs + 2, /*include_current_partial_bucket=*/true,
+                               /*erase_data=*/true, FAST, &strSet, &output);
+    StatsLogReport report = outputStreamToProto(&output);
+    ASSERT_EQ(1, report.count_metrics().data_size());
+    ASSERT_EQ(2, report.count_metrics().data(0).bucket_info_size());
+    EXPECT_EQ(2, report.count_metrics().data(0).bucket_info(0).count());
+    EXPECT_EQ(1, report.count_metrics().data(0).bucket_info(1).count());
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
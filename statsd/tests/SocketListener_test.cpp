@@ -53,6 +53,21 @@ public:
     }
 };
 
+// Packs buffers of events with ids [startAtomId, startAtomId + eventCount) into the batched
+// message layout of |uint32_t size|StatsEvent buffer| records.
+std::vector<uint8_t> generateAtomBatch(int eventCount, int startAtomId) {
+    std::vector<uint8_t> batch;
+    for (int i = 0; i < eventCount; i++) {
+        AStatsEventWrapper event(startAtomId + i);
+        auto [buf, size] = event.getBuffer();
+        const uint32_t atomSize = size;
+        const uint8_t* sizePtr = reinterpret_cast<const uint8_t*>(&atomSize);
+        batch.insert(batch.end(), sizePtr, sizePtr + sizeof(atomSize));
+        batch.insert(batch.end(), buf, buf + size);
+    }
+    return batch;
+}
+
 }  //  namespace
 
 void generateAtomLogging(LogEventQueue& queue, const LogEventFilter& filter, int eventCount,
@@ -103,6 +118,42 @@ TEST_P(SocketParseMessageTest, TestProcessMessage) {
     EXPECT_EQ(StatsdStats::getInstance().mEventQueueMaxSizeObservedElapsedNanos, lastEventTs);
 }
 
+TEST_P(SocketParseMessageTest, TestProcessBatchedMessage) {
+    constexpr int kBatchSize = 10;
+    const std::vector<uint8_t> batch = generateAtomBatch(kBatchSize, kAtomId);
+
+    StatsSocketListener::AtomReadStats readStats;
+    StatsSocketListener::processStatsEventBatch(batch.data(), batch.size(), kTestUid, kTestPid,
+                                                mEventQueue, mLogEventFilter, readStats);
+
+    EXPECT_EQ(kBatchSize, readStats.atomCount);
+    EXPECT_EQ(kBatchSize, readStats.atomCounts.size());
+    EXPECT_LE(readStats.minAtomReadTimeNs, readStats.maxAtomReadTimeNs);
+    EXPECT_EQ(kBatchSize, mEventQueue.mQueue.size());
+    for (int i = 0; i < kBatchSize; i++) {
+        auto logEvent = mEventQueue.waitPop();
+        EXPECT_TRUE(logEvent->isValid());
+        EXPECT_EQ(kAtomId + i, logEvent->GetTagId());
+        EXPECT_EQ(logEvent->isParsedHeaderOnly(), GetParam());
+    }
+}
+
+TEST_P(SocketParseMessageTest, TestProcessBatchedMessageMalformed) {
+    constexpr int kBatchSize = 3;
+    std::vector<uint8_t> batch = generateAtomBatch(kBatchSize, kAtomId);
+    // truncate the last record
+    batch.resize(batch.size() - 1);
+
+    StatsSocketListener::AtomReadStats readStats;
+    StatsSocketListener::processStatsEventBatch(batch.data(), batch.size(), kTestUid, kTestPid,
+                                                mEventQueue, mLogEventFilter, readStats);
+
+    // the valid records are processed, the malformed one is accounted as invalid
+    EXPECT_EQ(kBatchSize, readStats.atomCount);
+    EXPECT_EQ(1, readStats.atomCounts[-1]);
+    EXPECT_EQ(kBatchSize - 1, mEventQueue.mQueue.size());
+}
+
 TEST_P(SocketParseMessageTest, TestProcessMessageEmptySetExplicitSet) {
     LogEventFilter::AtomIdSet idsList;
     mLogEventFilter.setAtomIds(idsList, nullptr);
@@ -74,7 +74,7 @@ public:
     MOCK_METHOD(void, onDumpReport,
                 (const int64_t dumpTimeNs, const int64_t wallClockNs,
                  const bool include_current_partial_bucket, const bool erase_data,
-                 const DumpLatency dumpLatency, std::set<string>* str_set,
+                 const DumpLatency dumpLatency, StringDictionary* str_set,
                  android::util::ProtoOutputStream* protoOutput),
                 (override));
 };
@@ -98,9 +98,9 @@ TEST(StatsLogProcessorTest, TestRateLimitByteSize) {
     // Expect only the first flush to trigger a check for byte size since the last two are
     // rate-limited.
     EXPECT_CALL(mockMetricsManager, byteSize()).Times(1);
-    p.flushIfNecessaryLocked(key, mockMetricsManager);
-    p.flushIfNecessaryLocked(key, mockMetricsManager);
-    p.flushIfNecessaryLocked(key, mockMetricsManager);
+    p.flushIfNecessaryLocked(key, mockMetricsManager, getElapsedRealtimeNs());
+    p.flushIfNecessaryLocked(key, mockMetricsManager, getElapsedRealtimeNs());
+    p.flushIfNecessaryLocked(key, mockMetricsManager, getElapsedRealtimeNs());
 }
 
 TEST(StatsLogProcessorTest, TestRateLimitBroadcast) {
@@ -128,7 +128,7 @@ TEST(StatsLogProcessorTest, TestRateLimitBroadcast) {
                     ::testing::Return(int(StatsdStats::kDefaultMaxMetricsBytesPerConfig * .95)));
 
     // Expect only one broadcast despite always returning a size that should trigger broadcast.
-    p.flushIfNecessaryLocked(key, mockMetricsManager);
+    p.flushIfNecessaryLocked(key, mockMetricsManager, getElapsedRealtimeNs());
     EXPECT_EQ(1, broadcastCount);
 
     // b/73089712
@@ -165,10 +165,43 @@ TEST(StatsLogProcessorTest, TestDropWhenByteSizeTooLarge) {
     EXPECT_CALL(mockMetricsManager, dropData(_)).Times(1);
 
     // Expect to call the onDumpReport and skip the broadcast.
-    p.flushIfNecessaryLocked(key, mockMetricsManager);
+    p.flushIfNecessaryLocked(key, mockMetricsManager, getElapsedRealtimeNs());
     EXPECT_EQ(0, broadcastCount);
 }
 
+TEST(StatsLogProcessorTest, TestByteSizeCheckedForConfigsWithoutEvent) {
+    sp<UidMap> m = new UidMap();
+    sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> subscriberAlarmMonitor;
+    int broadcastCount = 0;
+    StatsLogProcessor p(
+            m, pullerManager, anomalyAlarmMonitor, subscriberAlarmMonitor, 0,
+            [&broadcastCount](const ConfigKey& key) {
+                broadcastCount++;
+                return true;
+            },
+            [](const int&, const vector<int64_t>&) { return true; },
+            [](const ConfigKey&, const string&, const vector<int64_t>&) {},
+            std::make_shared<LogEventFilter>());
+
+    // The config is not routed any atom, its data only grows through pulls.
+    sp<MockMetricsManager> mockMetricsManager = new MockMetricsManager();
+    ConfigKey key(100, 12345);
+    p.mMetricsManagers[key] = mockMetricsManager;
+    EXPECT_CALL(*mockMetricsManager, onLogEvent(_)).Times(0);
+    // The second event is within the byte size check period.
+    EXPECT_CALL(*mockMetricsManager, byteSize())
+            .Times(1)
+            .WillRepeatedly(
+                    ::testing::Return(int(StatsdStats::kDefaultMaxMetricsBytesPerConfig * .95)));
+
+    p.OnLogEvent(CreateAppCrashEvent(/*timestampNs=*/10, /*uid=*/1000).get());
+    EXPECT_EQ(1, broadcastCount);
+    p.OnLogEvent(CreateAppCrashEvent(/*timestampNs=*/20, /*uid=*/1000).get());
+    EXPECT_EQ(1, broadcastCount);
+}
+
 StatsdConfig MakeConfig(bool includeMetric) {
     StatsdConfig config;
 
@@ -199,8 +232,9 @@ StatsdConfig makeRestrictedConfig(bool includeMetric = false) {
 
 class MockRestrictedMetricsManager : public MetricsManager {
 public:
-    MockRestrictedMetricsManager(ConfigKey configKey = ConfigKey(1, 12345))
-        : MetricsManager(configKey, makeRestrictedConfig(), 1000, 1000, new UidMap(),
+    MockRestrictedMetricsManager(ConfigKey configKey = ConfigKey(1, 12345),
+                                 const StatsdConfig& config = makeRestrictedConfig())
+        : MetricsManager(configKey, config, 1000, 1000, new UidMap(),
                          new StatsPullerManager(),
                          new AlarmMonitor(
                                  10, [](const shared_ptr<IStatsCompanionService>&, int64_t) {},
@@ -214,7 +248,7 @@ public:
     MOCK_METHOD(void, onDumpReport,
                 (const int64_t dumpTimeNs, const int64_t wallClockNs,
                  const bool include_current_partial_bucket, const bool erase_data,
-                 const DumpLatency dumpLatency, std::set<string>* str_set,
+                 const DumpLatency dumpLatency, StringDictionary* str_set,
                  android::util::ProtoOutputStream* protoOutput),
                 (override));
     MOCK_METHOD(size_t, byteSize, (), (override));
@@ -426,6 +460,141 @@ TEST(StatsLogProcessorTest, TestPullUidProviderSetOnConfigUpdate) {
     EXPECT_EQ(pullerManager->mPullUidProviders.find(key), pullerManager->mPullUidProviders.end());
 }
 
+TEST(StatsLogProcessorTest, TestAtomRouting) {
+    ConfigKey crashKey(3, 4);
+    sp<StatsLogProcessor> processor =
+            CreateStatsLogProcessor(/*timeBaseNs=*/1, /*currentTimeNs=*/1,
+                                    MakeConfig(/*includeMetric=*/true), crashKey);
+
+    // Config with a metric activated by screen on events.
+    StatsdConfig activationConfig;
+    auto wakelockAcquireMatcher = CreateAcquireWakelockAtomMatcher();
+    auto screenOnMatcher = CreateScreenTurnedOnAtomMatcher();
+    *activationConfig.add_atom_matcher() = wakelockAcquireMatcher;
+    *activationConfig.add_atom_matcher() = screenOnMatcher;
+    auto countMetric = activationConfig.add_count_metric();
+    countMetric->set_id(StringToId("WakelockCount"));
+    countMetric->set_what(wakelockAcquireMatcher.id());
+    countMetric->set_bucket(FIVE_MINUTES);
+    auto metricActivation = activationConfig.add_metric_activation();
+    metricActivation->set_metric_id(countMetric->id());
+    auto eventActivation = metricActivation->add_event_activation();
+    eventActivation->set_atom_matcher_id(screenOnMatcher.id());
+    eventActivation->set_ttl_seconds(100);
+    ConfigKey activationKey(3, 5);
+    processor->OnConfigUpdated(/*timestampNs=*/2, activationKey, activationConfig);
+
+    ASSERT_EQ(1, processor->mAtomIdToMetricsManagers.size());
+    const auto& crashRoute =
+            processor->mAtomIdToMetricsManagers.at(util::PROCESS_LIFE_CYCLE_STATE_CHANGED);
+    ASSERT_EQ(1, crashRoute.size());
+    EXPECT_EQ(crashKey, crashRoute[0].key);
+    ASSERT_EQ(1, processor->mMetricsManagersForAllAtoms.size());
+    EXPECT_EQ(activationKey, processor->mMetricsManagersForAllAtoms[0].key);
+
+    processor->OnConfigRemoved(crashKey);
+    EXPECT_TRUE(processor->mAtomIdToMetricsManagers.empty());
+    ASSERT_EQ(1, processor->mMetricsManagersForAllAtoms.size());
+
+    processor->OnConfigRemoved(activationKey);
+    EXPECT_TRUE(processor->mMetricsManagersForAllAtoms.empty());
+}
+
+TEST(StatsLogProcessorTest, TestLogEventNotRoutedToUnrelatedConfig) {
+    ConfigKey key(3, 4);
+    sp<StatsLogProcessor> processor = CreateStatsLogProcessor(
+            /*timeBaseNs=*/1, /*currentTimeNs=*/1, MakeConfig(/*includeMetric=*/false), key);
+    sp<MockMetricsManager> metricsManager = new MockMetricsManager(key);
+    processor->mMetricsManagers[key] = metricsManager;
+    processor->updateAtomRoutingLocked();
+
+    // The config has no matchers, so only the socket loss event reaches it.
+    EXPECT_CALL(*metricsManager, onLogEvent).Times(1);
+    unique_ptr<LogEvent> screenEvent =
+            CreateScreenStateChangedEvent(/*timestampNs=*/10, android::view::DISPLAY_STATE_ON);
+    processor->OnLogEvent(screenEvent.get());
+    unique_ptr<LogEvent> socketLossEvent =
+            createSocketLossInfoLogEvent(/*uid=*/1000, util::SCREEN_STATE_CHANGED);
+    processor->OnLogEvent(socketLossEvent.get());
+}
+
+TEST(StatsLogProcessorTest, TestEventWorkersShardConfigs) {
+    ConfigKey key(3, 4);
+    sp<StatsLogProcessor> processor = CreateStatsLogProcessor(
+            /*timeBaseNs=*/1, /*currentTimeNs=*/1, MakeConfig(/*includeMetric=*/false), key);
+    processor->mMetricsManagers.clear();
+    for (int i = 0; i < 4; i++) {
+        ConfigKey mockKey(3, 10 + i);
+        sp<MockMetricsManager> metricsManager = new MockMetricsManager(mockKey);
+        // Socket loss events are routed to every config.
+        EXPECT_CALL(*metricsManager, onLogEvent).Times(1);
+        processor->mMetricsManagers[mockKey] = metricsManager;
+    }
+    processor->setEventWorkerCount(2);
+
+    std::set<int> shards;
+    for (const auto& route : processor->mAllConfigRoutes) {
+        shards.insert(route.shard);
+    }
+    EXPECT_THAT(shards, UnorderedElementsAre(0, 1));
+
+    unique_ptr<LogEvent> socketLossEvent =
+            createSocketLossInfoLogEvent(/*uid=*/1000, util::SCREEN_STATE_CHANGED);
+    processor->OnLogEvent(socketLossEvent.get());
+
+    processor->setEventWorkerCount(1);
+    for (const auto& route : processor->mAllConfigRoutes) {
+        EXPECT_EQ(0, route.shard);
+    }
+}
+
+TEST(StatsLogProcessorTest, TestSharedMatchers) {
+    ConfigKey key1(3, 4);
+    const StatsdConfig config1 = MakeConfig(/*includeMetric=*/true);
+    sp<StatsLogProcessor> processor =
+            CreateStatsLogProcessor(/*timeBaseNs=*/1, /*currentTimeNs=*/1, config1, key1);
+
+    // Same crash matcher as config1 and an extra screen on matcher.
+    ConfigKey key2(3, 5);
+    StatsdConfig config2 = MakeConfig(/*includeMetric=*/true);
+    auto screenOnMatcher = CreateScreenTurnedOnAtomMatcher();
+    *config2.add_atom_matcher() = screenOnMatcher;
+    auto countMetric = config2.add_count_metric();
+    countMetric->set_id(StringToId("ScreenOn"));
+    countMetric->set_what(screenOnMatcher.id());
+    countMetric->set_bucket(FIVE_MINUTES);
+    processor->OnConfigUpdated(/*timestampNs=*/1, key2, config2);
+
+    EXPECT_EQ(2, processor->mSharedMatchers->size());
+
+    processor->OnLogEvent(CreateAppCrashEvent(/*timestampNs=*/10, /*uid=*/1000).get());
+    processor->OnLogEvent(CreateAppCrashEvent(/*timestampNs=*/20, /*uid=*/1000).get());
+    processor->OnLogEvent(
+            CreateScreenStateChangedEvent(/*timestampNs=*/30, android::view::DISPLAY_STATE_ON)
+                    .get());
+
+    // Both configs count the crashes.
+    for (const ConfigKey& key : {key1, key2}) {
+        vector<uint8_t> buffer;
+        processor->onDumpReport(key, /*dumpTimeNs=*/100, /*include_current_partial_bucket=*/true,
+                                /*erase_data=*/true, ADB_DUMP, FAST, &buffer);
+        ConfigMetricsReportList reports;
+        ASSERT_TRUE(reports.ParseFromArray(buffer.data(), buffer.size()));
+        ASSERT_EQ(1, reports.reports_size());
+        const ConfigMetricsReport& report = reports.reports(0);
+        ASSERT_EQ(key == key1 ? 1 : 2, report.metrics_size());
+        for (const StatsLogReport& metricReport : report.metrics()) {
+            ASSERT_EQ(1, metricReport.count_metrics().data_size());
+            ASSERT_EQ(1, metricReport.count_metrics().data(0).bucket_info_size());
+            const int expectedCount = metricReport.metric_id() == StringToId("ScreenOn") ? 1 : 2;
+            EXPECT_EQ(expectedCount, metricReport.count_metrics().data(0).bucket_info(0).count());
+        }
+    }
+
+    processor->OnConfigRemoved(key2);
+    EXPECT_EQ(1, processor->mSharedMatchers->size());
+}
+
 TEST(StatsLogProcessorTest, InvalidConfigRemoved) {
     ConfigKey key(3, 4);
     StatsdConfig config = MakeConfig(true);
@@ -2239,13 +2408,15 @@ TEST_F(StatsLogProcessorTestRestricted, TestRestrictedLogEventNotPassed) {
 TEST_F(StatsLogProcessorTestRestricted, TestRestrictedLogEventPassed) {
     sp<StatsLogProcessor> processor = CreateStatsLogProcessor(
             /*timeBaseNs=*/1, /*currentTimeNs=*/1, StatsdConfig(), mConfigKey);
-    sp<MockRestrictedMetricsManager> metricsManager = new MockRestrictedMetricsManager(mConfigKey);
+    sp<MockRestrictedMetricsManager> metricsManager = new MockRestrictedMetricsManager(
+            mConfigKey, makeRestrictedConfig(/*includeMetric=*/true));
     EXPECT_CALL(*metricsManager, onLogEvent).Times(1);
 
     processor->mMetricsManagers[mConfigKey] = metricsManager;
+    processor->updateAtomRoutingLocked();
     EXPECT_TRUE(processor->mMetricsManagers[mConfigKey]->hasRestrictedMetricsDelegate());
 
-    unique_ptr<LogEvent> event = CreateRestrictedLogEvent(123);
+    unique_ptr<LogEvent> event = CreateRestrictedLogEvent(util::PROCESS_LIFE_CYCLE_STATE_CHANGED);
     EXPECT_TRUE(event->isValid());
     EXPECT_TRUE(event->isRestricted());
     processor->OnLogEvent(event.get());
@@ -2281,7 +2452,7 @@ TEST_F(StatsLogProcessorTestRestricted, RestrictedMetricFlushIfReachMemoryLimit)
     processor->mMetricsManagers[mConfigKey] = metricsManager;
     EXPECT_TRUE(processor->mMetricsManagers[mConfigKey]->hasRestrictedMetricsDelegate());
 
-    processor->flushIfNecessaryLocked(mConfigKey, *metricsManager);
+    processor->flushIfNecessaryLocked(mConfigKey, *metricsManager, getElapsedRealtimeNs());
 }
 
 TEST_F(StatsLogProcessorTestRestricted, RestrictedMetricNotFlushIfNotReachMemoryLimit) {
@@ -2297,7 +2468,7 @@ TEST_F(StatsLogProcessorTestRestricted, RestrictedMetricNotFlushIfNotReachMemory
     processor->mMetricsManagers[mConfigKey] = metricsManager;
     EXPECT_TRUE(processor->mMetricsManagers[mConfigKey]->hasRestrictedMetricsDelegate());
 
-    processor->flushIfNecessaryLocked(mConfigKey, *metricsManager);
+    processor->flushIfNecessaryLocked(mConfigKey, *metricsManager, getElapsedRealtimeNs());
 }
 
 TEST_F(StatsLogProcessorTestRestricted, NonRestrictedMetricsManagerOnDumpReportCalled) {
@@ -14,14 +14,20 @@
 
 #include "StatsService.h"
 
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
 #include <android/binder_interface_utils.h>
+#include <arpa/inet.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <limits.h>
 #include <stdio.h>
+#include <sys/mman.h>
 
 #include "config/ConfigKey.h"
 #include "packages/UidMap.h"
 #include "src/statsd_config.pb.h"
+#include "stats_log_util.h"
 #include "tests/statsd_test_util.h"
 
 using namespace android;
@@ -31,7 +37,10 @@ namespace android {
 namespace os {
 namespace statsd {
 
+using android::util::FIELD_COUNT_REPEATED;
+using android::util::FIELD_TYPE_STRING;
 using android::util::ProtoOutputStream;
+using android::util::ProtoReader;
 using ::ndk::SharedRefBase;
 
 #ifdef __ANDROID__
@@ -146,6 +155,37 @@ TEST(StatsServiceTest, TestGetUidFromArgs) {
     EXPECT_FALSE(service->getUidFromArgs(args, 2, uid));
 }
 
+TEST(StatsServiceTest, TestWriteSizePrefixedProtoToFd) {
+    // Write more chunks than IOV_MAX, so that they take several writev() calls.
+    ProtoOutputStream proto;
+    const string value(1000, 'a');
+    for (int i = 0; i < 10 * IOV_MAX; i++) {
+        proto.write(FIELD_TYPE_STRING | FIELD_COUNT_REPEATED | 1, value);
+    }
+    int chunks = 0;
+    sp<ProtoReader> reader = proto.data();
+    while (reader->readBuffer() != NULL) {
+        chunks++;
+        reader->move(reader->currentToRead());
+    }
+    ASSERT_GT(chunks, IOV_MAX);
+
+    base::unique_fd fd(memfd_create("proto", MFD_CLOEXEC));
+    ASSERT_GE(fd.get(), 0);
+    ASSERT_TRUE(writeSizePrefixedProtoToFd(proto, fd.get()));
+    ASSERT_EQ(0, lseek(fd.get(), 0, SEEK_SET));
+    string content;
+    ASSERT_TRUE(base::ReadFdToString(fd.get(), &content));
+
+    vector<uint8_t> expected;
+    proto.serializeToVector(&expected);
+    ASSERT_EQ(sizeof(uint32_t) + expected.size(), content.size());
+    uint32_t sizeBE;
+    memcpy(&sizeBE, content.data(), sizeof(sizeBE));
+    EXPECT_EQ(expected.size(), ntohl(sizeBE));
+    EXPECT_EQ(expected, vector<uint8_t>(content.begin() + sizeof(sizeBE), content.end()));
+}
+
 TEST_F(StatsServiceConfigTest, StatsServiceStatsdInitTest) {
     // used for error threshold tolerance due to sleep() is involved
     const int64_t ERROR_THRESHOLD_NS = 25 * 1000000;  // 25 ms
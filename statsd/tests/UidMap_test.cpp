@@ -350,7 +350,7 @@ TEST(UidMapTest, TestOutputIncludesAtLeastOneSnapshot) {
     ProtoOutputStream proto;
     m.appendUidMap(/* timestamp */ 3, config1, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
 
     // Check there's still a uidmap attached this one.
@@ -375,7 +375,7 @@ TEST(UidMapTest, TestRemovedAppRetained) {
     ProtoOutputStream proto;
     m.appendUidMap(/* timestamp */ 3, config1, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
 
     // Snapshot should still contain this item as deleted.
@@ -403,7 +403,7 @@ TEST(UidMapTest, TestRemovedAppOverGuardrail) {
     ProtoOutputStream proto;
     m.appendUidMap(/* timestamp */ 3, config1, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
     outputStreamToProto(&proto, &results);
     ASSERT_EQ(maxDeletedApps + 10, results.snapshots(0).package_info_size());
@@ -417,7 +417,7 @@ TEST(UidMapTest, TestRemovedAppOverGuardrail) {
     proto.clear();
     m.appendUidMap(/* timestamp */ 5, config1, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
     // Snapshot drops the first nine items.
     outputStreamToProto(&proto, &results);
@@ -440,7 +440,7 @@ TEST(UidMapTest, TestClearingOutput) {
     ProtoOutputStream proto;
     m.appendUidMap(/* timestamp */ 2, config1, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
     UidMapping results;
     outputStreamToProto(&proto, &results);
@@ -450,7 +450,7 @@ TEST(UidMapTest, TestClearingOutput) {
     proto.clear();
     m.appendUidMap(/* timestamp */ 2, config1, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
     outputStreamToProto(&proto, &results);
     ASSERT_EQ(1, results.snapshots_size());
@@ -462,7 +462,7 @@ TEST(UidMapTest, TestClearingOutput) {
     proto.clear();
     m.appendUidMap(/* timestamp */ 6, config1, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
     outputStreamToProto(&proto, &results);
     ASSERT_EQ(1, results.snapshots_size());
@@ -477,7 +477,7 @@ TEST(UidMapTest, TestClearingOutput) {
     proto.clear();
     m.appendUidMap(/* timestamp */ 8, config1, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
     outputStreamToProto(&proto, &results);
     ASSERT_EQ(1, results.snapshots_size());
@@ -487,7 +487,7 @@ TEST(UidMapTest, TestClearingOutput) {
     proto.clear();
     m.appendUidMap(/* timestamp */ 9, config2, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
     outputStreamToProto(&proto, &results);
     ASSERT_EQ(1, results.snapshots_size());
@@ -512,13 +512,13 @@ TEST(UidMapTest, TestMemoryComputed) {
     ProtoOutputStream proto;
     m.appendUidMap(/* timestamp */ 2, config1, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
     size_t prevBytes = m.mBytesUsed;
 
     m.appendUidMap(/* timestamp */ 4, config1, /* includeVersionStrings */ true,
                    /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                   /* omitSystemUids */ false,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                    /* str_set */ nullptr, &proto);
     EXPECT_TRUE(m.mBytesUsed < prevBytes);
 }
@@ -549,6 +549,143 @@ TEST(UidMapTest, TestMemoryGuardrail) {
     ASSERT_EQ(1U, m.mChanges.size());
 }
 
+TEST(UidMapTest, TestIncrementalUidMap) {
+    UidMap m;
+    ConfigKey config1(1, StringToId("config1"));
+    m.OnConfigUpdated(config1);
+
+    UidData uidData;
+    *uidData.add_app_info() = createApplicationInfo(/*uid*/ 1000, /*version*/ 4, "v4", kApp1);
+    m.updateMap(1 /* timestamp */, uidData);
+
+    // The first report has a snapshot.
+    ProtoOutputStream proto;
+    m.appendUidMap(/* timestamp */ 2, config1, /* includeVersionStrings */ true,
+                   /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
+                   /* omitSystemUids */ false, /* incremental */ true, /* eraseData */ true,
+                   /* str_set */ nullptr, &proto);
+    UidMapping results;
+    outputStreamToProto(&proto, &results);
+    ASSERT_EQ(1, results.snapshots_size());
+    ASSERT_EQ(0, results.changes_size());
+
+    // The following reports only have the changes.
+    int64_t timestamp = 3;
+    for (int i = 0; i < UidMap::kMaxIncrementalReports; i++) {
+        m.updateApp(timestamp++, kApp1, 1000, 5 + i, "v", "", /* certificateHash */ {});
+        proto.clear();
+        m.appendUidMap(timestamp++, config1, /* includeVersionStrings */ true,
+                       /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
+                       /* omitSystemUids */ false, /* incremental */ true, /* eraseData */ true,
+                       /* str_set */ nullptr, &proto);
+        results.Clear();
+        outputStreamToProto(&proto, &results);
+        EXPECT_EQ(0, results.snapshots_size());
+        ASSERT_EQ(1, results.changes_size());
+        EXPECT_EQ(kApp1, results.changes(0).app());
+        EXPECT_EQ(5 + i, results.changes(0).new_version());
+    }
+
+    // A snapshot is written again after kMaxIncrementalReports reports.
+    proto.clear();
+    m.appendUidMap(timestamp++, config1, /* includeVersionStrings */ true,
+                   /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
+                   /* omitSystemUids */ false, /* incremental */ true, /* eraseData */ true,
+                   /* str_set */ nullptr, &proto);
+    results.Clear();
+    outputStreamToProto(&proto, &results);
+    EXPECT_EQ(1, results.snapshots_size());
+    EXPECT_EQ(0, results.changes_size());
+
+    // A snapshot is written if a change since the last report was dropped.
+    m.maxBytesOverride = kBytesChangeRecord;
+    m.updateApp(timestamp++, kApp1, 1000, 20, "v20", "", /* certificateHash */ {});
+    m.updateApp(timestamp++, kApp1, 1000, 21, "v21", "", /* certificateHash */ {});
+    ASSERT_EQ(1U, m.mChanges.size());
+    proto.clear();
+    m.appendUidMap(timestamp++, config1, /* includeVersionStrings */ true,
+                   /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
+                   /* omitSystemUids */ false, /* incremental */ true, /* eraseData */ true,
+                   /* str_set */ nullptr, &proto);
+    results.Clear();
+    outputStreamToProto(&proto, &results);
+    EXPECT_EQ(1, results.snapshots_size());
+    ASSERT_EQ(1, results.changes_size());
+    EXPECT_EQ(21, results.changes(0).new_version());
+}
+
+TEST(UidMapTest, TestIncrementalUidMapKeepData) {
+    UidMap m;
+    ConfigKey config1(1, StringToId("config1"));
+    m.OnConfigUpdated(config1);
+
+    UidData uidData;
+    *uidData.add_app_info() = createApplicationInfo(/*uid*/ 1000, /*version*/ 4, "v4", kApp1);
+    m.updateMap(1 /* timestamp */, uidData);
+
+    ProtoOutputStream proto;
+    m.appendUidMap(/* timestamp */ 2, config1, /* includeVersionStrings */ true,
+                   /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
+                   /* omitSystemUids */ false, /* incremental */ true, /* eraseData */ true,
+                   /* str_set */ nullptr, &proto);
+    m.updateApp(3, kApp1, 1000, 5, "v5", "", /* certificateHash */ {});
+
+    // A report that keeps the data has a snapshot and leaves the change to the next report.
+    proto.clear();
+    m.appendUidMap(/* timestamp */ 4, config1, /* includeVersionStrings */ true,
+                   /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
+                   /* omitSystemUids */ false, /* incremental */ true, /* eraseData */ false,
+                   /* str_set */ nullptr, &proto);
+    UidMapping results;
+    outputStreamToProto(&proto, &results);
+    EXPECT_EQ(1, results.snapshots_size());
+    ASSERT_EQ(1, results.changes_size());
+    EXPECT_EQ(2, m.mLastUpdatePerConfigKey[config1]);
+    EXPECT_EQ(0, m.mIncrementalReportsPerConfigKey[config1]);
+
+    proto.clear();
+    m.appendUidMap(/* timestamp */ 5, config1, /* includeVersionStrings */ true,
+                   /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
+                   /* omitSystemUids */ false, /* incremental */ true, /* eraseData */ true,
+                   /* str_set */ nullptr, &proto);
+    results.Clear();
+    outputStreamToProto(&proto, &results);
+    EXPECT_EQ(0, results.snapshots_size());
+    ASSERT_EQ(1, results.changes_size());
+    EXPECT_EQ(kApp1, results.changes(0).app());
+    EXPECT_EQ(5, results.changes(0).new_version());
+    EXPECT_EQ(0U, m.mChanges.size());
+    EXPECT_EQ(5, m.mLastUpdatePerConfigKey[config1]);
+
+    // A non-incremental report that keeps the data still marks the changes as sent.
+    m.updateApp(6, kApp1, 1000, 6, "v6", "", /* certificateHash */ {});
+    proto.clear();
+    m.appendUidMap(/* timestamp */ 7, config1, /* includeVersionStrings */ true,
+                   /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
+                   /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ false,
+                   /* str_set */ nullptr, &proto);
+    results.Clear();
+    outputStreamToProto(&proto, &results);
+    EXPECT_EQ(1, results.snapshots_size());
+    ASSERT_EQ(1, results.changes_size());
+    EXPECT_EQ(0U, m.mChanges.size());
+    EXPECT_EQ(7, m.mLastUpdatePerConfigKey[config1]);
+}
+
+TEST(UidMapTest, TestChangeStringsCompacted) {
+    UidMap m;
+    m.maxBytesOverride = kBytesChangeRecord;
+    for (int i = 0; i < 20; i++) {
+        m.updateApp(i, "app" + to_string(i), 1000 + i, 1, "v" + to_string(i), "",
+                    /* certificateHash */ {});
+    }
+    ASSERT_EQ(1U, m.mChanges.size());
+    EXPECT_LE(m.mChangeStrings.size(), 6U);
+    EXPECT_EQ("app19", m.mChanges.front().package);
+    EXPECT_EQ("v19", m.mChanges.front().versionString);
+    EXPECT_EQ("", m.mChanges.front().prevVersionString);
+}
+
 namespace {
 class UidMapTestAppendUidMap : public UidMapTestAppendUidMapBase {
 protected:
@@ -579,10 +716,11 @@ protected:
 
 TEST_F(UidMapTestAppendUidMap, TestInstallersInReportIncludeInstallerAndHashStrings) {
     ProtoOutputStream proto;
-    set<string> strSet;
+    StringDictionary strSet;
     uidMap->appendUidMap(/* timestamp */ 3, cfgKey, /* includeVersionStrings */ true,
                          /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                         /* omitSystemUids */ false, &strSet, &proto);
+                         /* omitSystemUids */ false, /* incremental */ false,
+                         /* eraseData */ true, &strSet, &proto);
 
     UidMapping results;
     outputStreamToProto(&proto, &results);
@@ -618,7 +756,7 @@ TEST_F(UidMapTestAppendUidMap, TestInstallersInReportIncludeInstallerAndDontHash
     ProtoOutputStream proto;
     uidMap->appendUidMap(/* timestamp */ 3, cfgKey, /* includeVersionStrings */ true,
                          /* includeInstaller */ true, /* truncatedCertificateHashSize */ 0,
-                         /* omitSystemUids */ false,
+                         /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                          /* str_set */ nullptr, &proto);
 
     UidMapping results;
@@ -643,13 +781,13 @@ TEST_F(UidMapTestAppendUidMap, TestInstallersInReportIncludeInstallerAndDontHash
                 UnorderedPointwise(EqPackageInfo(), expectedPackageInfos));
 }
 
-// Set up parameterized test with set<string>* parameter to control whether strings are hashed
+// Set up parameterized test with StringDictionary* parameter to control whether strings are hashed
 // or not in the report. A value of nullptr indicates strings should not be hashed and non-null
 // values indicates strings are hashed in the report and the original strings are added to this set.
 class UidMapTestAppendUidMapHashStrings : public UidMapTestAppendUidMap,
-                                          public WithParamInterface<set<string>*> {
+                                          public WithParamInterface<StringDictionary*> {
 public:
-    inline static set<string> strSet;
+    inline static StringDictionary strSet;
 
 protected:
     void SetUp() override {
@@ -668,7 +806,7 @@ TEST_P(UidMapTestAppendUidMapHashStrings, TestNoIncludeInstallersInReport) {
     ProtoOutputStream proto;
     uidMap->appendUidMap(/* timestamp */ 3, cfgKey, /* includeVersionStrings */ true,
                          /* includeInstaller */ false, /* truncatedCertificateHashSize */ 0,
-                         /* omitSystemUids */ false,
+                         /* omitSystemUids */ false, /* incremental */ false, /* eraseData */ true,
                          /* str_set */ GetParam(), &proto);
 
     UidMapping results;
@@ -702,7 +840,8 @@ TEST_P(UidMapTestTruncateCertificateHash, TestCertificateHashesTruncated) {
     ProtoOutputStream proto;
     uidMap->appendUidMap(/* timestamp */ 3, cfgKey, /* includeVersionStrings */ true,
                          /* includeInstaller */ false, hashSize, /* omitSystemUids */ false,
-                         /* str_set */ nullptr, &proto);
+                         /* incremental */ false, /* eraseData */ true, /* str_set */ nullptr,
+                         &proto);
 
     UidMapping results;
     outputStreamToProto(&proto, &results);
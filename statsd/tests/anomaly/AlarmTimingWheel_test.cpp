@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "anomaly/AlarmTimingWheel.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <vector>
+
+#ifdef __ANDROID__
+
+using namespace std;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+namespace {
+
+using AlarmSet = unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>>;
+
+AlarmSet popSoonerThan(AlarmTimingWheel& wheel, uint32_t timestampSec) {
+    AlarmSet alarms;
+    wheel.popSoonerThan(timestampSec, &alarms);
+    return alarms;
+}
+
+}  // anonymous namespace
+
+TEST(AlarmTimingWheelTest, TestAddAndRemove) {
+    AlarmTimingWheel wheel;
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(0u, wheel.getSoonestTimestampSec());
+
+    sp<const InternalAlarm> a = new InternalAlarm{100};
+    sp<const InternalAlarm> b = new InternalAlarm{50};
+    sp<const InternalAlarm> c = new InternalAlarm{100000};
+
+    EXPECT_TRUE(wheel.add(a, 0));
+    EXPECT_FALSE(wheel.add(a, 0));
+    EXPECT_FALSE(wheel.add(nullptr, 0));
+    EXPECT_TRUE(wheel.add(b, 0));
+    EXPECT_TRUE(wheel.add(c, 0));
+    EXPECT_EQ(3u, wheel.size());
+    EXPECT_EQ(50u, wheel.getSoonestTimestampSec());
+
+    EXPECT_TRUE(wheel.remove(b));
+    EXPECT_FALSE(wheel.remove(b));
+    EXPECT_EQ(100u, wheel.getSoonestTimestampSec());
+    EXPECT_TRUE(wheel.remove(a));
+    EXPECT_EQ(100000u, wheel.getSoonestTimestampSec());
+    EXPECT_TRUE(wheel.remove(c));
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(0u, wheel.getSoonestTimestampSec());
+}
+
+TEST(AlarmTimingWheelTest, TestRemoveFromOtherWheel) {
+    AlarmTimingWheel wheel1;
+    AlarmTimingWheel wheel2;
+    sp<const InternalAlarm> a = new InternalAlarm{10};
+    sp<const InternalAlarm> b = new InternalAlarm{10};
+    wheel1.add(a, 0);
+    wheel2.add(b, 0);
+
+    EXPECT_FALSE(wheel1.remove(b));
+    EXPECT_FALSE(wheel2.remove(a));
+    EXPECT_EQ(1u, wheel1.size());
+    EXPECT_EQ(1u, wheel2.size());
+}
+
+TEST(AlarmTimingWheelTest, TestPopAcrossLevels) {
+    AlarmTimingWheel wheel;
+    sp<const InternalAlarm> a = new InternalAlarm{10};
+    sp<const InternalAlarm> b = new InternalAlarm{75};
+    sp<const InternalAlarm> c = new InternalAlarm{5000};
+    sp<const InternalAlarm> d = new InternalAlarm{300000};
+    sp<const InternalAlarm> e = new InternalAlarm{4000000000u};
+    for (const auto& alarm : {a, b, c, d, e}) {
+        wheel.add(alarm, 0);
+    }
+
+    EXPECT_TRUE(popSoonerThan(wheel, 9).empty());
+    EXPECT_EQ(AlarmSet({a}), popSoonerThan(wheel, 74));
+    EXPECT_EQ(75u, wheel.getSoonestTimestampSec());
+    EXPECT_EQ(AlarmSet({b, c}), popSoonerThan(wheel, 5000));
+    EXPECT_EQ(300000u, wheel.getSoonestTimestampSec());
+    EXPECT_TRUE(popSoonerThan(wheel, 299999).empty());
+    EXPECT_EQ(AlarmSet({d}), popSoonerThan(wheel, 300000));
+    EXPECT_EQ(4000000000u, wheel.getSoonestTimestampSec());
+    EXPECT_EQ(AlarmSet({e}), popSoonerThan(wheel, UINT32_MAX));
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(AlarmTimingWheelTest, TestAddPastAlarm) {
+    AlarmTimingWheel wheel;
+    sp<const InternalAlarm> a = new InternalAlarm{1000};
+    sp<const InternalAlarm> b = new InternalAlarm{2000};
+    wheel.add(a, 0);
+    EXPECT_EQ(AlarmSet({a}), popSoonerThan(wheel, 1500));
+
+    // Added after the wheel moved past it.
+    sp<const InternalAlarm> c = new InternalAlarm{1200};
+    wheel.add(b, 1500);
+    wheel.add(c, 1500);
+    EXPECT_EQ(1200u, wheel.getSoonestTimestampSec());
+    EXPECT_TRUE(popSoonerThan(wheel, 1100).empty());
+    EXPECT_EQ(AlarmSet({c}), popSoonerThan(wheel, 1200));
+    EXPECT_EQ(AlarmSet({b}), popSoonerThan(wheel, 2000));
+}
+
+TEST(AlarmTimingWheelTest, TestAnchoredToCurrentTime) {
+    AlarmTimingWheel wheel;
+    const uint32_t nowSec = 1000000;
+    sp<const InternalAlarm> far = new InternalAlarm{nowSec + 100000};
+    wheel.add(far, nowSec);
+
+    // Alarms sooner than the first one are still in the future, they must not be overdue.
+    vector<sp<const InternalAlarm>> alarms;
+    for (uint32_t i = 1; i <= 1000; i++) {
+        sp<const InternalAlarm> alarm = new InternalAlarm{nowSec + i};
+        ASSERT_TRUE(wheel.add(alarm, nowSec));
+        alarms.push_back(alarm);
+    }
+    EXPECT_TRUE(wheel.mSlots[AlarmTimingWheel::kOverdueSlot].empty());
+    EXPECT_EQ(nowSec + 1, wheel.getSoonestTimestampSec());
+
+    EXPECT_EQ(AlarmSet({alarms[0]}), popSoonerThan(wheel, nowSec + 1));
+    EXPECT_EQ(AlarmSet(alarms.begin() + 1, alarms.end()), popSoonerThan(wheel, nowSec + 1000));
+    EXPECT_EQ(AlarmSet({far}), popSoonerThan(wheel, nowSec + 100000));
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(AlarmTimingWheelTest, TestMatchesOrderedReference) {
+    std::mt19937 random(42);
+    AlarmTimingWheel wheel;
+    multimap<uint32_t, sp<const InternalAlarm>> reference;
+    vector<sp<const InternalAlarm>> alarms;
+    uint32_t nowSec = 1000;
+
+    for (int i = 0; i < 20000; i++) {
+        const int action = random() % 10;
+        if (action < 5) {
+            // Mostly near alarms, some far ones to exercise the upper levels and the overflow.
+            const uint32_t range = action < 4 ? 200 : 50000000;
+            sp<const InternalAlarm> alarm =
+                    new InternalAlarm{(uint32_t)(nowSec - 50 + random() % range)};
+            ASSERT_TRUE(wheel.add(alarm, nowSec));
+            reference.emplace(alarm->timestampSec, alarm);
+            alarms.push_back(alarm);
+        } else if (action < 8 && !alarms.empty()) {
+            const size_t index = random() % alarms.size();
+            const sp<const InternalAlarm> alarm = alarms[index];
+            alarms[index] = alarms.back();
+            alarms.pop_back();
+            bool inReference = false;
+            const auto [begin, end] = reference.equal_range(alarm->timestampSec);
+            for (auto it = begin; it != end; it++) {
+                if (it->second == alarm) {
+                    reference.erase(it);
+                    inReference = true;
+                    break;
+                }
+            }
+            ASSERT_EQ(inReference, wheel.remove(alarm));
+        } else {
+            nowSec += random() % (action == 9 ? 100000 : 100);
+            AlarmSet expected;
+            while (!reference.empty() && reference.begin()->first <= nowSec) {
+                expected.insert(reference.begin()->second);
+                reference.erase(reference.begin());
+            }
+            ASSERT_EQ(expected, popSoonerThan(wheel, nowSec));
+        }
+        ASSERT_EQ(reference.size(), wheel.size());
+        ASSERT_EQ(reference.empty() ? 0u : reference.begin()->first,
+                  wheel.getSoonestTimestampSec());
+    }
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
@@ -41,6 +41,7 @@ using namespace testing;
 using Status = ::ndk::ScopedAStatus;
 using aidl::android::os::BnPullAtomCallback;
 using aidl::android::os::IPullAtomResultReceiver;
+using aidl::android::util::StatsEventBulkParcel;
 using aidl::android::util::StatsEventParcel;
 using ::ndk::SharedRefBase;
 using std::make_shared;
@@ -52,6 +53,7 @@ using testing::Contains;
 namespace {
 int pullTagId = -12;
 bool pullSuccess;
+bool pullBulk;
 vector<int64_t> values;
 int64_t pullDelayNs;
 int64_t pullTimeoutNs;
@@ -66,7 +68,27 @@ AStatsEvent* createSimpleEvent(int64_t value) {
     return event;
 }
 
+StatsEventBulkParcel createBulkParcel() {
+    StatsEventBulkParcel bulkParcel;
+    for (int i = 0; i < values.size(); i++) {
+        AStatsEvent* event = createSimpleEvent(values[i]);
+        size_t size;
+        uint8_t* buffer = AStatsEvent_getBuffer(event, &size);
+        bulkParcel.eventOffsets.push_back(bulkParcel.buffer.size());
+        bulkParcel.buffer.insert(bulkParcel.buffer.end(), buffer, buffer + size);
+        AStatsEvent_release(event);
+    }
+    return bulkParcel;
+}
+
 void executePull(const shared_ptr<IPullAtomResultReceiver>& resultReceiver) {
+    if (pullBulk) {
+        StatsEventBulkParcel bulkParcel = createBulkParcel();
+        sleep_for(std::chrono::nanoseconds(pullDelayNs));
+        resultReceiver->pullFinishedBulk(pullTagId, pullSuccess, bulkParcel);
+        return;
+    }
+
     // Convert stats_events into StatsEventParcels.
     vector<StatsEventParcel> parcels;
     for (int i = 0; i < values.size(); i++) {
@@ -103,6 +125,7 @@ public:
 
     void SetUp() override {
         pullSuccess = false;
+        pullBulk = false;
         pullDelayNs = 0;
         values.clear();
         pullTimeoutNs = 10000000000LL;  // 10 seconds.
@@ -139,6 +162,41 @@ TEST_F(StatsCallbackPullerTest, PullSuccess) {
     EXPECT_EQ(value, dataHolder[0]->getValues()[0].mValue.int_value);
 }
 
+TEST_F(StatsCallbackPullerTest, PullBulkSuccess) {
+    shared_ptr<FakePullAtomCallback> cb = SharedRefBase::make<FakePullAtomCallback>();
+    pullSuccess = true;
+    pullBulk = true;
+    values = {11, 22, 33};
+
+    StatsCallbackPuller puller(pullTagId, cb, pullCoolDownNs, pullTimeoutNs, {});
+
+    vector<std::shared_ptr<LogEvent>> dataHolder;
+    EXPECT_EQ(puller.PullInternal(&dataHolder), PULL_SUCCESS);
+
+    ASSERT_EQ(values.size(), dataHolder.size());
+    for (int i = 0; i < values.size(); i++) {
+        EXPECT_EQ(pullTagId, dataHolder[i]->GetTagId());
+        ASSERT_EQ(1, dataHolder[i]->size());
+        EXPECT_EQ(values[i], dataHolder[i]->getValues()[0].mValue.long_value);
+    }
+}
+
+TEST_F(StatsCallbackPullerTest, ParseBulkParcelMalformedOffsets) {
+    values = {11, 22};
+    StatsEventBulkParcel bulkParcel = createBulkParcel();
+    // offsets must not decrease
+    std::swap(bulkParcel.eventOffsets[0], bulkParcel.eventOffsets[1]);
+
+    vector<std::shared_ptr<LogEvent>> dataHolder;
+    EXPECT_FALSE(parseStatsEventBulkParcel(bulkParcel, dataHolder));
+
+    // offsets must be within the buffer
+    bulkParcel = createBulkParcel();
+    bulkParcel.eventOffsets.push_back(bulkParcel.buffer.size() + 1);
+    dataHolder.clear();
+    EXPECT_FALSE(parseStatsEventBulkParcel(bulkParcel, dataHolder));
+}
+
 TEST_F(StatsCallbackPullerTest, PullFail) {
     shared_ptr<FakePullAtomCallback> cb = SharedRefBase::make<FakePullAtomCallback>();
     pullSuccess = false;
@@ -308,6 +308,35 @@ TEST_F(StatsPullerTest, PullFailsAndPullSameEventTime) {
     ASSERT_EQ(0, dataHolder.size());
 }
 
+TEST_F(StatsPullerTest, PullSharedSnapshot) {
+    pullData.push_back(createSimpleEvent(1111L, 33));
+
+    pullSuccess = true;
+    int64_t eventTimeNs = getElapsedRealtimeNs();
+
+    PulledData firstData;
+    EXPECT_EQ(puller.Pull(eventTimeNs, /*wallClockNs=*/5555L, &firstData), PULL_SUCCESS);
+    ASSERT_EQ(1, firstData->size());
+    EXPECT_EQ(eventTimeNs, firstData->at(0)->GetElapsedTimestampNs());
+    EXPECT_EQ(5555L, firstData->at(0)->GetLogdTimestampNs());
+    EXPECT_EQ(33, firstData->at(0)->getValues()[0].mValue.int_value);
+
+    // Same timestamps, the cached snapshot is handed out as is.
+    PulledData secondData;
+    EXPECT_EQ(puller.Pull(eventTimeNs, /*wallClockNs=*/5555L, &secondData), PULL_SUCCESS);
+    EXPECT_EQ(firstData.get(), secondData.get());
+
+    // Different timestamps while the snapshot is still held, it is copied before being stamped.
+    PulledData thirdData;
+    EXPECT_EQ(puller.Pull(eventTimeNs, /*wallClockNs=*/6666L, &thirdData), PULL_SUCCESS);
+    EXPECT_NE(firstData.get(), thirdData.get());
+    ASSERT_EQ(1, thirdData->size());
+    EXPECT_EQ(eventTimeNs, thirdData->at(0)->GetElapsedTimestampNs());
+    EXPECT_EQ(6666L, thirdData->at(0)->GetLogdTimestampNs());
+    EXPECT_EQ(33, thirdData->at(0)->getValues()[0].mValue.int_value);
+    EXPECT_EQ(5555L, firstData->at(0)->GetLogdTimestampNs());
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
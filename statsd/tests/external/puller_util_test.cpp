@@ -106,14 +106,14 @@ TEST(PullerUtilTest, MergeWithDimension) {
     const vector<FieldValue>* actualFieldValues = &data[0]->getValues();
     ASSERT_EQ(3, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
-    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData + isolatedAdditiveData, actualFieldValues->at(2).mValue.int_value);
 
     actualFieldValues = &data[1]->getValues();
     ASSERT_EQ(3, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
-    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData + isolatedAdditiveData, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
 }
 
 TEST(PullerUtilTest, NoMergeHostUidOnly) {
@@ -135,14 +135,14 @@ TEST(PullerUtilTest, NoMergeHostUidOnly) {
     const vector<FieldValue>* actualFieldValues = &data[0]->getValues();
     ASSERT_EQ(3, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
-    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
+    EXPECT_EQ(isolatedAdditiveData, actualFieldValues->at(2).mValue.int_value);
 
     actualFieldValues = &data[1]->getValues();
     ASSERT_EQ(3, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
-    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(isolatedAdditiveData, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
 }
 
 TEST(PullerUtilTest, IsolatedUidOnly) {
@@ -161,19 +161,19 @@ TEST(PullerUtilTest, IsolatedUidOnly) {
 
     ASSERT_EQ(2, (int)data.size());
 
-    // 20->32->31
+    // 20->22->21
     const vector<FieldValue>* actualFieldValues = &data[0]->getValues();
     ASSERT_EQ(3, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
-    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
+    EXPECT_EQ(isolatedAdditiveData, actualFieldValues->at(2).mValue.int_value);
 
-    // 20->22->21
+    // 20->32->31
     actualFieldValues = &data[1]->getValues();
     ASSERT_EQ(3, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
-    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(isolatedAdditiveData, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(1).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
 }
 
 TEST(PullerUtilTest, MultipleIsolatedUidToOneHostUid) {
@@ -310,8 +310,8 @@ TEST(PullerUtilTest, MergeWithDimensionAttributionChain) {
     EXPECT_EQ("tag1", actualFieldValues->at(1).mValue.str_value);
     EXPECT_EQ(hostUid, actualFieldValues->at(2).mValue.int_value);
     EXPECT_EQ("tag2", actualFieldValues->at(3).mValue.str_value);
-    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(5).mValue.int_value);
+    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData + isolatedAdditiveData, actualFieldValues->at(5).mValue.int_value);
 
     actualFieldValues = &data[1]->getValues();
     ASSERT_EQ(6, actualFieldValues->size());
@@ -319,8 +319,8 @@ TEST(PullerUtilTest, MergeWithDimensionAttributionChain) {
     EXPECT_EQ("tag1", actualFieldValues->at(1).mValue.str_value);
     EXPECT_EQ(hostUid, actualFieldValues->at(2).mValue.int_value);
     EXPECT_EQ("tag2", actualFieldValues->at(3).mValue.str_value);
-    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData + isolatedAdditiveData, actualFieldValues->at(5).mValue.int_value);
+    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(5).mValue.int_value);
 }
 
 TEST(PullerUtilTest, NoMergeHostUidOnlyAttributionChain) {
@@ -346,8 +346,8 @@ TEST(PullerUtilTest, NoMergeHostUidOnlyAttributionChain) {
     EXPECT_EQ("tag1", actualFieldValues->at(1).mValue.str_value);
     EXPECT_EQ(400, actualFieldValues->at(2).mValue.int_value);
     EXPECT_EQ("tag2", actualFieldValues->at(3).mValue.str_value);
-    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(5).mValue.int_value);
+    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
+    EXPECT_EQ(isolatedAdditiveData, actualFieldValues->at(5).mValue.int_value);
 
     actualFieldValues = &data[1]->getValues();
     ASSERT_EQ(6, actualFieldValues->size());
@@ -355,8 +355,8 @@ TEST(PullerUtilTest, NoMergeHostUidOnlyAttributionChain) {
     EXPECT_EQ("tag1", actualFieldValues->at(1).mValue.str_value);
     EXPECT_EQ(400, actualFieldValues->at(2).mValue.int_value);
     EXPECT_EQ("tag2", actualFieldValues->at(3).mValue.str_value);
-    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
-    EXPECT_EQ(isolatedAdditiveData, actualFieldValues->at(5).mValue.int_value);
+    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(5).mValue.int_value);
 }
 
 TEST(PullerUtilTest, IsolatedUidOnlyAttributionChain) {
@@ -376,25 +376,25 @@ TEST(PullerUtilTest, IsolatedUidOnlyAttributionChain) {
 
     ASSERT_EQ(2, (int)data.size());
 
-    // 20->tag1->400->tag2->32->31
+    // 20->tag1->400->tag2->22->21
     const vector<FieldValue>* actualFieldValues = &data[0]->getValues();
     ASSERT_EQ(6, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
     EXPECT_EQ("tag1", actualFieldValues->at(1).mValue.str_value);
     EXPECT_EQ(400, actualFieldValues->at(2).mValue.int_value);
     EXPECT_EQ("tag2", actualFieldValues->at(3).mValue.str_value);
-    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(5).mValue.int_value);
+    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
+    EXPECT_EQ(isolatedAdditiveData, actualFieldValues->at(5).mValue.int_value);
 
-    // 20->tag1->400->tag2->22->21
+    // 20->tag1->400->tag2->32->31
     actualFieldValues = &data[1]->getValues();
     ASSERT_EQ(6, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
     EXPECT_EQ("tag1", actualFieldValues->at(1).mValue.str_value);
     EXPECT_EQ(400, actualFieldValues->at(2).mValue.int_value);
     EXPECT_EQ("tag2", actualFieldValues->at(3).mValue.str_value);
-    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
-    EXPECT_EQ(isolatedAdditiveData, actualFieldValues->at(5).mValue.int_value);
+    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(4).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(5).mValue.int_value);
 }
 
 TEST(PullerUtilTest, MultipleIsolatedUidToOneHostUidAttributionChain) {
@@ -469,7 +469,7 @@ TEST(PullerUtilTest, RepeatedAdditiveField) {
     EXPECT_EQ(9, actualFieldValues->at(3).mValue.int_value);
 }
 
-// Test that repeated uid events are sorted and merged correctly.
+// Test that repeated uid events are merged correctly.
 TEST(PullerUtilTest, RepeatedUidField) {
     vector<int> uidArray1 = {isolatedUid1, hostUid};
     vector<int> uidArray2 = {isolatedUid1, isolatedUid3};
@@ -514,20 +514,20 @@ TEST(PullerUtilTest, RepeatedUidField) {
     EXPECT_EQ(hostAdditiveData + isolatedAdditiveData + hostAdditiveData,
               actualFieldValues->at(3).mValue.int_value);
 
-    // Event 4 isn't merged - different non-additive data.
+    // Event 2 isn't merged - different uid.
     actualFieldValues = &data[1]->getValues();
     ASSERT_EQ(4, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
-    EXPECT_EQ(hostUid, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(hostUid2, actualFieldValues->at(1).mValue.int_value);
+    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(2).mValue.int_value);
     EXPECT_EQ(hostAdditiveData, actualFieldValues->at(3).mValue.int_value);
 
-    // Event 2 isn't merged - different uid.
+    // Event 4 isn't merged - different non-additive data.
     actualFieldValues = &data[2]->getValues();
     ASSERT_EQ(4, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
-    EXPECT_EQ(hostUid2, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(hostNonAdditiveData, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(hostUid, actualFieldValues->at(1).mValue.int_value);
+    EXPECT_EQ(isolatedNonAdditiveData, actualFieldValues->at(2).mValue.int_value);
     EXPECT_EQ(hostAdditiveData, actualFieldValues->at(3).mValue.int_value);
 
     // Event 5 isn't merged - different repeated uid length.
@@ -540,8 +540,7 @@ TEST(PullerUtilTest, RepeatedUidField) {
     EXPECT_EQ(hostAdditiveData, actualFieldValues->at(4).mValue.int_value);
 }
 
-// Test that repeated uid events with multiple repeated non-additive fields are sorted and merged
-// correctly.
+// Test that repeated uid events with multiple repeated non-additive fields are merged correctly.
 TEST(PullerUtilTest, MultipleRepeatedFields) {
     vector<int> uidArray1 = {isolatedUid1, hostUid};
     vector<int> uidArray2 = {isolatedUid1, isolatedUid3};
@@ -554,9 +553,6 @@ TEST(PullerUtilTest, MultipleRepeatedFields) {
     const vector<int> secondAdditiveField = {2};
 
     vector<shared_ptr<LogEvent>> data = {
-            // TODO: Once b/224880904 is fixed, can use different additive data without
-            // having the sort order messed up.
-
             // Event 1 {30, 20}->21->{1, 2, 3} (merged with event 4)
             makeRepeatedUidLogEvent(uidAtomTagId, timestamp, uidArray1, hostAdditiveData,
                                     nonAdditiveArray1),
@@ -571,7 +567,6 @@ TEST(PullerUtilTest, MultipleRepeatedFields) {
                                     nonAdditiveArray3),
 
             // Event 4 {30, 20}->21->{1, 2, 3} (merged with event 1)
-            // TODO: once sorting bug is fixed, can change this additive field
             makeRepeatedUidLogEvent(uidAtomTagId, timestamp, uidArray1, hostAdditiveData,
                                     nonAdditiveArray1),
 
@@ -585,58 +580,56 @@ TEST(PullerUtilTest, MultipleRepeatedFields) {
                                     nonAdditiveArray3),
     };
 
-    // Expected event ordering after the sort:
+    // Expected event ordering after the merge (order of first occurrence):
+    // Event 1 {30, 20}->21->{1, 2, 3} (merged with event 4)
+    // Event 2 {30, 3000}->21->{1, 2, 3} (different uid, not merged)
     // Event 3 {30, 20, 40}->21->{1, 2} (total size equal to event 1, merged with event 6)
-    // Event 6 {30, 20, 40}->22->{1, 2} (total size equal to event 1, merged with event 3)
-    // Event 1 {30, 20}->21->{1, 2, 3}
-    // Event 4 {30, 20}->21->{1, 2, 3} (merged with event 1)
     // Event 5 {30, 20}->21->{1, 5, 3} (different repeated field, not merged)
-    // Event 2 {30, 3000}->21->{1, 2, 3} (different uid, not merged)
 
     sp<MockUidMap> uidMap = makeMockUidMap();
     mapAndMergeIsolatedUidsToHostUid(data, uidMap, uidAtomTagId, secondAdditiveField);
 
     ASSERT_EQ(4, (int)data.size());
 
-    // Events 3 and 6 are merged. Not merged with event 1 because different repeated uids and
-    // fields, though length is same.
+    // Events 1 and 4 are merged.
     const vector<FieldValue>* actualFieldValues = &data[0]->getValues();
     ASSERT_EQ(6, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
     EXPECT_EQ(hostUid, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(hostUid, actualFieldValues->at(2).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData + isolatedAdditiveData, actualFieldValues->at(3).mValue.int_value);
-    EXPECT_EQ(1, actualFieldValues->at(4).mValue.int_value);
-    EXPECT_EQ(2, actualFieldValues->at(5).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData + hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(1, actualFieldValues->at(3).mValue.int_value);
+    EXPECT_EQ(2, actualFieldValues->at(4).mValue.int_value);
+    EXPECT_EQ(3, actualFieldValues->at(5).mValue.int_value);
 
-    // Events 1 and 4 are merged.
+    // Event 2 isn't merged - different uid.
     actualFieldValues = &data[1]->getValues();
     ASSERT_EQ(6, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
-    EXPECT_EQ(hostUid, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData + hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(hostUid2, actualFieldValues->at(1).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
     EXPECT_EQ(1, actualFieldValues->at(3).mValue.int_value);
     EXPECT_EQ(2, actualFieldValues->at(4).mValue.int_value);
     EXPECT_EQ(3, actualFieldValues->at(5).mValue.int_value);
 
-    // Event 5 isn't merged - different repeated field.
+    // Events 3 and 6 are merged. Not merged with event 1 because different repeated uids and
+    // fields, though length is same.
     actualFieldValues = &data[2]->getValues();
     ASSERT_EQ(6, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
     EXPECT_EQ(hostUid, actualFieldValues->at(1).mValue.int_value);
-    EXPECT_EQ(hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
-    EXPECT_EQ(1, actualFieldValues->at(3).mValue.int_value);
-    EXPECT_EQ(5, actualFieldValues->at(4).mValue.int_value);
-    EXPECT_EQ(3, actualFieldValues->at(5).mValue.int_value);
+    EXPECT_EQ(hostUid, actualFieldValues->at(2).mValue.int_value);
+    EXPECT_EQ(hostAdditiveData + isolatedAdditiveData, actualFieldValues->at(3).mValue.int_value);
+    EXPECT_EQ(1, actualFieldValues->at(4).mValue.int_value);
+    EXPECT_EQ(2, actualFieldValues->at(5).mValue.int_value);
 
-    // Event 2 isn't merged - different uid.
+    // Event 5 isn't merged - different repeated field.
     actualFieldValues = &data[3]->getValues();
     ASSERT_EQ(6, actualFieldValues->size());
     EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
-    EXPECT_EQ(hostUid2, actualFieldValues->at(1).mValue.int_value);
+    EXPECT_EQ(hostUid, actualFieldValues->at(1).mValue.int_value);
     EXPECT_EQ(hostAdditiveData, actualFieldValues->at(2).mValue.int_value);
     EXPECT_EQ(1, actualFieldValues->at(3).mValue.int_value);
-    EXPECT_EQ(2, actualFieldValues->at(4).mValue.int_value);
+    EXPECT_EQ(5, actualFieldValues->at(4).mValue.int_value);
     EXPECT_EQ(3, actualFieldValues->at(5).mValue.int_value);
 }
 
@@ -453,6 +453,49 @@ TEST(CountMetricProducerTest, TestSplitOnAppUpgradeDisabled) {
     EXPECT_EQ(2, anomalyTracker->getSumOverPastBuckets(DEFAULT_METRIC_DIMENSION_KEY));
 }
 
+TEST(CountMetricProducerTest, TestTrackedMemory) {
+    int64_t bucketStartTimeNs = 10000000000;
+    int64_t bucketSizeNs = TimeUnitToBucketSizeInMillis(ONE_MINUTE) * 1000000LL;
+    int tagId = 1;
+
+    CountMetric metric;
+    metric.set_id(1);
+    metric.set_bucket(ONE_MINUTE);
+
+    sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
+    sp<MockConfigMetadataProvider> provider = new StrictMock<MockConfigMetadataProvider>();
+    EXPECT_CALL(*provider, useTrackedMemoryCalculation()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*provider, useV2SoftMemoryCalculation()).WillRepeatedly(Return(false));
+    CountMetricProducer countProducer(kConfigKey, metric, -1 /*-1 meaning no condition*/, {},
+                                      wizard, protoHash, bucketStartTimeNs, bucketStartTimeNs,
+                                      provider);
+    const size_t emptyBytes = countProducer.getTrackedMemoryBytes();
+
+    LogEvent event1(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event1, bucketStartTimeNs + 1, tagId);
+    countProducer.onMatchedLogEvent(1 /*log matcher index*/, event1);
+    countProducer.flushIfNeededLocked(bucketStartTimeNs + bucketSizeNs + 1);
+    ASSERT_EQ(1UL, countProducer.mPastBuckets.size());
+
+    const size_t oneBucketBytes = countProducer.getTrackedMemoryBytes();
+    EXPECT_GE(oneBucketBytes, emptyBytes + sizeof(CountBucket));
+    EXPECT_EQ(countProducer.computeOverheadSizeLocked(/*hasPastBuckets=*/true,
+                                                      /*dimensionGuardrailHit=*/false) +
+                      oneBucketBytes + countProducer.mUntrackedDataSize,
+              countProducer.byteSize());
+
+    LogEvent event2(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event2, bucketStartTimeNs + bucketSizeNs + 2, tagId);
+    countProducer.onMatchedLogEvent(1 /*log matcher index*/, event2);
+    countProducer.flushIfNeededLocked(bucketStartTimeNs + 2 * bucketSizeNs + 1);
+    ASSERT_EQ(2UL, countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
+    EXPECT_GE(countProducer.getTrackedMemoryBytes(), oneBucketBytes + sizeof(CountBucket));
+
+    countProducer.clearPastBuckets(bucketStartTimeNs + 2 * bucketSizeNs + 2);
+    EXPECT_EQ(0UL, countProducer.mUntrackedDataSize);
+    EXPECT_LT(countProducer.getTrackedMemoryBytes(), oneBucketBytes);
+}
+
 TEST(CountMetricProducerTest, TestAnomalyDetectionUnSliced) {
     sp<AlarmMonitor> alarmMonitor;
     Alert alert;
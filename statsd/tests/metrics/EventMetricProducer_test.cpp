@@ -90,7 +90,7 @@ TEST_F(EventMetricProducerTest, TestNoCondition) {
 
     // Check dump report content.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     eventProducer.onDumpReport(bucketStartTimeNs + 20, true /*include current partial bucket*/,
                                true /*erase data*/, FAST, &strSet, &output);
 
@@ -133,7 +133,7 @@ TEST_F(EventMetricProducerTest, TestEventsWithNonSlicedCondition) {
 
     // Check dump report content.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     eventProducer.onDumpReport(bucketStartTimeNs + 20, true /*include current partial bucket*/,
                                true /*erase data*/, FAST, &strSet, &output);
 
@@ -187,7 +187,7 @@ TEST_F(EventMetricProducerTest, TestEventsWithSlicedCondition) {
 
     // Check dump report content.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     eventProducer.onDumpReport(bucketStartTimeNs + 20, true /*include current partial bucket*/,
                                true /*erase data*/, FAST, &strSet, &output);
 
@@ -227,7 +227,7 @@ TEST_F(EventMetricProducerTest, TestOneAtomTagAggregatedEvents) {
 
     // Check dump report content.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     eventProducer.onDumpReport(bucketStartTimeNs + 50, true /*include current partial bucket*/,
                                true /*erase data*/, FAST, &strSet, &output);
 
@@ -249,6 +249,63 @@ TEST_F(EventMetricProducerTest, TestOneAtomTagAggregatedEvents) {
     }
 }
 
+TEST_F(EventMetricProducerTest, TestAggregatedEventsAfterErase) {
+    int64_t bucketStartTimeNs = 10000000000;
+    int tagId = 1;
+
+    EventMetric metric;
+    metric.set_id(1);
+
+    sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
+    sp<MockConfigMetadataProvider> provider = makeMockConfigMetadataProvider(/*enabled=*/false);
+    EventMetricProducer eventProducer(kConfigKey, metric, -1 /*-1 meaning no condition*/, {},
+                                      wizard, protoHash, bucketStartTimeNs, provider);
+
+    LogEvent event1(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event1, tagId, bucketStartTimeNs + 10, "111");
+    LogEvent event2(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event2, tagId, bucketStartTimeNs + 20, "111");
+    eventProducer.onMatchedLogEvent(1 /*matcher index*/, event1);
+    eventProducer.onMatchedLogEvent(1 /*matcher index*/, event2);
+
+    ProtoOutputStream output;
+    StringDictionary strSet;
+    eventProducer.onDumpReport(bucketStartTimeNs + 30, true /*include current partial bucket*/,
+                               true /*erase data*/, FAST, &strSet, &output);
+    StatsLogReport report = outputStreamToProto(&output);
+    ASSERT_EQ(1, report.event_metrics().data_size());
+    EXPECT_EQ(2,
+              report.event_metrics().data(0).aggregated_atom_info().elapsed_timestamp_nanos_size());
+
+    // The same atom after the data was erased gets a new entry.
+    LogEvent event3(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event3, tagId, bucketStartTimeNs + 40, "111");
+    LogEvent event4(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event4, tagId, bucketStartTimeNs + 50, "222");
+    LogEvent event5(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event5, tagId, bucketStartTimeNs + 60, "222");
+    eventProducer.onMatchedLogEvent(1 /*matcher index*/, event3);
+    eventProducer.onMatchedLogEvent(1 /*matcher index*/, event4);
+    eventProducer.onMatchedLogEvent(1 /*matcher index*/, event5);
+
+    ProtoOutputStream output2;
+    eventProducer.onDumpReport(bucketStartTimeNs + 70, true /*include current partial bucket*/,
+                               true /*erase data*/, FAST, &strSet, &output2);
+    report = outputStreamToProto(&output2);
+    ASSERT_EQ(2, report.event_metrics().data_size());
+    for (const EventMetricData& metricData : report.event_metrics().data()) {
+        const AggregatedAtomInfo& atomInfo = metricData.aggregated_atom_info();
+        if (atomInfo.elapsed_timestamp_nanos_size() == 1) {
+            EXPECT_EQ(bucketStartTimeNs + 40, atomInfo.elapsed_timestamp_nanos(0));
+        } else if (atomInfo.elapsed_timestamp_nanos_size() == 2) {
+            EXPECT_EQ(bucketStartTimeNs + 50, atomInfo.elapsed_timestamp_nanos(0));
+            EXPECT_EQ(bucketStartTimeNs + 60, atomInfo.elapsed_timestamp_nanos(1));
+        } else {
+            FAIL();
+        }
+    }
+}
+
 TEST_F(EventMetricProducerTest, TestBytesFieldAggregatedEvents) {
     int64_t bucketStartTimeNs = 10000000000;
     int tagId = 1;
@@ -280,7 +337,7 @@ TEST_F(EventMetricProducerTest, TestBytesFieldAggregatedEvents) {
 
     // Check dump report content.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     eventProducer.onDumpReport(bucketStartTimeNs + 50, true /*include current partial bucket*/,
                                true /*erase data*/, FAST, &strSet, &output);
 
@@ -329,7 +386,7 @@ TEST_F(EventMetricProducerTest, TestTwoAtomTagAggregatedEvents) {
 
     // Check dump report content.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     eventProducer.onDumpReport(bucketStartTimeNs + 50, true /*include current partial bucket*/,
                                true /*erase data*/, FAST, &strSet, &output);
 
@@ -408,7 +465,7 @@ TEST_F(EventMetricProducerTest, TestCorruptedDataReason_OnDumpReport) {
     {
         // Check dump report content.
         ProtoOutputStream output;
-        std::set<string> strSet;
+        StringDictionary strSet;
         eventProducer.onDumpReport(bucketStartTimeNs + 150, true /*include current partial bucket*/,
                                    true /*erase data*/, FAST, &strSet, &output);
 
@@ -440,7 +497,7 @@ TEST_F(EventMetricProducerTest, TestCorruptedDataReason_OnDumpReport) {
     {
         // Check dump report content.
         ProtoOutputStream output;
-        std::set<string> strSet;
+        StringDictionary strSet;
         eventProducer.onDumpReport(bucketStartTimeNs + 250, true /*include current partial bucket*/,
                                    true /*erase data*/, FAST, &strSet, &output);
 
@@ -555,6 +612,40 @@ TEST_F(EventMetricProducerTest, TestCorruptedDataReason_OnDropData) {
               MetricProducer::DataCorruptionSeverity::kUnrecoverable);
 }
 
+TEST_F(EventMetricProducerTest, TestTrackedMemory) {
+    int64_t bucketStartTimeNs = 10000000000;
+    int tagId = 1;
+
+    EventMetric metric;
+    metric.set_id(1);
+
+    sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
+    sp<MockConfigMetadataProvider> provider = new StrictMock<MockConfigMetadataProvider>();
+    EXPECT_CALL(*provider, useTrackedMemoryCalculation()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*provider, useV2SoftMemoryCalculation()).WillRepeatedly(Return(false));
+    EventMetricProducer eventProducer(kConfigKey, metric, -1 /*-1 meaning no condition*/, {},
+                                      wizard, protoHash, bucketStartTimeNs, provider);
+    const size_t emptyBytes = eventProducer.getTrackedMemoryBytes();
+
+    LogEvent event1(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event1, tagId, bucketStartTimeNs + 10, "111");
+    LogEvent event2(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event2, tagId, bucketStartTimeNs + 20, "111");
+    eventProducer.onMatchedLogEvent(1 /*matcher index*/, event1);
+    eventProducer.onMatchedLogEvent(1 /*matcher index*/, event2);
+    ASSERT_EQ(1UL, eventProducer.mAggregatedAtoms.size());
+
+    EXPECT_GE(eventProducer.getTrackedMemoryBytes(), emptyBytes + 2 * sizeof(int64_t));
+    EXPECT_EQ(getFieldValuesSizeV2(event1.getValues()), eventProducer.mUntrackedDataSize);
+    EXPECT_EQ(eventProducer.computeOverheadSizeLocked(/*hasPastBuckets=*/false,
+                                                      /*dimensionGuardrailHit=*/false) +
+                      eventProducer.getTrackedMemoryBytes() + eventProducer.mUntrackedDataSize,
+              eventProducer.byteSize());
+
+    eventProducer.clearPastBuckets(bucketStartTimeNs + 30);
+    EXPECT_EQ(0UL, eventProducer.mUntrackedDataSize);
+}
+
 TEST_F(EventMetricProducerTest, TestCorruptedDataReason_OnClearPastBuckets) {
     int64_t bucketStartTimeNs = 10000000000;
     int tagId = 1;
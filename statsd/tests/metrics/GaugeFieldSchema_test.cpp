@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "src/metrics/GaugeFieldSchema.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#ifdef __ANDROID__
+
+using namespace std;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+namespace {
+
+const int32_t kTagId = 10;
+
+vector<FieldValue> makeAtom(int32_t intValue, const string& strValue) {
+    return {FieldValue(Field(kTagId, getSimpleField(1)), Value(intValue)),
+            FieldValue(Field(kTagId, getSimpleField(2)), Value(strValue))};
+}
+
+}  // anonymous namespace
+
+TEST(GaugeFieldSchemaTest, TestRoundTripsAllTypes) {
+    const vector<FieldValue> values = {
+            FieldValue(Field(kTagId, getSimpleField(1)), Value((int32_t)-7)),
+            FieldValue(Field(kTagId, getSimpleField(2)), Value((int64_t)1LL << 40)),
+            FieldValue(Field(kTagId, getSimpleField(3)), Value(1.5f)),
+            FieldValue(Field(kTagId, getSimpleField(4)), Value(-2.25)),
+            FieldValue(Field(kTagId, getSimpleField(5)), Value(string("wakelock"))),
+            FieldValue(Field(kTagId, getSimpleField(6)), Value(vector<uint8_t>{1, 0, 255}))};
+
+    GaugeFieldSchema schema;
+    const PackedGaugeAtom atom = schema.pack(values);
+    ASSERT_EQ(values.size(), atom.mWords.size());
+    EXPECT_EQ(values, schema.unpack(atom));
+    EXPECT_EQ(1UL, schema.getNumLayouts());
+    EXPECT_EQ(2UL, schema.getNumStrings());
+}
+
+TEST(GaugeFieldSchemaTest, TestSharesLayoutsAndStrings) {
+    GaugeFieldSchema schema;
+    const PackedGaugeAtom atom1 = schema.pack(makeAtom(1, "a"));
+    const PackedGaugeAtom atom2 = schema.pack(makeAtom(2, "a"));
+    const PackedGaugeAtom atom3 = schema.pack(makeAtom(1, "b"));
+    const PackedGaugeAtom atom4 = schema.pack(makeAtom(1, "a"));
+
+    EXPECT_EQ(1UL, schema.getNumLayouts());
+    EXPECT_EQ(2UL, schema.getNumStrings());
+    EXPECT_EQ(atom1, atom4);
+    EXPECT_EQ(std::hash<PackedGaugeAtom>()(atom1), std::hash<PackedGaugeAtom>()(atom4));
+    EXPECT_FALSE(atom1 == atom2);
+    EXPECT_FALSE(atom1 == atom3);
+
+    EXPECT_EQ(makeAtom(2, "a"), schema.unpack(atom2));
+    EXPECT_EQ(makeAtom(1, "b"), schema.unpack(atom3));
+}
+
+TEST(GaugeFieldSchemaTest, TestDistinctLayouts) {
+    GaugeFieldSchema schema;
+    // Same values, but the second field is a different type.
+    const vector<FieldValue> values1 = {
+            FieldValue(Field(kTagId, getSimpleField(1)), Value((int32_t)1)),
+            FieldValue(Field(kTagId, getSimpleField(2)), Value((int32_t)2))};
+    const vector<FieldValue> values2 = {
+            FieldValue(Field(kTagId, getSimpleField(1)), Value((int32_t)1)),
+            FieldValue(Field(kTagId, getSimpleField(2)), Value((int64_t)2))};
+    // One field less.
+    const vector<FieldValue> values3 = {
+            FieldValue(Field(kTagId, getSimpleField(1)), Value((int32_t)1))};
+
+    const PackedGaugeAtom atom1 = schema.pack(values1);
+    const PackedGaugeAtom atom2 = schema.pack(values2);
+    const PackedGaugeAtom atom3 = schema.pack(values3);
+
+    EXPECT_EQ(3UL, schema.getNumLayouts());
+    EXPECT_FALSE(atom1 == atom2);
+    EXPECT_EQ(values1, schema.unpack(atom1));
+    EXPECT_EQ(values2, schema.unpack(atom2));
+    EXPECT_EQ(values3, schema.unpack(atom3));
+}
+
+TEST(GaugeFieldSchemaTest, TestUnpackReusesValues) {
+    GaugeFieldSchema schema;
+    const PackedGaugeAtom atom1 = schema.pack(makeAtom(1, "first string"));
+    const PackedGaugeAtom atom2 = schema.pack(makeAtom(2, "second"));
+
+    vector<FieldValue> values;
+    schema.unpack(atom1, &values);
+    EXPECT_EQ(makeAtom(1, "first string"), values);
+    schema.unpack(atom2, &values);
+    EXPECT_EQ(makeAtom(2, "second"), values);
+}
+
+TEST(GaugeFieldSchemaTest, TestClear) {
+    GaugeFieldSchema schema;
+    schema.pack(makeAtom(1, "a"));
+    EXPECT_GT(schema.getByteSize(), 0UL);
+
+    schema.clear();
+    EXPECT_EQ(0UL, schema.getNumLayouts());
+    EXPECT_EQ(0UL, schema.getNumStrings());
+    EXPECT_EQ(0UL, schema.getByteSize());
+
+    const PackedGaugeAtom atom = schema.pack(makeAtom(3, "b"));
+    EXPECT_EQ(0, atom.mLayoutIndex);
+    EXPECT_EQ(makeAtom(3, "b"), schema.unpack(atom));
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
@@ -161,11 +161,11 @@ TEST(GaugeMetricProducerTest, TestPulledEventsNoCondition) {
     it++;
     EXPECT_EQ(11, it->mValue.int_value);
     ASSERT_EQ(1UL, gaugeProducer.mPastBuckets.size());
-    EXPECT_EQ(3, gaugeProducer.mPastBuckets.begin()
-                         ->second.back()
-                         .mAggregatedAtoms.begin()
-                         ->first.getAtomFieldValues()
-                         .getValues()
+    EXPECT_EQ(3, gaugeProducer.mGaugeFieldSchema
+                         .unpack(gaugeProducer.mPastBuckets.begin()
+                                         ->second.back()
+                                         .mAggregatedAtoms.begin()
+                                         ->first)
                          .begin()
                          ->mValue.int_value);
 
@@ -182,12 +182,9 @@ TEST(GaugeMetricProducerTest, TestPulledEventsNoCondition) {
     // One dimension.
     ASSERT_EQ(1UL, gaugeProducer.mPastBuckets.size());
     ASSERT_EQ(2UL, gaugeProducer.mPastBuckets.begin()->second.size());
-    auto it2 = gaugeProducer.mPastBuckets.begin()
-                       ->second.back()
-                       .mAggregatedAtoms.begin()
-                       ->first.getAtomFieldValues()
-                       .getValues()
-                       .begin();
+    vector<FieldValue> atomValues = gaugeProducer.mGaugeFieldSchema.unpack(
+            gaugeProducer.mPastBuckets.begin()->second.back().mAggregatedAtoms.begin()->first);
+    auto it2 = atomValues.begin();
     EXPECT_EQ(INT, it2->mValue.getType());
     EXPECT_EQ(10L, it2->mValue.int_value);
     it2++;
@@ -199,12 +196,9 @@ TEST(GaugeMetricProducerTest, TestPulledEventsNoCondition) {
     // One dimension.
     ASSERT_EQ(1UL, gaugeProducer.mPastBuckets.size());
     ASSERT_EQ(3UL, gaugeProducer.mPastBuckets.begin()->second.size());
-    it2 = gaugeProducer.mPastBuckets.begin()
-                  ->second.back()
-                  .mAggregatedAtoms.begin()
-                  ->first.getAtomFieldValues()
-                  .getValues()
-                  .begin();
+    atomValues = gaugeProducer.mGaugeFieldSchema.unpack(
+            gaugeProducer.mPastBuckets.begin()->second.back().mAggregatedAtoms.begin()->first);
+    it2 = atomValues.begin();
     EXPECT_EQ(INT, it2->mValue.getType());
     EXPECT_EQ(24L, it2->mValue.int_value);
     it2++;
@@ -427,6 +421,86 @@ TEST(GaugeMetricProducerTest, TestPulledWithAppUpgradeDisabled) {
                          ->mValue.int_value);
 }
 
+TEST(GaugeMetricProducerTest, TestCurrentBucketArenaReleasedOnFlush) {
+    GaugeMetric metric;
+    metric.set_id(metricId);
+    metric.set_bucket(ONE_MINUTE);
+    metric.mutable_gauge_fields_filter()->set_include_all(true);
+    metric.set_sampling_type(GaugeMetric::FIRST_N_SAMPLES);
+    metric.set_max_num_gauge_atoms_per_bucket(100);
+    sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
+    sp<MockStatsPullerManager> pullerManager = new StrictMock<MockStatsPullerManager>();
+    sp<EventMatcherWizard> eventMatcherWizard =
+            createEventMatcherWizard(tagId, logEventMatcherIndex);
+    sp<MockConfigMetadataProvider> provider = makeMockConfigMetadataProvider(/*enabled=*/false);
+
+    GaugeMetricProducer gaugeProducer(kConfigKey, metric, -1 /*-1 meaning no condition*/, {},
+                                      wizard, protoHash, logEventMatcherIndex, eventMatcherWizard,
+                                      -1 /* -1 means no pulling */, -1, tagId, bucketStartTimeNs,
+                                      bucketStartTimeNs, pullerManager, provider);
+    gaugeProducer.prepareFirstBucket();
+    EXPECT_EQ(0UL, gaugeProducer.getTrackedMemoryBytes());
+
+    for (int i = 0; i < 10; i++) {
+        LogEvent event(/*uid=*/0, /*pid=*/0);
+        CreateTwoValueLogEvent(&event, tagId, bucketStartTimeNs + 10 + i, i, 10);
+        gaugeProducer.onMatchedLogEvent(1 /*log matcher index*/, event);
+    }
+    ASSERT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
+    ASSERT_EQ(10UL, gaugeProducer.mCurrentSlicedBucket->begin()->second.size());
+    EXPECT_GT(gaugeProducer.getTrackedMemoryBytes(), 10 * sizeof(GaugeAtom));
+
+    // The bucket is moved to the past buckets and the arena is released.
+    gaugeProducer.flushIfNeededLocked(bucket2StartTimeNs + 1);
+    EXPECT_EQ(0UL, gaugeProducer.mCurrentSlicedBucket->size());
+    EXPECT_EQ(0UL, gaugeProducer.getTrackedMemoryBytes());
+    ASSERT_EQ(1UL, gaugeProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
+    EXPECT_EQ(10UL, gaugeProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY][0]
+                            .mAggregatedAtoms.size());
+
+    // The next bucket allocates from the arena again.
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    CreateTwoValueLogEvent(&event, tagId, bucket2StartTimeNs + 10, 1, 10);
+    gaugeProducer.onMatchedLogEvent(1 /*log matcher index*/, event);
+    ASSERT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
+    EXPECT_GT(gaugeProducer.getTrackedMemoryBytes(), 0UL);
+}
+
+TEST(GaugeMetricProducerTest, TestTrackedMemoryUsesV2Estimate) {
+    GaugeMetric metric;
+    metric.set_id(metricId);
+    metric.set_bucket(ONE_MINUTE);
+    metric.mutable_gauge_fields_filter()->set_include_all(true);
+    metric.set_sampling_type(GaugeMetric::FIRST_N_SAMPLES);
+    sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
+    sp<MockStatsPullerManager> pullerManager = new StrictMock<MockStatsPullerManager>();
+    sp<EventMatcherWizard> eventMatcherWizard =
+            createEventMatcherWizard(tagId, logEventMatcherIndex);
+    sp<MockConfigMetadataProvider> provider = new StrictMock<MockConfigMetadataProvider>();
+    EXPECT_CALL(*provider, useTrackedMemoryCalculation()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*provider, useV2SoftMemoryCalculation()).WillRepeatedly(Return(false));
+
+    GaugeMetricProducer gaugeProducer(kConfigKey, metric, -1 /*-1 meaning no condition*/, {},
+                                      wizard, protoHash, logEventMatcherIndex, eventMatcherWizard,
+                                      -1 /* -1 means no pulling */, -1, tagId, bucketStartTimeNs,
+                                      bucketStartTimeNs, pullerManager, provider);
+    gaugeProducer.prepareFirstBucket();
+
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    CreateTwoValueLogEvent(&event, tagId, bucketStartTimeNs + 10, 1, 10);
+    gaugeProducer.onMatchedLogEvent(1 /*log matcher index*/, event);
+    gaugeProducer.flushIfNeededLocked(bucket2StartTimeNs + 1);
+    ASSERT_EQ(1UL, gaugeProducer.mPastBuckets.size());
+
+    // The past buckets are not allocated from the tracking memory resource, so the gauge metric
+    // uses the V2 estimate rather than the V1 one.
+    EXPECT_GT(gaugeProducer.mTotalDataSize, 0UL);
+    EXPECT_EQ(gaugeProducer.computeOverheadSizeLocked(/*hasPastBuckets=*/true,
+                                                      gaugeProducer.mDimensionGuardrailHit) +
+                      gaugeProducer.mTotalDataSize,
+              gaugeProducer.byteSizeLocked());
+}
+
 TEST(GaugeMetricProducerTest, TestPulledEventsWithCondition) {
     GaugeMetric metric;
     metric.set_id(metricId);
@@ -483,11 +557,11 @@ TEST(GaugeMetricProducerTest, TestPulledEventsWithCondition) {
                            ->mValue.int_value);
     ASSERT_EQ(1UL, gaugeProducer.mPastBuckets.size());
 
-    EXPECT_EQ(100, gaugeProducer.mPastBuckets.begin()
-                           ->second.back()
-                           .mAggregatedAtoms.begin()
-                           ->first.getAtomFieldValues()
-                           .getValues()
+    EXPECT_EQ(100, gaugeProducer.mGaugeFieldSchema
+                           .unpack(gaugeProducer.mPastBuckets.begin()
+                                           ->second.back()
+                                           .mAggregatedAtoms.begin()
+                                           ->first)
                            .begin()
                            ->mValue.int_value);
 
@@ -495,11 +569,11 @@ TEST(GaugeMetricProducerTest, TestPulledEventsWithCondition) {
     gaugeProducer.flushIfNeededLocked(bucket3StartTimeNs + 10);
     ASSERT_EQ(1UL, gaugeProducer.mPastBuckets.size());
     ASSERT_EQ(2UL, gaugeProducer.mPastBuckets.begin()->second.size());
-    EXPECT_EQ(110L, gaugeProducer.mPastBuckets.begin()
-                            ->second.back()
-                            .mAggregatedAtoms.begin()
-                            ->first.getAtomFieldValues()
-                            .getValues()
+    EXPECT_EQ(110L, gaugeProducer.mGaugeFieldSchema
+                            .unpack(gaugeProducer.mPastBuckets.begin()
+                                            ->second.back()
+                                            .mAggregatedAtoms.begin()
+                                            ->first)
                             .begin()
                             ->mValue.int_value);
 }
@@ -718,9 +792,11 @@ TEST(GaugeMetricProducerTest, TestPullOnTrigger) {
     ASSERT_EQ(2UL, gaugeProducer.mPastBuckets.begin()->second.back().mAggregatedAtoms.size());
     auto it = gaugeProducer.mPastBuckets.begin()->second.back().mAggregatedAtoms.begin();
     vector<int> atomValues;
-    atomValues.emplace_back(it->first.getAtomFieldValues().getValues().begin()->mValue.int_value);
+    atomValues.emplace_back(
+            gaugeProducer.mGaugeFieldSchema.unpack(it->first).begin()->mValue.int_value);
     it++;
-    atomValues.emplace_back(it->first.getAtomFieldValues().getValues().begin()->mValue.int_value);
+    atomValues.emplace_back(
+            gaugeProducer.mGaugeFieldSchema.unpack(it->first).begin()->mValue.int_value);
     EXPECT_THAT(atomValues, UnorderedElementsAre(4, 5));
 }
 
@@ -776,11 +852,14 @@ TEST(GaugeMetricProducerTest, TestPullNWithoutTrigger) {
     ASSERT_EQ(3UL, gaugeProducer.mPastBuckets.begin()->second.back().mAggregatedAtoms.size());
     auto it = gaugeProducer.mPastBuckets.begin()->second.back().mAggregatedAtoms.begin();
     vector<int> atomValues;
-    atomValues.emplace_back(it->first.getAtomFieldValues().getValues().begin()->mValue.int_value);
+    atomValues.emplace_back(
+            gaugeProducer.mGaugeFieldSchema.unpack(it->first).begin()->mValue.int_value);
     it++;
-    atomValues.emplace_back(it->first.getAtomFieldValues().getValues().begin()->mValue.int_value);
+    atomValues.emplace_back(
+            gaugeProducer.mGaugeFieldSchema.unpack(it->first).begin()->mValue.int_value);
     it++;
-    atomValues.emplace_back(it->first.getAtomFieldValues().getValues().begin()->mValue.int_value);
+    atomValues.emplace_back(
+            gaugeProducer.mGaugeFieldSchema.unpack(it->first).begin()->mValue.int_value);
     EXPECT_THAT(atomValues, UnorderedElementsAre(4, 5, 6));
 }
 
@@ -853,10 +932,8 @@ TEST(GaugeMetricProducerTest, TestRemoveDimensionInOutput) {
     auto bucketIt = gaugeProducer.mPastBuckets.begin();
     ASSERT_EQ(1UL, bucketIt->second.back().mAggregatedAtoms.size());
     EXPECT_EQ(3, bucketIt->first.getDimensionKeyInWhat().getValues().begin()->mValue.int_value);
-    EXPECT_EQ(4, bucketIt->second.back()
-                         .mAggregatedAtoms.begin()
-                         ->first.getAtomFieldValues()
-                         .getValues()
+    EXPECT_EQ(4, gaugeProducer.mGaugeFieldSchema
+                         .unpack(bucketIt->second.back().mAggregatedAtoms.begin()->first)
                          .begin()
                          ->mValue.int_value);
     bucketIt++;
@@ -865,10 +942,10 @@ TEST(GaugeMetricProducerTest, TestRemoveDimensionInOutput) {
     auto atomIt = bucketIt->second.back().mAggregatedAtoms.begin();
     vector<int> atomValues;
     atomValues.emplace_back(
-            atomIt->first.getAtomFieldValues().getValues().begin()->mValue.int_value);
+            gaugeProducer.mGaugeFieldSchema.unpack(atomIt->first).begin()->mValue.int_value);
     atomIt++;
     atomValues.emplace_back(
-            atomIt->first.getAtomFieldValues().getValues().begin()->mValue.int_value);
+            gaugeProducer.mGaugeFieldSchema.unpack(atomIt->first).begin()->mValue.int_value);
     EXPECT_THAT(atomValues, UnorderedElementsAre(5, 6));
 }
 
@@ -913,7 +990,7 @@ TEST(GaugeMetricProducerTest_BucketDrop, TestBucketDropWhenBucketTooSmall) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     gaugeProducer.onDumpReport(bucketStartTimeNs + 9000000, true /* include recent buckets */, true,
                                FAST /* dump_latency */, &strSet, &output);
 
@@ -994,7 +1071,7 @@ TEST(GaugeMetricProducerTest, TestPullDimensionalSampling) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 10000000000;
     gaugeProducer.onDumpReport(dumpReportTimeNs, true /* include current buckets */, true,
                                NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -313,7 +313,7 @@ TEST(KllMetricProducerTest_BucketDrop, TestInvalidBucketWhenConditionUnknown) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 10000;
     kllProducer->onDumpReport(dumpReportTimeNs, true /* include recent buckets */, true,
                               NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -351,7 +351,7 @@ TEST(KllMetricProducerTest_BucketDrop, TestBucketDropWhenBucketTooSmall) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 9000000;
     kllProducer->onDumpReport(dumpReportTimeNs, true /* include recent buckets */, true,
                               NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -383,7 +383,7 @@ TEST(KllMetricProducerTest_BucketDrop, TestBucketDropWhenDataUnavailable) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 10000000000;  // 10 seconds
     kllProducer->onDumpReport(dumpReportTimeNs, true /* include current bucket */, true,
                               NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -419,7 +419,7 @@ TEST(KllMetricProducerTest, TestForcedBucketSplitWhenConditionUnknownSkipsBucket
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 10000000000;  // 10 seconds
     kllProducer->onDumpReport(dumpReportTimeNs, false /* include current buckets */, true,
                               NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -2193,7 +2193,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestInvalidBucketWhenOneConditio
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket2StartTimeNs + 10, false /* include partial bucket */, true,
                                 FAST /* dumpLatency */, &strSet, &output);
 
@@ -2255,7 +2255,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestInvalidBucketWhenGuardRailHi
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket2StartTimeNs + 10000, false /* include recent buckets */,
                                 true, FAST /* dumpLatency */, &strSet, &output);
     ASSERT_EQ(true, StatsdStats::getInstance().hasHitDimensionGuardrail(metricId));
@@ -2333,7 +2333,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestInvalidBucketWhenInitialPull
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket2StartTimeNs + 10000, false /* include recent buckets */,
                                 true, FAST /* dumpLatency */, &strSet, &output);
 
@@ -2409,7 +2409,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestInvalidBucketWhenLastPullFai
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket2StartTimeNs + 10000, false /* include recent buckets */,
                                 true, FAST /* dumpLatency */, &strSet, &output);
 
@@ -2996,7 +2996,7 @@ TEST(NumericValueMetricProducerTest, TestFastDumpWithoutCurrentBucket) {
     valueProducer->onDataPulled(allData, PullResult::PULL_RESULT_SUCCESS, bucket2StartTimeNs);
 
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket4StartTimeNs, false /* include recent buckets */, true, FAST,
                                 &strSet, &output);
 
@@ -3037,7 +3037,7 @@ TEST(NumericValueMetricProducerTest, TestPullNeededNoTimeConstraints) {
                                                                                   metric);
 
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucketStartTimeNs + 10, true /* include recent buckets */, true,
                                 NO_TIME_CONSTRAINTS, &strSet, &output);
 
@@ -3237,7 +3237,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestInvalidBucketWhenDumpReportR
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucketStartTimeNs + 40, true /* include recent buckets */, true,
                                 FAST /* dumpLatency */, &strSet, &output);
     ASSERT_EQ(0UL, valueProducer->mCurrentSlicedBucket.size());
@@ -3293,7 +3293,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestInvalidBucketWhenConditionEv
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket2StartTimeNs + 100, true /* include recent buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
 
@@ -3359,7 +3359,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestInvalidBucketWhenAccumulateE
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket2StartTimeNs + 100, true /* include recent buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
 
@@ -3414,7 +3414,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestInvalidBucketWhenConditionUn
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 10000;
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include recent buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -3464,7 +3464,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestInvalidBucketWhenPullFailed)
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 10000;
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include recent buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -3528,7 +3528,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestInvalidBucketWhenMultipleBuc
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(dumpTimeNs, true /* include current buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
 
@@ -3598,7 +3598,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestBucketDropWhenBucketTooSmall
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 9000000;
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include recent buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -3633,7 +3633,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestBucketDropWhenDataUnavailabl
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 10000000000;  // 10 seconds
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include current bucket */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -3701,7 +3701,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestConditionUnknownMultipleBuck
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucket2StartTimeNs + 15 * NS_PER_SEC;  // 15 seconds
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include current bucket */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -3783,7 +3783,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop,
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucket2StartTimeNs + 10000000000;  // 10 seconds
     valueProducer->onDumpReport(dumpReportTimeNs, false /* include current buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -3834,7 +3834,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestMultipleBucketDropEvents) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 1000;
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include recent buckets */, true,
                                 FAST /* dumpLatency */, &strSet, &output);
@@ -3917,7 +3917,7 @@ TEST(NumericValueMetricProducerTest_BucketDrop, TestMaxBucketDropEvents) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 1000;
     // Because we already have 10 dump events in the current bucket,
     // this case should not be added to the list of dump events.
@@ -4186,7 +4186,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedState) {
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucketStartTimeNs + 50 * NS_PER_SEC,
                                 true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                 &strSet, &output);
@@ -4480,7 +4480,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedStateWithMap) {
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucketStartTimeNs + 50 * NS_PER_SEC,
                                 true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                 &strSet, &output);
@@ -4727,7 +4727,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedStateWithPrimaryField_WithDimensi
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucket2StartTimeNs + 50 * NS_PER_SEC;
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include recent buckets */, true,
                                 NO_TIME_CONSTRAINTS, &strSet, &output);
@@ -4981,7 +4981,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedStateWithMissingDataInStateChange
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucketStartTimeNs + 50 * NS_PER_SEC,
                                 true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                 &strSet, &output);
@@ -5086,7 +5086,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedStateWithMissingDataThenFlushBuck
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucketStartTimeNs + 50 * NS_PER_SEC,
                                 true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                 &strSet, &output);
@@ -5279,7 +5279,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedStateWithNoPullOnBucketBoundary)
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket2StartTimeNs + 50 * NS_PER_SEC,
                                 true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                 &strSet, &output);
@@ -5497,7 +5497,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedStateWithDataMissingInConditionCh
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucketStartTimeNs + 50 * NS_PER_SEC,
                                 true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                 &strSet, &output);
@@ -5743,7 +5743,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedStateWithMultipleDimensions) {
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket2StartTimeNs + 50 * NS_PER_SEC,
                                 true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                 &strSet, &output);
@@ -5979,7 +5979,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedStateWithCondition) {
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket2StartTimeNs + 50 * NS_PER_SEC,
                                 true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                 &strSet, &output);
@@ -6127,7 +6127,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedStateWithConditionFalseMultipleBu
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket3StartTimeNs + 30 * NS_PER_SEC,
                                 true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                 &strSet, &output);
@@ -6327,7 +6327,7 @@ TEST(NumericValueMetricProducerTest, TestSlicedStateWithMultipleDimensionsMissin
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket2StartTimeNs + 50 * NS_PER_SEC,
                                 true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                 &strSet, &output);
@@ -6436,7 +6436,7 @@ TEST(NumericValueMetricProducerTest, TestForcedBucketSplitWhenConditionUnknownSk
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 10000000000;  // 10 seconds
     valueProducer->onDumpReport(dumpReportTimeNs, false /* include current buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -6502,7 +6502,7 @@ TEST(NumericValueMetricProducerTest, TestUploadThreshold) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucket2StartTimeNs + 10000000000;
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include current buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -6984,7 +6984,7 @@ TEST(NumericValueMetricProducerTest_ConditionCorrection, TestThresholdNotDefined
 
     // generate dump report and validate correction value in the reported buckets
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket3StartTimeNs, false /* include partial bucket */, true,
                                 FAST /* dumpLatency */, &strSet, &output);
 
@@ -7040,7 +7040,7 @@ TEST(NumericValueMetricProducerTest_ConditionCorrection, TestThresholdDefinedZer
 
     // generate dump report and validate correction value in the reported buckets
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket3StartTimeNs, false /* include partial bucket */, true,
                                 FAST /* dumpLatency */, &strSet, &output);
 
@@ -7109,7 +7109,7 @@ TEST(NumericValueMetricProducerTest_ConditionCorrection, TestThresholdUploadPass
 
     // generate dump report and validate correction value in the reported buckets
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket3StartTimeNs, false /* include partial bucket */, true,
                                 FAST /* dumpLatency */, &strSet, &output);
 
@@ -7169,7 +7169,7 @@ TEST(NumericValueMetricProducerTest_ConditionCorrection, TestThresholdUploadPass
 
     // generate dump report and validate correction value in the reported buckets
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket3StartTimeNs, false /* include partial bucket */, true,
                                 FAST /* dumpLatency */, &strSet, &output);
 
@@ -7227,7 +7227,7 @@ TEST(NumericValueMetricProducerTest_ConditionCorrection, TestThresholdUploadSkip
 
     // generate dump report and validate correction value in the reported buckets
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket3StartTimeNs, false /* include partial bucket */, true,
                                 FAST /* dumpLatency */, &strSet, &output);
 
@@ -7322,7 +7322,7 @@ TEST(NumericValueMetricProducerTest_ConditionCorrection, TestLateStateChangeSlic
 
     // Start dump report and check output.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     valueProducer->onDumpReport(bucket4StartTimeNs + 10, false /* do not include partial buckets */,
                                 true, NO_TIME_CONSTRAINTS, &strSet, &output);
 
@@ -7408,7 +7408,7 @@ TEST(NumericValueMetricProducerTest, TestSubsetDimensions) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucket2StartTimeNs + 10000000000;
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include current buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -7485,7 +7485,7 @@ TEST(NumericValueMetricProducerTest, TestRepeatedValueFieldAndDimensions) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucket2StartTimeNs + 10000000000;
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include current buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -7576,7 +7576,7 @@ TEST(NumericValueMetricProducerTest, TestSampleSize) {
 
     // Start dump report and check output.
     ProtoOutputStream outputAvg;
-    std::set<string> strSetAvg;
+    StringDictionary strSetAvg;
     valueProducerAvg->onDumpReport(bucket2StartTimeNs + 50 * NS_PER_SEC,
                                    true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                    &strSetAvg, &outputAvg);
@@ -7592,7 +7592,7 @@ TEST(NumericValueMetricProducerTest, TestSampleSize) {
 
     // Start dump report and check output.
     ProtoOutputStream outputSum;
-    std::set<string> strSetSum;
+    StringDictionary strSetSum;
     valueProducerSum->onDumpReport(bucket2StartTimeNs + 50 * NS_PER_SEC,
                                    true /* include recent buckets */, true, NO_TIME_CONSTRAINTS,
                                    &strSetSum, &outputSum);
@@ -7608,7 +7608,7 @@ TEST(NumericValueMetricProducerTest, TestSampleSize) {
 
     // Start dump report and check output.
     ProtoOutputStream outputSumWithSampleSize;
-    std::set<string> strSetSumWithSampleSize;
+    StringDictionary strSetSumWithSampleSize;
     valueProducerSumWithSampleSize->onDumpReport(
             bucket2StartTimeNs + 50 * NS_PER_SEC, true /* include recent buckets */, true,
             NO_TIME_CONSTRAINTS, &strSetSumWithSampleSize, &outputSumWithSampleSize);
@@ -7666,7 +7666,7 @@ TEST(NumericValueMetricProducerTest, TestDimensionalSampling) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucketStartTimeNs + 10000000000;
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include current buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
@@ -7785,7 +7785,7 @@ TEST(NumericValueMetricProducerTest, TestMultipleAggTypesPulled) {
 
     // Check dump report.
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     int64_t dumpReportTimeNs = bucket2StartTimeNs + 55 * NS_PER_SEC;
     valueProducer->onDumpReport(dumpReportTimeNs, true /* include current buckets */, true,
                                 NO_TIME_CONSTRAINTS /* dumpLatency */, &strSet, &output);
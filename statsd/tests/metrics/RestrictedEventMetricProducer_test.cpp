@@ -174,7 +174,7 @@ TEST_F(RestrictedEventMetricProducerTest, TestOnDumpReportNoOp) {
     std::unique_ptr<LogEvent> event1 = CreateRestrictedLogEvent(/*timestampNs=*/1);
     producer.onMatchedLogEvent(/*matcherIndex=*/1, *event1);
     ProtoOutputStream output;
-    std::set<string> strSet;
+    StringDictionary strSet;
     producer.onDumpReport(/*dumpTimeNs=*/10,
                           /*include_current_partial_bucket=*/true,
                           /*erase_data=*/true, FAST, &strSet, &output);
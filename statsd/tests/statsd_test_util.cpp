@@ -1494,7 +1494,7 @@ sp<NumericValueMetricProducer> createNumericValueMetricProducer(
         optional<ConditionState> conditionAfterFirstBucketPrepared,
         vector<int32_t> slicedStateAtoms,
         unordered_map<int, unordered_map<int, int64_t>> stateGroupMap,
-        sp<EventMatcherWizard> eventMatcherWizard) {
+        sp<EventMatcherWizard> eventMatcherWizard, optional<size_t> dimensionLimit) {
     if (eventMatcherWizard == nullptr) {
         eventMatcherWizard = createEventMatcherWizard(atomId, logEventMatcherIndex);
     }
@@ -1513,9 +1513,13 @@ sp<NumericValueMetricProducer> createNumericValueMetricProducer(
     vector<Matcher> fieldMatchers;
     translateFieldMatcher(metric.value_field(), &fieldMatchers);
 
-    const auto [dimensionSoftLimit, dimensionHardLimit] =
+    auto [dimensionSoftLimit, dimensionHardLimit] =
             StatsdStats::getAtomDimensionKeySizeLimits(atomId,
                                                        StatsdStats::kDimensionKeySizeHardLimitMin);
+    if (dimensionLimit) {
+        dimensionSoftLimit = *dimensionLimit;
+        dimensionHardLimit = *dimensionLimit;
+    }
 
     int conditionIndex = conditionAfterFirstBucketPrepared ? 0 : -1;
     vector<ConditionState> initialConditionCache;
@@ -2418,6 +2422,8 @@ sp<MockConfigMetadataProvider> makeMockConfigMetadataProvider(bool enabled) {
     sp<MockConfigMetadataProvider> metadataProvider = new StrictMock<MockConfigMetadataProvider>();
     EXPECT_CALL(*metadataProvider, useV2SoftMemoryCalculation()).Times(AnyNumber());
     EXPECT_CALL(*metadataProvider, useV2SoftMemoryCalculation()).WillRepeatedly(Return(enabled));
+    EXPECT_CALL(*metadataProvider, useTrackedMemoryCalculation()).Times(AnyNumber());
+    EXPECT_CALL(*metadataProvider, useTrackedMemoryCalculation()).WillRepeatedly(Return(false));
     return nullptr;
 }
 
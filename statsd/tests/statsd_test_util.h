@@ -600,7 +600,8 @@ sp<NumericValueMetricProducer> createNumericValueMetricProducer(
         optional<ConditionState> conditionAfterFirstBucketPrepared = nullopt,
         vector<int32_t> slicedStateAtoms = {},
         unordered_map<int, unordered_map<int, int64_t>> stateGroupMap = {},
-        sp<EventMatcherWizard> eventMatcherWizard = nullptr);
+        sp<EventMatcherWizard> eventMatcherWizard = nullptr,
+        optional<size_t> dimensionLimit = nullopt);
 
 LogEventFilter::AtomIdSet CreateAtomIdSetDefault();
 LogEventFilter::AtomIdSet CreateAtomIdSetFromConfig(const StatsdConfig& config);
@@ -866,6 +867,7 @@ StatsdConfig buildGoodConfig(int configId, int alertId);
 class MockConfigMetadataProvider : public ConfigMetadataProvider {
 public:
     MOCK_METHOD(bool, useV2SoftMemoryCalculation, (), (override));
+    MOCK_METHOD(bool, useTrackedMemoryCalculation, (), (override));
 };
 
 sp<MockConfigMetadataProvider> makeMockConfigMetadataProvider(bool enabled);
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/ShardedExecutor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifdef __ANDROID__
+
+using namespace std;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+TEST(ShardedExecutorTest, TestRunsEachShardOnce) {
+    ShardedExecutor executor(4);
+    ASSERT_EQ(4, executor.getNumShards());
+
+    vector<atomic<int>> runs(4);
+    mutex threadIdsLock;
+    set<thread::id> threadIds;
+    executor.run(0b1111, [&](int shard) {
+        runs[shard]++;
+        lock_guard<mutex> lg(threadIdsLock);
+        threadIds.insert(this_thread::get_id());
+    });
+
+    for (int shard = 0; shard < 4; shard++) {
+        EXPECT_EQ(1, runs[shard].load()) << "shard " << shard;
+    }
+    EXPECT_EQ(4, threadIds.size());
+    EXPECT_EQ(1, threadIds.count(this_thread::get_id()));
+}
+
+TEST(ShardedExecutorTest, TestSingleShardRunsOnCaller) {
+    ShardedExecutor executor(4);
+
+    vector<int> shards;
+    thread::id runThreadId;
+    executor.run(0b0100, [&](int shard) {
+        shards.push_back(shard);
+        runThreadId = this_thread::get_id();
+    });
+
+    EXPECT_EQ(vector<int>({2}), shards);
+    EXPECT_EQ(this_thread::get_id(), runThreadId);
+}
+
+TEST(ShardedExecutorTest, TestIgnoresShardsOutOfRange) {
+    ShardedExecutor executor(2);
+
+    atomic<int> runs = 0;
+    executor.run(0b1100, [&](int) { runs++; });
+    EXPECT_EQ(0, runs.load());
+
+    executor.run(0b1110, [&](int shard) {
+        EXPECT_EQ(1, shard);
+        runs++;
+    });
+    EXPECT_EQ(1, runs.load());
+}
+
+TEST(ShardedExecutorTest, TestRepeatedRuns) {
+    ShardedExecutor executor(8);
+
+    // Unsynchronized counters, each is only touched by the thread of its shard.
+    vector<int> runs(8, 0);
+    for (int i = 0; i < 1000; i++) {
+        executor.run(0xFF, [&runs](int shard) { runs[shard]++; });
+    }
+    EXPECT_EQ(vector<int>(8, 1000), runs);
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/StringDictionary.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#ifdef __ANDROID__
+
+using namespace std;
+using testing::ElementsAre;
+using testing::ElementsAreArray;
+using testing::IsEmpty;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+TEST(StringDictionaryTest, TestInsert) {
+    StringDictionary dictionary;
+    EXPECT_TRUE(dictionary.empty());
+    EXPECT_FALSE(dictionary.contains("com.android.a"));
+
+    EXPECT_TRUE(dictionary.insert("com.android.b"));
+    EXPECT_TRUE(dictionary.insert("com.android.a"));
+    EXPECT_FALSE(dictionary.insert(string("com.android.b")));
+    EXPECT_TRUE(dictionary.insert(""));
+    EXPECT_FALSE(dictionary.insert(""));
+
+    EXPECT_EQ(3UL, dictionary.size());
+    EXPECT_TRUE(dictionary.contains("com.android.a"));
+    EXPECT_TRUE(dictionary.contains(""));
+    EXPECT_FALSE(dictionary.contains("com.android"));
+    EXPECT_THAT(dictionary, ElementsAre("com.android.b", "com.android.a", ""));
+}
+
+TEST(StringDictionaryTest, TestManyStrings) {
+    StringDictionary dictionary;
+    vector<string> expected;
+    for (int i = 0; i < 10000; i++) {
+        // Include strings larger than a block.
+        expected.push_back(i % 1000 == 0 ? string(5000, 'a' + i / 1000)
+                                         : "com.android.package" + to_string(i));
+        EXPECT_TRUE(dictionary.insert(expected.back()));
+    }
+    for (const string& str : expected) {
+        EXPECT_FALSE(dictionary.insert(str));
+        EXPECT_TRUE(dictionary.contains(str));
+    }
+    EXPECT_THAT(dictionary, ElementsAreArray(expected));
+}
+
+TEST(StringDictionaryTest, TestClear) {
+    StringDictionary dictionary;
+    for (int i = 0; i < 1000; i++) {
+        dictionary.insert("string" + to_string(i));
+    }
+    dictionary.clear();
+    EXPECT_THAT(dictionary, IsEmpty());
+    EXPECT_FALSE(dictionary.contains("string1"));
+
+    EXPECT_TRUE(dictionary.insert("string2"));
+    EXPECT_TRUE(dictionary.insert("string1"));
+    EXPECT_THAT(dictionary, ElementsAre("string2", "string1"));
+}
+
+TEST(StringDictionaryTest, TestIntern) {
+    StringDictionary dictionary;
+    string str = "com.android.a";
+    const string_view interned = dictionary.intern(str);
+    EXPECT_EQ("com.android.a", interned);
+    EXPECT_NE(str.data(), interned.data());
+    EXPECT_EQ(interned.data(), dictionary.intern("com.android.a").data());
+    EXPECT_TRUE(dictionary.intern("").empty());
+    EXPECT_EQ(2UL, dictionary.size());
+
+    // The interned strings outlive a move of the dictionary.
+    for (int i = 0; i < 1000; i++) {
+        dictionary.intern("string" + to_string(i));
+    }
+    StringDictionary moved = std::move(dictionary);
+    EXPECT_EQ("com.android.a", interned);
+    EXPECT_EQ(interned.data(), moved.intern("com.android.a").data());
+    EXPECT_EQ(1002UL, moved.size());
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
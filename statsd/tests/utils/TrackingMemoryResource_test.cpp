@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/TrackingMemoryResource.h"
+
+#include <gtest/gtest.h>
+
+#include <unordered_map>
+#include <vector>
+
+#ifdef __ANDROID__
+
+using namespace std;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+TEST(TrackingMemoryResourceTest, TestCountsAllocatedBytes) {
+    TrackingMemoryResource resource;
+    EXPECT_EQ(0UL, resource.getBytesAllocated());
+
+    {
+        pmr::vector<int64_t> values(&resource);
+        values.reserve(100);
+        EXPECT_EQ(100 * sizeof(int64_t), resource.getBytesAllocated());
+        values.shrink_to_fit();
+        EXPECT_EQ(0UL, resource.getBytesAllocated());
+        values.resize(10);
+        EXPECT_EQ(10 * sizeof(int64_t), resource.getBytesAllocated());
+    }
+    EXPECT_EQ(0UL, resource.getBytesAllocated());
+}
+
+TEST(TrackingMemoryResourceTest, TestNestedContainers) {
+    TrackingMemoryResource resource;
+    pmr::unordered_map<int, pmr::vector<int64_t>> map(&resource);
+    const size_t emptyMapBytes = resource.getBytesAllocated();
+
+    for (int i = 0; i < 100; i++) {
+        map[i].reserve(10);
+    }
+    // The inner vectors use the resource of the map.
+    EXPECT_GE(resource.getBytesAllocated(), emptyMapBytes + 100 * 10 * sizeof(int64_t));
+
+    map.clear();
+    EXPECT_LE(resource.getBytesAllocated(), emptyMapBytes + 1024);
+    map = pmr::unordered_map<int, pmr::vector<int64_t>>(&resource);
+    EXPECT_EQ(0UL, resource.getBytesAllocated());
+}
+
+TEST(TrackingMemoryResourceTest, TestUpstream) {
+    TrackingMemoryResource upstream;
+    TrackingMemoryResource resource(&upstream);
+    {
+        pmr::vector<int32_t> values(50, 0, &resource);
+        EXPECT_EQ(50 * sizeof(int32_t), resource.getBytesAllocated());
+        EXPECT_EQ(50 * sizeof(int32_t), upstream.getBytesAllocated());
+    }
+    EXPECT_EQ(0UL, resource.getBytesAllocated());
+    EXPECT_EQ(0UL, upstream.getBytesAllocated());
+    EXPECT_FALSE(resource.is_equal(upstream));
+    EXPECT_TRUE(resource.is_equal(resource));
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif